@@ -0,0 +1,20 @@
+#!/bin/sh
+# runs 'qjs bench' with different concurrency levels and appends the results (json, one per line) to the file,
+# the files of different versions can be compared then
+#
+# usage: bench.sh script.js runs "1 10 50 100" [dialstring] > results-v1.8.json
+#
+FS_CLI=${FS_CLI:-fs_cli}
+SCRIPT=$1
+RUNS=${2:-1000}
+LEVELS=${3:-"1 10 50 100"}
+DIALSTRING=$4
+
+if [ -z "$SCRIPT" ]; then
+    echo "usage: $0 script.js [runs] [\"concurrency levels\"] [dialstring]" >&2
+    exit 1
+fi
+
+for c in $LEVELS; do
+    $FS_CLI -x "qjs bench $SCRIPT $RUNS $c $DIALSTRING" | grep '^{'
+done
@@ -0,0 +1,2 @@
+// does nothing, measures the module overhead only
+// fs_cli -x 'qjs bench bench/bench_empty.js 1000 50'
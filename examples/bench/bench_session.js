@@ -0,0 +1,5 @@
+// touches the session (the class is registered on first access)
+// fs_cli -x 'qjs bench bench/bench_session.js 100 10 loopback/9999/default'
+if(session.isReady) {
+    session.setVariable('qjs_bench', '1');
+}
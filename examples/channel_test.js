@@ -0,0 +1,37 @@
+// -----------------------------------------------------------------------------------------------------------------------------
+//
+// inter-script channels
+// qjs run-bg channel_test.js controller
+// qjs run channel_test.js
+// required mod_quickjs 1.8 or higher
+//
+// -----------------------------------------------------------------------------------------------------------------------------
+if(argc > 0 && argv[0] == 'controller') {
+    var ch = Channel.open('controller');
+
+    consoleLog('notice', "controller started (channel: " + ch.name + ")");
+    while(true) {
+        var msg = ch.receive();
+        if(msg === undefined) {
+            break;
+        }
+        if(msg instanceof ArrayBuffer) {
+            consoleLog('notice', "raw message: " + msg.byteLength + " bytes");
+            continue;
+        }
+        consoleLog('notice', "message from: " + msg.from + ", payload: " + JSON.stringify(msg.payload));
+
+        // reply to the sender's own channel (named by its script id)
+        Channel.open(msg.from).post({ ack: msg.payload.seq });
+    }
+} else {
+    var ctl = Channel.open('controller');
+    var inbox = Channel.open();
+
+    for(var i = 0; i < 3; i++) {
+        ctl.post({ from: script.id, payload: { seq: i, tags: ['a', 'b'], when: new Date() } });
+        var reply = inbox.receive(1000);
+        consoleLog('notice', "reply: " + (reply ? reply.ack : 'timeout'));
+    }
+    ctl.post(new ArrayBuffer(1024));
+}
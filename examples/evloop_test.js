@@ -0,0 +1,30 @@
+// -----------------------------------------------------------------------------------------------------------------------------
+//
+// timers, promises and async curl requests
+// required mod_quickjs 1.8 or higher
+//
+// -----------------------------------------------------------------------------------------------------------------------------
+var ticks = 0;
+
+var tid = setInterval(function() {
+    ticks++;
+    consoleLog('notice', "tick: " + ticks);
+    if(ticks >= 3) {
+        clearInterval(tid);
+    }
+}, 1000);
+
+setTimeout(function(msg) {
+    consoleLog('notice', msg);
+}, 500, "timeout fired");
+
+var curl = new CURL('http://127.0.0.1/', 'GET', 10);
+
+try {
+    var res = await curl.performAsync();
+    consoleLog('notice', "job-done: " + res.jid + " (code=" + res.code + ")");
+} catch(e) {
+    consoleLog('error', "request failed: " + e);
+}
+
+consoleLog('notice', "***************** main part finished *****************");
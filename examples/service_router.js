@@ -0,0 +1,35 @@
+// -----------------------------------------------------------------------------------------------------------------------------
+//
+// resident call handler (service)
+// required mod_quickjs 1.8 or higher
+//
+// quickjs.conf.xml:
+//  <autoload-scripts>
+//      <script path="{service=router}service_router.js" shards="4"/>
+//  </autoload-scripts>
+//
+// dialplan:
+//  <action application="qjs_dispatch" data="router sales"/>
+//  <action application="transfer" data="${qjs_route} XML default"/>
+//
+// the handler runs in the shard runtime, the blocking session methods (playback, etc) hold the whole shard,
+// so keep it short or return a promise, the session is released when the handler (or the promise) is finished
+//
+// -----------------------------------------------------------------------------------------------------------------------------
+var routes = new SharedMap('routes');
+var calls = 0;
+
+service.onCall(function(session, args) {
+    var dst = routes.get(session.destination) || '1000';
+
+    calls++;
+    log.info('routing call', { uuid: session.uuid, from: session.callerIdNumber, dst: dst, queue: args, shard: script.id });
+
+    // the dialplan goes on after qjs_dispatch
+    session.autoHangup = false;
+    session.setVariable('qjs_route', dst);
+});
+
+setInterval(function() {
+    log.debug('service stats', { name: service.name, calls: calls });
+}, 60000);
@@ -0,0 +1,26 @@
+// -----------------------------------------------------------------------------------------------------------------------------
+//
+// shared key-value store (visible to all scripts)
+// required mod_quickjs 1.8 or higher
+//
+// -----------------------------------------------------------------------------------------------------------------------------
+var trunks = new SharedMap('trunks');
+
+var calls = trunks.incr('gw1:calls');
+consoleLog('notice', "gw1 calls: " + calls);
+
+// routing decision for 5 seconds
+trunks.set('route:1001', 'gw2', 5000);
+consoleLog('notice', "route: " + trunks.get('route:1001') + ", ttl: " + trunks.ttl('route:1001') + " ms");
+
+// take the lock only if nobody holds it
+if(trunks.cas('lock:gw1', undefined, script.id, 1000)) {
+    consoleLog('notice', "lock taken");
+    trunks.delete('lock:gw1');
+}
+
+trunks.set('blob', new ArrayBuffer(16));
+consoleLog('notice', "blob size: " + trunks.get('blob').byteLength);
+
+trunks.set('gw1:enabled', false);
+consoleLog('notice', "gw1 enabled: " + (trunks.get('gw1:enabled') === false ? "no" : "yes"));
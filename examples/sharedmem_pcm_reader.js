@@ -0,0 +1,47 @@
+// -----------------------------------------------------------------------------------------------------------------------------
+//
+// shared memory ring buffer (reader): measures the level of the call audio written by sharedmem_pcm_writer.js
+// required mod_quickjs 1.8 or higher
+//
+// qjs run-bg sharedmem_pcm_reader.js <uuid>
+//
+// the region stays alive while any script holds it, Atomics.wait blocks only this script
+//
+// -----------------------------------------------------------------------------------------------------------------------------
+const RING_SAMPLES = 16000 * 4;
+const HDR_SIZE = 16;
+
+var name = 'pcm-' + argv[0];
+if(argc < 1 || !SharedMemory.exists(name)) {
+    consoleLog('err', "region not found: " + name);
+    exit();
+}
+
+var shm = SharedMemory.open(name);
+var hdr = new Int32Array(shm, 0, 4);
+var ring = new Int16Array(shm, HDR_SIZE, RING_SAMPLES);
+var seq = Atomics.load(hdr, 1);
+var rpos = Atomics.load(hdr, 0);
+
+while(!script.isInterrupted()) {
+    if(Atomics.wait(hdr, 1, seq, 1000) == 'timed-out') {
+        continue;
+    }
+    seq = Atomics.load(hdr, 1);
+    if(!Atomics.load(hdr, 2)) {
+        break;
+    }
+
+    var wpos = Atomics.load(hdr, 0), sum = 0, count = (wpos - rpos);
+    if(count > RING_SAMPLES) {
+        rpos = wpos - RING_SAMPLES; count = RING_SAMPLES; // overrun, skip the oldest
+    }
+    for(var i = 0; i < count; i++) {
+        sum += Math.abs(ring[(rpos + i) % RING_SAMPLES]);
+    }
+    rpos = wpos;
+
+    if(count > 0) {
+        log.debug('audio level', { call: argv[0], samples: count, level: Math.ceil(sum / count) });
+    }
+}
@@ -0,0 +1,56 @@
+// -----------------------------------------------------------------------------------------------------------------------------
+//
+// shared memory ring buffer (writer): puts the decoded audio of the call into a named region
+// required mod_quickjs 1.8 or higher
+//
+// dialplan:
+//  <action application="qjs" data="sharedmem_pcm_writer.js"/>
+// analysis:
+//  qjs run-bg sharedmem_pcm_reader.js <uuid>
+//
+// layout: Int32 [0] - samples written (total), [1] - sequence (Atomics.wait/notify), [2] - samplerate; Int16 samples from 16 bytes
+//
+// -----------------------------------------------------------------------------------------------------------------------------
+const RING_SAMPLES = 16000 * 4;
+const HDR_SIZE = 16;
+
+if(typeof(session) == 'undefined') {
+    consoleLog('err', "session not found!");
+    exit();
+}
+if(!session.isAnswered) {
+    session.answer();
+}
+
+var rcodec = session.getReadCodec();
+var shm = SharedMemory.open('pcm-' + session.uuid, HDR_SIZE + RING_SAMPLES * 2);
+var hdr = new Int32Array(shm, 0, 4);
+var ring = new Int16Array(shm, HDR_SIZE, RING_SAMPLES);
+
+var srcBuf = new ArrayBuffer(4096);
+var tmpBuf = new ArrayBuffer(4096);
+var tmp16 = new Int16Array(tmpBuf);
+
+Atomics.store(hdr, 2, rcodec.samplerate);
+
+while(session.isReady) {
+    var len = session.frameRead(srcBuf);
+    if(len <= 0) continue;
+
+    len = rcodec.decode(srcBuf, len, rcodec.samplerate, tmpBuf, rcodec.samplerate);
+    if(len <= 0) continue;
+
+    var pos = Atomics.load(hdr, 0), samples = (len / 2);
+    for(var i = 0; i < samples; i++) {
+        ring[(pos + i) % RING_SAMPLES] = tmp16[i];
+    }
+
+    Atomics.store(hdr, 0, pos + samples);
+    Atomics.add(hdr, 1, 1);
+    Atomics.notify(hdr, 1);
+}
+
+// wakes the reader up, it sees that the call is over
+Atomics.store(hdr, 2, 0);
+Atomics.add(hdr, 1, 1);
+Atomics.notify(hdr, 1);
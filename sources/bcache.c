@@ -0,0 +1,329 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+#include <sys/stat.h>
+
+extern globals_t globals;
+
+typedef struct {
+    char                    *path;
+    char                    *name;
+    uint8_t                 *data;
+    switch_size_t           data_len;
+    switch_size_t           fsize;
+    time_t                  mtime;
+    switch_time_t           created;
+    uint32_t                version;        // increased on each recompilation of the path
+    uint32_t                refs;
+    uint32_t                hits;
+    uint8_t                 fl_dead;
+} bcache_entry_t;
+
+static struct {
+    switch_mutex_t          *mutex;
+    switch_hash_t           *entries;
+    switch_size_t           mem_used;
+    uint32_t                entries_count;
+    uint64_t                hits;
+    uint64_t                misses;
+    uint64_t                stale;
+    uint64_t                rejected;
+    uint64_t                preloaded;
+} bcache;
+
+static void bcache_entry_free(bcache_entry_t *entry) {
+    if(entry) {
+        switch_safe_free(entry->path);
+        switch_safe_free(entry->name);
+        switch_safe_free(entry->data);
+        switch_safe_free(entry);
+    }
+}
+
+/* must be called under bcache.mutex */
+static void bcache_entry_unlink(bcache_entry_t *entry) {
+    entry->fl_dead = true;
+
+    if(bcache.mem_used >= entry->data_len) bcache.mem_used -= entry->data_len;
+    if(bcache.entries_count) bcache.entries_count--;
+
+    if(!entry->refs) {
+        bcache_entry_free(entry);
+    }
+}
+
+/* must be called under bcache.mutex */
+static uint8_t bcache_entry_is_actual(bcache_entry_t *entry, const char *name, struct stat *st) {
+    return (entry->mtime == st->st_mtime && entry->fsize == st->st_size && !strcmp(entry->name, name));
+}
+
+static bcache_entry_t *bcache_entry_take(const char *path, const char *name, struct stat *st) {
+    bcache_entry_t *entry = NULL;
+
+    switch_mutex_lock(bcache.mutex);
+    entry = switch_core_hash_find(bcache.entries, path);
+    if(entry) {
+        if(bcache_entry_is_actual(entry, name, st)) {
+            entry->refs++;
+            entry->hits++;
+            bcache.hits++;
+        } else {
+            entry = NULL;
+            bcache.stale++;
+            bcache.misses++;
+        }
+    } else {
+        bcache.misses++;
+    }
+    switch_mutex_unlock(bcache.mutex);
+
+    return entry;
+}
+
+static void bcache_entry_release(bcache_entry_t *entry) {
+    switch_mutex_lock(bcache.mutex);
+    if(entry->refs) entry->refs--;
+    if(entry->fl_dead && !entry->refs) {
+        bcache_entry_free(entry);
+    }
+    switch_mutex_unlock(bcache.mutex);
+}
+
+/**
+ ** replaces the path entry atomically, the ones who already took the previous version keep using it
+ **/
+static void bcache_entry_store(const char *path, const char *name, struct stat *st, uint8_t *data, switch_size_t data_len, bcache_info_t *info) {
+    bcache_entry_t *entry = NULL, *old = NULL;
+
+    switch_mutex_lock(bcache.mutex);
+
+    if(globals.cfg_bcache_size_max && (bcache.mem_used + data_len) > globals.cfg_bcache_size_max) {
+        bcache.rejected++;
+        goto out;
+    }
+
+    switch_zmalloc(entry, sizeof(bcache_entry_t));
+    switch_malloc(entry->data, data_len);
+    memcpy(entry->data, data, data_len);
+
+    entry->path = strdup(path);
+    entry->name = strdup(name);
+    entry->data_len = data_len;
+    entry->fsize = st->st_size;
+    entry->mtime = st->st_mtime;
+    entry->created = switch_micro_time_now();
+    entry->version = 1;
+
+    if((old = switch_core_hash_find(bcache.entries, path))) {
+        entry->version = old->version + 1;
+        switch_core_hash_delete(bcache.entries, path);
+        bcache_entry_unlink(old);
+    }
+
+    if(info) {
+        info->version = entry->version;
+        info->loaded = entry->created;
+    }
+
+    switch_core_hash_insert(bcache.entries, entry->path, entry);
+    bcache.mem_used += data_len;
+    bcache.entries_count++;
+
+out:
+    switch_mutex_unlock(bcache.mutex);
+}
+
+static JSValue bcache_compile(JSContext *ctx, const char *path, const char *name, int eval_flags, struct stat *st, bcache_info_t *info) {
+    JSValue func_val = JS_UNDEFINED;
+    size_t buf_len = 0, bc_len = 0;
+    uint8_t *buf = NULL, *bc = NULL;
+
+    buf = js_load_file(ctx, &buf_len, path);
+    if(!buf) {
+        return JS_ThrowReferenceError(ctx, "Unable to load '%s'", name);
+    }
+
+    func_val = JS_Eval(ctx, (char *)buf, buf_len, name, eval_flags | JS_EVAL_FLAG_COMPILE_ONLY);
+    js_free(ctx, buf);
+
+    if(JS_IsException(func_val)) {
+        return func_val;
+    }
+
+    if(globals.cfg_bcache_enabled) {
+        if((bc = JS_WriteObject(ctx, &bc_len, func_val, JS_WRITE_OBJ_BYTECODE))) {
+            bcache_entry_store(path, name, st, bc, bc_len, info);
+            js_free(ctx, bc);
+        }
+    }
+
+    return func_val;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+switch_status_t bcache_init(switch_memory_pool_t *pool) {
+    memset(&bcache, 0, sizeof(bcache));
+
+    switch_mutex_init(&bcache.mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_core_hash_init(&bcache.entries);
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+void bcache_shutdown() {
+    bcache_flush();
+
+    switch_mutex_lock(bcache.mutex);
+    switch_core_hash_destroy(&bcache.entries);
+    switch_mutex_unlock(bcache.mutex);
+}
+
+void bcache_flush() {
+    switch_hash_index_t *hidx = NULL;
+
+    if(!bcache.entries) {
+        return;
+    }
+
+    switch_mutex_lock(bcache.mutex);
+    for(hidx = switch_core_hash_first_iter(bcache.entries, hidx); hidx; hidx = switch_core_hash_next(&hidx)) {
+        void *hval = NULL;
+        switch_core_hash_this(hidx, NULL, NULL, &hval);
+        bcache_entry_unlink((bcache_entry_t *)hval);
+    }
+    switch_safe_free(hidx);
+
+    switch_core_hash_destroy(&bcache.entries);
+    switch_core_hash_init(&bcache.entries);
+
+    bcache.mem_used = 0;
+    bcache.entries_count = 0;
+    switch_mutex_unlock(bcache.mutex);
+}
+
+void bcache_stats(switch_stream_handle_t *stream) {
+    uint64_t total = 0;
+
+    switch_mutex_lock(bcache.mutex);
+    total = bcache.hits + bcache.misses;
+    stream->write_function(stream, "enabled: %s\n", (globals.cfg_bcache_enabled ? "true" : "false"));
+    stream->write_function(stream, "entries: %u\n", bcache.entries_count);
+    stream->write_function(stream, "memory: %"SWITCH_SIZE_T_FMT" bytes (max: %"SWITCH_SIZE_T_FMT")\n", bcache.mem_used, globals.cfg_bcache_size_max);
+    stream->write_function(stream, "hits: %"SWITCH_UINT64_T_FMT"\n", bcache.hits);
+    stream->write_function(stream, "misses: %"SWITCH_UINT64_T_FMT" (stale: %"SWITCH_UINT64_T_FMT")\n", bcache.misses, bcache.stale);
+    stream->write_function(stream, "rejected: %"SWITCH_UINT64_T_FMT"\n", bcache.rejected);
+    stream->write_function(stream, "preloaded: %"SWITCH_UINT64_T_FMT"\n", bcache.preloaded);
+    stream->write_function(stream, "hit-rate: %.2f%%\n", (total ? ((double)bcache.hits * 100.0 / (double)total) : 0.0));
+    switch_mutex_unlock(bcache.mutex);
+}
+
+/**
+ ** returns compiled (not evaluated) script or module
+ ** the bytecode is taken from the cache when the file wasn't changed (mtime + size)
+ ** info (optional) gets the version of the code and the time when it was compiled
+ **/
+JSValue bcache_load(JSContext *ctx, const char *path, const char *name, int eval_flags, bcache_info_t *info) {
+    bcache_entry_t *entry = NULL;
+    JSValue func_val = JS_UNDEFINED;
+    struct stat st = { 0 };
+
+    if(info) {
+        info->version = 0;
+        info->loaded = switch_micro_time_now();
+    }
+
+    if(stat(path, &st) != 0) {
+        return JS_ThrowReferenceError(ctx, "Unable to load '%s'", name);
+    }
+    if(!st.st_size) {
+        return JS_ThrowReferenceError(ctx, "File is empty '%s'", name);
+    }
+
+    if(globals.cfg_bcache_enabled) {
+        if((entry = bcache_entry_take(path, name, &st))) {
+            func_val = JS_ReadObject(ctx, entry->data, entry->data_len, JS_READ_OBJ_BYTECODE);
+            if(info) {
+                info->version = entry->version;
+                info->loaded = entry->created;
+            }
+            bcache_entry_release(entry);
+
+            if(!JS_IsException(func_val)) {
+                return func_val;
+            }
+
+            /* broken entry, compile from the sources */
+            JS_FreeValue(ctx, JS_GetException(ctx));
+        }
+    }
+
+    return bcache_compile(ctx, path, name, eval_flags, &st, info);
+}
+
+/**
+ ** compiles the file and publishes a new version in the cache (if it was changed)
+ ** the name is taken from the previous version, or the file name is used for the new ones
+ ** ctx is used only for compilation (the watcher gives a fresh one per file)
+ **/
+switch_status_t bcache_preload(JSContext *ctx, const char *path) {
+    switch_status_t status = SWITCH_STATUS_SUCCESS;
+    bcache_entry_t *entry = NULL;
+    JSValue func_val = JS_UNDEFINED;
+    struct stat st = { 0 };
+    char *name = NULL;
+
+    if(!globals.cfg_bcache_enabled) {
+        return SWITCH_STATUS_FALSE;
+    }
+    if(stat(path, &st) != 0 || !st.st_size) {
+        return SWITCH_STATUS_FALSE;
+    }
+
+    switch_mutex_lock(bcache.mutex);
+    if((entry = switch_core_hash_find(bcache.entries, path))) {
+        if(entry->mtime == st.st_mtime && entry->fsize == st.st_size) {
+            switch_mutex_unlock(bcache.mutex);
+            return SWITCH_STATUS_SUCCESS;
+        }
+        name = strdup(entry->name);
+    }
+    switch_mutex_unlock(bcache.mutex);
+
+    if(!name) {
+        char *p = strrchr(path, '/');
+        name = strdup(p ? p + 1 : path);
+    }
+
+    func_val = bcache_compile(ctx, path, name, JS_EVAL_TYPE_MODULE, &st, NULL);
+    if(JS_IsException(func_val)) {
+        js_ctx_dump_error(NULL, ctx);
+        status = SWITCH_STATUS_FALSE;
+    } else {
+        switch_mutex_lock(bcache.mutex);
+        bcache.preloaded++;
+        switch_mutex_unlock(bcache.mutex);
+    }
+
+    JS_FreeValue(ctx, func_val);
+    switch_safe_free(name);
+
+    return status;
+}
+
+/**
+ ** drops the path from the cache (file was removed)
+ **/
+void bcache_invalidate(const char *path) {
+    bcache_entry_t *entry = NULL;
+
+    switch_mutex_lock(bcache.mutex);
+    if(bcache.entries && (entry = switch_core_hash_find(bcache.entries, path))) {
+        switch_core_hash_delete(bcache.entries, path);
+        bcache_entry_unlink(entry);
+    }
+    switch_mutex_unlock(bcache.mutex);
+}
@@ -0,0 +1,257 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+
+extern globals_t globals;
+
+/**
+ ** load test: launches the script N times (C at once) through the regular path (workers, runtimes pool)
+ ** and reports where the time goes, the result is json to be compared between versions
+ ** with a dialstring each run gets its own originated session
+ **/
+#define BENCH_RUNS_MAX          100000
+#define BENCH_TIMEOUT_SEC       600
+#define BENCH_ORIGINATE_TIMEOUT 60
+
+enum {
+    BENCH_METRIC_QUEUE = 0,     // waiting for a worker
+    BENCH_METRIC_RUNTIME,       // runtime taken from the pool or created (with builtins)
+    BENCH_METRIC_SETUP,         // script globals, session object (class registration)
+    BENCH_METRIC_EVAL,          // load, eval and the event loop
+    BENCH_METRIC_TEARDOWN,      // context and runtime release, cleanup
+    BENCH_METRIC_TOTAL,         // end-to-end
+    BENCH_METRIC_ORIGINATE,     // session mode only, not a part of the total
+    BENCH_METRIC_MAX
+};
+
+static const char *bench_metric_names[BENCH_METRIC_MAX] = { "queue", "runtime", "setup", "eval", "teardown", "total", "originate" };
+
+typedef struct {
+    uint32_t                v[BENCH_METRIC_MAX];        // us
+} bench_sample_t;
+
+struct bench_s {
+    switch_mutex_t          *mutex;
+    switch_thread_cond_t    *cond;
+    uint32_t                runs;
+    uint32_t                inflight;
+    uint32_t                inflight_max;
+    uint32_t                completed;
+    uint32_t                failed;
+    uint32_t                threads_count;
+    switch_thread_id_t      *threads;
+    bench_sample_t          *samples;
+    uint32_t                *originate_time;            // by the launch order
+};
+
+static inline uint32_t bench_delta(switch_time_t from, switch_time_t to) {
+    return ((from && to > from) ? (uint32_t)(to - from) : 0);
+}
+
+static int bench_cmp(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x < y ? -1 : (x > y ? 1 : 0));
+}
+
+static void bench_interrupt_cb(script_t *script, void *udata) {
+    if(script->bench == (bench_t *)udata && script->fl_ready && !script->fl_destroyed) {
+        script->fl_interrupt = true;
+        evloop_wakeup(script->evloop);
+    }
+}
+
+static void bench_metric_write(switch_stream_handle_t *stream, uint32_t metric, uint32_t *values, uint32_t count, uint8_t fl_first) {
+    uint64_t sum = 0;
+
+    for(uint32_t i = 0; i < count; i++) {
+        sum += values[i];
+    }
+    qsort(values, count, sizeof(uint32_t), bench_cmp);
+
+    stream->write_function(stream, "%s\"%s\":{\"min\":%u,\"avg\":%u,\"p50\":%u,\"p99\":%u,\"max\":%u}",
+        (fl_first ? "" : ","), bench_metric_names[metric],
+        (count ? values[0] : 0), (count ? (uint32_t)(sum / count) : 0), (count ? values[(count - 1) / 2] : 0),
+        (count ? values[((uint64_t)(count - 1) * 99) / 100] : 0), (count ? values[count - 1] : 0)
+    );
+}
+
+static switch_core_session_t *bench_originate(const char *dialstring) {
+    switch_core_session_t *session = NULL;
+    switch_call_cause_t cause = SWITCH_CAUSE_NONE;
+
+    if(switch_ivr_originate(NULL, &session, &cause, dialstring, BENCH_ORIGINATE_TIMEOUT, NULL, NULL, NULL, NULL, NULL, SOF_NONE, NULL, NULL) != SWITCH_STATUS_SUCCESS) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Originate failed: %s (%s)\n", switch_channel_cause2str(cause), dialstring);
+        return NULL;
+    }
+
+    switch_channel_set_state(switch_core_session_get_channel(session), CS_SOFT_EXECUTE);
+    switch_channel_wait_for_state_timeout(switch_core_session_get_channel(session), CS_SOFT_EXECUTE, 5000);
+
+    return session;
+}
+
+static void bench_hangup(switch_core_session_t *session) {
+    if(session) {
+        switch_channel_hangup(switch_core_session_get_channel(session), SWITCH_CAUSE_NORMAL_CLEARING);
+        switch_core_session_rwunlock(session);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+/**
+ ** blocks until all runs are finished (or BENCH_TIMEOUT_SEC, then the rest is interrupted)
+ **/
+void bench_run(const char *script_name, uint32_t runs, uint32_t concurrency, const char *dialstring, switch_stream_handle_t *stream) {
+    switch_memory_pool_t *pool = NULL;
+    bench_t *bench = NULL;
+    uint32_t *values = NULL;
+    uint64_t rt_created = 0, rt_reused = 0, rt_created_end = 0, rt_reused_end = 0;
+    switch_time_t start = 0, wall_time = 0, deadline = 0;
+    uint32_t launched = 0, rejected = 0, count = 0;
+    uint8_t fl_interrupted = false;
+
+    if(zstr(script_name) || !runs || runs > BENCH_RUNS_MAX) {
+        stream->write_function(stream, "-ERR: invalid arguments (runs: 1..%u)\n", BENCH_RUNS_MAX);
+        return;
+    }
+    if(!concurrency || concurrency > runs) {
+        concurrency = runs;
+    }
+
+    if(switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "switch_core_new_memory_pool()\n");
+        stream->write_function(stream, "-ERR: memory\n");
+        return;
+    }
+
+    bench = switch_core_alloc(pool, sizeof(bench_t));
+    bench->runs = runs;
+    bench->threads = switch_core_alloc(pool, sizeof(switch_thread_id_t) * runs);
+    bench->samples = switch_core_alloc(pool, sizeof(bench_sample_t) * runs);
+    bench->originate_time = switch_core_alloc(pool, sizeof(uint32_t) * runs);
+    values = switch_core_alloc(pool, sizeof(uint32_t) * runs);
+
+    switch_mutex_init(&bench->mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_thread_cond_create(&bench->cond, pool);
+
+    rtpool_counters(&rt_created, &rt_reused);
+    start = switch_micro_time_now();
+    deadline = start + ((switch_time_t)BENCH_TIMEOUT_SEC * 1000000);
+
+    switch_mutex_lock(bench->mutex);
+    while(launched < runs && !globals.fl_shutdown && switch_micro_time_now() < deadline) {
+        switch_core_session_t *session = NULL;
+        switch_time_t ts = 0;
+        char *name = NULL;
+
+        if(bench->inflight >= concurrency) {
+            switch_thread_cond_timedwait(bench->cond, bench->mutex, 1000000);
+            continue;
+        }
+        bench->inflight++;
+        if(bench->inflight > bench->inflight_max) bench->inflight_max = bench->inflight;
+        switch_mutex_unlock(bench->mutex);
+
+        if(dialstring) {
+            ts = switch_micro_time_now();
+            session = bench_originate(dialstring);
+            bench->originate_time[launched] = bench_delta(ts, switch_micro_time_now());
+        }
+
+        name = strdup(script_name);
+        if((dialstring && !session) || script_launch(session, name, NULL, NULL, true, bench) != SWITCH_STATUS_SUCCESS) {
+            bench_hangup(session);
+            switch_mutex_lock(bench->mutex);
+            bench->inflight--;
+            rejected++;
+        } else {
+            switch_mutex_lock(bench->mutex);
+        }
+        switch_safe_free(name);
+        launched++;
+    }
+
+    while(bench->inflight) {
+        if(!fl_interrupted && (globals.fl_shutdown || switch_micro_time_now() >= deadline)) {
+            switch_mutex_unlock(bench->mutex);
+            registry_foreach(REGISTRY_INDEX_ALL, NULL, bench_interrupt_cb, bench);
+            switch_mutex_lock(bench->mutex);
+            fl_interrupted = true;
+        }
+        switch_thread_cond_timedwait(bench->cond, bench->mutex, 1000000);
+    }
+    switch_mutex_unlock(bench->mutex);
+
+    wall_time = (switch_micro_time_now() - start);
+    rtpool_counters(&rt_created_end, &rt_reused_end);
+
+    stream->write_function(stream, "{\"version\":\"%s\",\"script\":\"%s\",\"session\":%s,\"runs\":%u,\"concurrency\":%u,\"launched\":%u,"
+        "\"completed\":%u,\"failed\":%u,\"rejected\":%u,\"interrupted\":%s,\"wallTime\":%"SWITCH_TIME_T_FMT",\"rate\":%.2f,"
+        "\"runtimes\":{\"created\":%"SWITCH_UINT64_T_FMT",\"reused\":%"SWITCH_UINT64_T_FMT",\"allocator\":\"%s\"},"
+        "\"threads\":%u,\"inflightMax\":%u,\"phases\":{",
+        MOD_VERSION, script_name, (dialstring ? "true" : "false"), runs, concurrency, launched,
+        bench->completed, bench->failed, rejected, (fl_interrupted ? "true" : "false"), wall_time / 1000,
+        (wall_time ? ((double)bench->completed * 1000000.0 / (double)wall_time) : 0.0),
+        (rt_created_end - rt_created), (rt_reused_end - rt_reused), (globals.cfg_rt_arena ? "arena" : "system"),
+        bench->threads_count, bench->inflight_max
+    );
+
+    count = bench->completed;
+    for(uint32_t m = 0; m < BENCH_METRIC_MAX; m++) {
+        if(m == BENCH_METRIC_ORIGINATE) {
+            if(!dialstring) continue;
+            memcpy(values, bench->originate_time, sizeof(uint32_t) * launched);
+            bench_metric_write(stream, m, values, launched, false);
+            continue;
+        }
+        for(uint32_t i = 0; i < count; i++) {
+            values[i] = bench->samples[i].v[m];
+        }
+        bench_metric_write(stream, m, values, count, (m == 0));
+    }
+    stream->write_function(stream, "}}\n");
+
+    switch_core_destroy_memory_pool(&pool);
+}
+
+/**
+ ** called by the script thread when it's done (the runtime is already released)
+ **/
+void bench_script_done(script_t *script) {
+    bench_t *bench = script->bench;
+    script_timing_t *t = &script->timing;
+    switch_time_t now = switch_micro_time_now();
+    switch_thread_id_t tid = switch_thread_self();
+    uint8_t fl_seen = false;
+
+    bench_hangup(script->session);
+
+    switch_mutex_lock(bench->mutex);
+    if(t->eval_done && bench->completed < bench->runs) {
+        bench_sample_t *s = &bench->samples[bench->completed++];
+
+        s->v[BENCH_METRIC_QUEUE] = bench_delta(t->queued, t->started);
+        s->v[BENCH_METRIC_RUNTIME] = bench_delta(t->started, t->rt_ready);
+        s->v[BENCH_METRIC_SETUP] = bench_delta(t->rt_ready, t->setup_done);
+        s->v[BENCH_METRIC_EVAL] = bench_delta(t->setup_done, t->eval_done);
+        s->v[BENCH_METRIC_TEARDOWN] = bench_delta(t->eval_done, now);
+        s->v[BENCH_METRIC_TOTAL] = bench_delta(t->queued, now);
+    } else {
+        bench->failed++;
+    }
+
+    for(uint32_t i = 0; i < bench->threads_count && !fl_seen; i++) {
+        fl_seen = switch_thread_equal(bench->threads[i], tid);
+    }
+    if(!fl_seen && bench->threads_count < bench->runs) {
+        bench->threads[bench->threads_count++] = tid;
+    }
+
+    if(bench->inflight) bench->inflight--;
+    switch_thread_cond_signal(bench->cond);
+    switch_mutex_unlock(bench->mutex);
+}
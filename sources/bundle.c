@@ -0,0 +1,616 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+
+extern globals_t globals;
+
+/**
+ ** bytecode bundle (.qjsb): precompiled scripts and modules in a single file
+ ** [header][index * count][names][bytecode]
+ ** a bundle is read into private memory once, the bytecode is read (copied) into a runtime on each load,
+ ** so a bundle file which is overwritten in place (cp) never changes the loaded one, it is reloaded when the copy
+ ** is finished, the read which overlaps a write is rejected and the previous bundle is kept
+ **/
+#define BUNDLE_MAGIC            "QJSB"
+#define BUNDLE_FORMAT_VERSION   1
+#define BUNDLE_DATA_ALIGN       8
+
+typedef struct {
+    char                    magic[4];
+    uint32_t                version;
+    uint32_t                count;
+    uint32_t                reserved;
+} bundle_header_t;
+
+typedef struct {
+    uint32_t                name_offset;
+    uint32_t                name_len;
+    uint32_t                data_offset;
+    uint32_t                data_len;
+} bundle_index_entry_t;
+
+typedef struct bundle_s {
+    char                    *path;
+    uint8_t                 *data;
+    size_t                  size;
+    uint32_t                count;
+    uint32_t                refs;
+    uint32_t                generation;
+    uint64_t                hits;
+    uint8_t                 fl_dead;
+    switch_time_t           loaded;
+    switch_hash_t           *names;         // name => bundle_index_entry_t
+    struct bundle_s         *next;
+} bundle_t;
+
+static struct {
+    switch_mutex_t          *mutex;
+    bundle_t                *head;
+    uint64_t                misses;
+} bundles;
+
+/* compiler state */
+typedef struct bundle_item_s {
+    char                    *name;
+    uint8_t                 *data;
+    size_t                  data_len;
+    struct bundle_item_s    *next;
+} bundle_item_t;
+
+typedef struct {
+    char                    *dir;
+    uint32_t                count;
+    bundle_item_t           *head;
+    bundle_item_t           *tail;
+    switch_hash_t           *names;
+} bundle_compiler_t;
+
+static void bundle_free(bundle_t *bundle) {
+    if(!bundle) {
+        return;
+    }
+    if(bundle->names) {
+        switch_core_hash_destroy(&bundle->names);
+    }
+    switch_safe_free(bundle->data);
+    switch_safe_free(bundle->path);
+    switch_safe_free(bundle);
+}
+
+/* must be called under bundles.mutex */
+static void bundle_unlink(bundle_t *bundle) {
+    bundle->fl_dead = true;
+    if(!bundle->refs) {
+        bundle_free(bundle);
+    }
+}
+
+static void bundle_release(bundle_t *bundle) {
+    switch_mutex_lock(bundles.mutex);
+    if(bundle->refs) bundle->refs--;
+    if(bundle->fl_dead && !bundle->refs) {
+        bundle_free(bundle);
+    }
+    switch_mutex_unlock(bundles.mutex);
+}
+
+/**
+ ** returns the bundle (with a taken ref) which contains the name
+ **/
+static bundle_t *bundle_take(const char *name, bundle_index_entry_t **entry) {
+    bundle_t *bundle = NULL;
+
+    switch_mutex_lock(bundles.mutex);
+    for(bundle = bundles.head; bundle; bundle = bundle->next) {
+        if((*entry = switch_core_hash_find(bundle->names, name))) {
+            bundle->refs++;
+            bundle->hits++;
+            break;
+        }
+    }
+    if(!bundle) {
+        bundles.misses++;
+    }
+    switch_mutex_unlock(bundles.mutex);
+
+    return bundle;
+}
+
+static bundle_t *bundle_open(const char *path) {
+    bundle_t *bundle = NULL;
+    bundle_header_t *hdr = NULL;
+    bundle_index_entry_t *idx = NULL;
+    struct stat st = { 0 }, st2 = { 0 };
+    uint8_t *data = NULL;
+    size_t rd = 0;
+    ssize_t n = 0;
+    int fd = -1;
+
+    if((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to open bundle (%s): %s\n", path, strerror(errno));
+        goto fail;
+    }
+    if(fstat(fd, &st) != 0 || st.st_size < sizeof(bundle_header_t)) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Malformed bundle (%s)\n", path);
+        goto fail;
+    }
+    if(!(data = malloc(st.st_size))) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "malloc()\n");
+        goto fail;
+    }
+    while(rd < (size_t)st.st_size) {
+        if((n = read(fd, data + rd, st.st_size - rd)) <= 0) {
+            if(n < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        rd += n;
+    }
+    /* the file was changed while it was being read (cp truncates and rewrites it in place) */
+    if(rd != (size_t)st.st_size || fstat(fd, &st2) != 0 || st2.st_size != st.st_size || st2.st_mtime != st.st_mtime) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Bundle is being written (%s), skipped\n", path);
+        goto fail;
+    }
+    close(fd);
+    fd = -1;
+
+    hdr = (bundle_header_t *)data;
+    if(memcmp(hdr->magic, BUNDLE_MAGIC, 4) || hdr->version != BUNDLE_FORMAT_VERSION) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unsupported bundle format (%s)\n", path);
+        goto fail;
+    }
+    if(((uint64_t)hdr->count * sizeof(bundle_index_entry_t)) > (st.st_size - sizeof(bundle_header_t))) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Malformed bundle (%s)\n", path);
+        goto fail;
+    }
+
+    switch_zmalloc(bundle, sizeof(bundle_t));
+    bundle->path = strdup(path);
+    bundle->data = data;
+    bundle->size = st.st_size;
+    bundle->count = hdr->count;
+    bundle->loaded = switch_micro_time_now();
+    switch_core_hash_init(&bundle->names);
+
+    idx = (bundle_index_entry_t *)(bundle->data + sizeof(bundle_header_t));
+    for(uint32_t i = 0; i < bundle->count; i++) {
+        if(((uint64_t)idx[i].name_offset + idx[i].name_len) >= bundle->size || ((uint64_t)idx[i].data_offset + idx[i].data_len) > bundle->size) {
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Malformed bundle (%s)\n", path);
+            goto fail;
+        }
+        if(bundle->data[idx[i].name_offset + idx[i].name_len] != '\0') {
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Malformed bundle (%s)\n", path);
+            goto fail;
+        }
+        switch_core_hash_insert(bundle->names, (char *)(bundle->data + idx[i].name_offset), &idx[i]);
+    }
+
+    return bundle;
+fail:
+    if(fd >= 0) {
+        close(fd);
+    }
+    if(bundle) {
+        bundle_free(bundle);
+    } else {
+        switch_safe_free(data);
+    }
+    return NULL;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// compiler
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+static int bundle_native_module_init(JSContext *ctx, JSModuleDef *m) {
+    return 0;
+}
+
+/**
+ ** compiles the module and adds it into the bundle
+ ** mod_val (optional) gets the module value, otherwise it's owned by the context
+ **/
+static JSModuleDef *bundle_compile_module(JSContext *ctx, bundle_compiler_t *bc, const char *name, JSValue *mod_val) {
+    JSModuleDef *m = NULL;
+    JSValue func_val = JS_UNDEFINED;
+    bundle_item_t *item = NULL;
+    char *path = NULL;
+    uint8_t *buf = NULL, *bcode = NULL;
+    size_t buf_len = 0, bcode_len = 0;
+
+    path = (name[0] == '/' ? strdup(name) : switch_mprintf("%s%s%s", bc->dir, SWITCH_PATH_SEPARATOR, name));
+    if(!(buf = js_load_file(ctx, &buf_len, path))) {
+        JS_ThrowReferenceError(ctx, "Unable to load '%s'", path);
+        goto out;
+    }
+
+    func_val = JS_Eval(ctx, (char *)buf, buf_len, name, JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+    js_free(ctx, buf);
+    if(JS_IsException(func_val)) {
+        goto out;
+    }
+
+    if(!(bcode = JS_WriteObject(ctx, &bcode_len, func_val, JS_WRITE_OBJ_BYTECODE))) {
+        JS_FreeValue(ctx, func_val);
+        goto out;
+    }
+
+    switch_zmalloc(item, sizeof(bundle_item_t));
+    switch_malloc(item->data, bcode_len);
+    memcpy(item->data, bcode, bcode_len);
+    js_free(ctx, bcode);
+
+    item->name = strdup(name);
+    item->data_len = bcode_len;
+
+    if(bc->tail) {
+        bc->tail->next = item;
+    } else {
+        bc->head = item;
+    }
+    bc->tail = item;
+    bc->count++;
+    switch_core_hash_insert(bc->names, item->name, item);
+
+    m = JS_VALUE_GET_PTR(func_val);
+    if(mod_val) {
+        *mod_val = func_val;
+    } else {
+        JS_FreeValue(ctx, func_val);
+    }
+out:
+    switch_safe_free(path);
+    return m;
+}
+
+static JSModuleDef *bundle_compiler_loader(JSContext *ctx, const char *module_name, void *opaque) {
+    bundle_compiler_t *bc = (bundle_compiler_t *)opaque;
+
+    /* native modules are loaded on the target node */
+    if(has_suffix(module_name, ".so") || !strcasecmp(module_name, "std") || !strcasecmp(module_name, "os")) {
+        return JS_NewCModule(ctx, module_name, bundle_native_module_init);
+    }
+
+    return bundle_compile_module(ctx, bc, module_name, NULL);
+}
+
+/**
+ ** compiles the entry and its imports
+ **/
+static switch_status_t bundle_compile_entry(JSContext *ctx, bundle_compiler_t *bc, const char *name) {
+    JSValue mod_val = JS_UNDEFINED;
+
+    if(switch_core_hash_find(bc->names, name)) {
+        return SWITCH_STATUS_SUCCESS;
+    }
+    if(!bundle_compile_module(ctx, bc, name, &mod_val)) {
+        return SWITCH_STATUS_FALSE;
+    }
+
+    if(JS_ResolveModule(ctx, mod_val) < 0) {
+        JS_FreeValue(ctx, mod_val);
+        return SWITCH_STATUS_FALSE;
+    }
+    JS_FreeValue(ctx, mod_val);
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t bundle_compiler_write(bundle_compiler_t *bc, const char *out_path) {
+    switch_status_t status = SWITCH_STATUS_SUCCESS;
+    bundle_header_t hdr = { 0 };
+    bundle_index_entry_t *idx = NULL;
+    bundle_item_t *item = NULL;
+    char *tmp_path = NULL;
+    FILE *fp = NULL;
+    uint32_t names_len = 0, offset = 0, i = 0;
+    static const uint8_t zeros[BUNDLE_DATA_ALIGN] = { 0 };
+
+    switch_zmalloc(idx, sizeof(bundle_index_entry_t) * (bc->count ? bc->count : 1));
+
+    offset = sizeof(bundle_header_t) + (sizeof(bundle_index_entry_t) * bc->count);
+    for(item = bc->head, i = 0; item; item = item->next, i++) {
+        idx[i].name_offset = offset + names_len;
+        idx[i].name_len = strlen(item->name);
+        names_len += idx[i].name_len + 1;
+    }
+
+    offset += names_len;
+    for(item = bc->head, i = 0; item; item = item->next, i++) {
+        offset = (offset + (BUNDLE_DATA_ALIGN - 1)) & ~(BUNDLE_DATA_ALIGN - 1);
+        idx[i].data_offset = offset;
+        idx[i].data_len = item->data_len;
+        offset += item->data_len;
+    }
+
+    memcpy(hdr.magic, BUNDLE_MAGIC, 4);
+    hdr.version = BUNDLE_FORMAT_VERSION;
+    hdr.count = bc->count;
+
+    /* write a temporary file and rename it, so a bundle is replaced atomically */
+    tmp_path = switch_mprintf("%s.tmp", out_path);
+    if(!(fp = fopen(tmp_path, "wb"))) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to create file (%s): %s\n", tmp_path, strerror(errno));
+        switch_goto_status(SWITCH_STATUS_FALSE, out);
+    }
+
+    offset = 0;
+    offset += fwrite(&hdr, 1, sizeof(hdr), fp);
+    offset += fwrite(idx, 1, sizeof(bundle_index_entry_t) * bc->count, fp);
+    for(item = bc->head; item; item = item->next) {
+        offset += fwrite(item->name, 1, strlen(item->name) + 1, fp);
+    }
+    for(item = bc->head, i = 0; item; item = item->next, i++) {
+        if(offset < idx[i].data_offset) {
+            offset += fwrite(zeros, 1, idx[i].data_offset - offset, fp);
+        }
+        offset += fwrite(item->data, 1, item->data_len, fp);
+    }
+
+    if(ferror(fp) | fclose(fp)) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to write file (%s)\n", tmp_path);
+        unlink(tmp_path);
+        switch_goto_status(SWITCH_STATUS_FALSE, out);
+    }
+    if(rename(tmp_path, out_path) != 0) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to rename file (%s): %s\n", tmp_path, strerror(errno));
+        unlink(tmp_path);
+        switch_goto_status(SWITCH_STATUS_FALSE, out);
+    }
+
+out:
+    switch_safe_free(tmp_path);
+    switch_safe_free(idx);
+    return status;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+switch_status_t bundle_init(switch_memory_pool_t *pool) {
+    memset(&bundles, 0, sizeof(bundles));
+
+    switch_mutex_init(&bundles.mutex, SWITCH_MUTEX_NESTED, pool);
+
+    if(!zstr(globals.cfg_bundles)) {
+        bundle_reload();
+    }
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+/**
+ ** should be called after all scripts were finished
+ **/
+void bundle_shutdown() {
+    bundle_t *bundle = NULL;
+
+    switch_mutex_lock(bundles.mutex);
+    while(bundles.head) {
+        bundle = bundles.head;
+        bundles.head = bundle->next;
+        bundle_unlink(bundle);
+    }
+    switch_mutex_unlock(bundles.mutex);
+}
+
+/**
+ ** (re)reads the configured bundles, the scripts which are loading now keep the previous ones,
+ ** a bundle which can't be read now (being written) stays as it was
+ **/
+switch_status_t bundle_reload() {
+    char *paths_local = NULL, *argv[32] = { 0 }, *failed[32] = { 0 };
+    bundle_t *head = NULL, *tail = NULL, *bundle = NULL, *old = NULL, *next = NULL;
+    int argc = 0, loaded = 0, failed_count = 0;
+
+    if(zstr(globals.cfg_bundles)) {
+        return SWITCH_STATUS_FALSE;
+    }
+
+    paths_local = strdup(globals.cfg_bundles);
+    argc = switch_separate_string(paths_local, ';', argv, ARRAY_SIZE(argv));
+
+    for(int i = 0; i < argc; i++) {
+        char *path = NULL;
+
+        if(zstr(argv[i])) {
+            continue;
+        }
+
+        path = (argv[i][0] == '/' ? strdup(argv[i]) : switch_mprintf("%s%s%s", SWITCH_GLOBAL_dirs.script_dir, SWITCH_PATH_SEPARATOR, argv[i]));
+        if((bundle = bundle_open(path))) {
+            if(tail) { tail->next = bundle; } else { head = bundle; }
+            tail = bundle;
+            loaded++;
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Bundle loaded (%s) [%u entries]\n", path, bundle->count);
+            switch_safe_free(path);
+        } else {
+            failed[failed_count++] = path;
+        }
+    }
+
+    switch_mutex_lock(bundles.mutex);
+    for(bundle = head; bundle; bundle = bundle->next) {
+        bundle->generation = 1;
+        for(old = bundles.head; old; old = old->next) {
+            if(!strcmp(old->path, bundle->path)) {
+                bundle->generation = old->generation + 1;
+                break;
+            }
+        }
+    }
+    for(old = bundles.head; old; old = next) {
+        int i = 0;
+
+        next = old->next;
+        for(i = 0; i < failed_count; i++) {
+            if(!strcmp(old->path, failed[i])) {
+                break;
+            }
+        }
+        if(i < failed_count) {
+            old->next = NULL;
+            if(tail) { tail->next = old; } else { head = old; }
+            tail = old;
+            loaded++;
+        } else {
+            bundle_unlink(old);
+        }
+    }
+    bundles.head = head;
+    switch_mutex_unlock(bundles.mutex);
+
+    for(int i = 0; i < failed_count; i++) {
+        switch_safe_free(failed[i]);
+    }
+    switch_safe_free(paths_local);
+    return (loaded ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE);
+}
+
+uint8_t bundle_exists(const char *name) {
+    uint8_t found = false;
+
+    if(zstr(name) || !bundles.mutex) {
+        return false;
+    }
+
+    switch_mutex_lock(bundles.mutex);
+    for(bundle_t *bundle = bundles.head; bundle && !found; bundle = bundle->next) {
+        found = (switch_core_hash_find(bundle->names, name) != NULL);
+    }
+    switch_mutex_unlock(bundles.mutex);
+
+    return found;
+}
+
+/**
+ ** returns compiled (not evaluated) script or module from the bundles
+ ** or JS_UNDEFINED when the name isn't found in any of them
+ **/
+JSValue bundle_load(JSContext *ctx, const char *name, bcache_info_t *info) {
+    bundle_index_entry_t *entry = NULL;
+    bundle_t *bundle = NULL;
+    JSValue func_val = JS_UNDEFINED;
+
+    if(zstr(name) || !bundles.head) {
+        return JS_UNDEFINED;
+    }
+    if(!(bundle = bundle_take(name, &entry))) {
+        return JS_UNDEFINED;
+    }
+
+    func_val = JS_ReadObject(ctx, bundle->data + entry->data_offset, entry->data_len, JS_READ_OBJ_BYTECODE);
+    if(info) {
+        info->version = bundle->generation;
+        info->loaded = bundle->loaded;
+    }
+
+    bundle_release(bundle);
+    return func_val;
+}
+
+/**
+ ** compiles the entry script (or all scripts in the directory) with imported modules into a bundle
+ **/
+switch_status_t bundle_compile(const char *dir, const char *out_path, const char *entry, switch_stream_handle_t *stream) {
+    switch_status_t status = SWITCH_STATUS_SUCCESS;
+    bundle_compiler_t bc = { 0 };
+    bundle_item_t *item = NULL;
+    switch_memory_pool_t *pool = NULL;
+    switch_dir_t *dh = NULL;
+    JSRuntime *rt = NULL;
+    JSContext *ctx = NULL;
+
+    if(zstr(dir) || zstr(out_path)) {
+        return SWITCH_STATUS_FALSE;
+    }
+
+    bc.dir = (char *)dir;
+    switch_core_hash_init(&bc.names);
+
+    if(!(rt = JS_NewRuntime()) || !(ctx = JS_NewContext(rt))) {
+        stream->write_function(stream, "-ERR: unable to create runtime\n");
+        switch_goto_status(SWITCH_STATUS_FALSE, out);
+    }
+    JS_SetModuleLoaderFunc(rt, NULL, bundle_compiler_loader, &bc);
+
+    if(!zstr(entry)) {
+        status = bundle_compile_entry(ctx, &bc, entry);
+    } else {
+        char buf[1024] = { 0 };
+        const char *fname = NULL;
+
+        if(switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+            switch_goto_status(SWITCH_STATUS_MEMERR, out);
+        }
+        if(switch_dir_open(&dh, dir, pool) != SWITCH_STATUS_SUCCESS) {
+            stream->write_function(stream, "-ERR: unable to open directory (%s)\n", dir);
+            switch_goto_status(SWITCH_STATUS_FALSE, out);
+        }
+        while((fname = switch_dir_next_file(dh, buf, sizeof(buf)))) {
+            if(has_suffix(fname, ".js") && (status = bundle_compile_entry(ctx, &bc, fname)) != SWITCH_STATUS_SUCCESS) {
+                break;
+            }
+        }
+    }
+
+    if(status != SWITCH_STATUS_SUCCESS) {
+        js_ctx_dump_error(NULL, ctx);
+        stream->write_function(stream, "-ERR: compilation failed (see log)\n");
+        goto out;
+    }
+    if(!bc.count) {
+        stream->write_function(stream, "-ERR: nothing to compile\n");
+        switch_goto_status(SWITCH_STATUS_FALSE, out);
+    }
+    if((status = bundle_compiler_write(&bc, out_path)) != SWITCH_STATUS_SUCCESS) {
+        stream->write_function(stream, "-ERR: unable to write bundle (see log)\n");
+        goto out;
+    }
+
+    stream->write_function(stream, "+OK: %u modules\n", bc.count);
+
+out:
+    if(dh) {
+        switch_dir_close(dh);
+    }
+    if(pool) {
+        switch_core_destroy_memory_pool(&pool);
+    }
+    if(ctx) {
+        JS_FreeContext(ctx);
+    }
+    if(rt) {
+        JS_FreeRuntime(rt);
+    }
+    while(bc.head) {
+        item = bc.head;
+        bc.head = item->next;
+        switch_safe_free(item->name);
+        switch_safe_free(item->data);
+        switch_safe_free(item);
+    }
+    switch_core_hash_destroy(&bc.names);
+    return status;
+}
+
+void bundle_stats(switch_stream_handle_t *stream) {
+    switch_time_exp_t tm = { 0 };
+    switch_size_t retsize = 0;
+    char loaded[64] = { 0 };
+
+    switch_mutex_lock(bundles.mutex);
+    for(bundle_t *bundle = bundles.head; bundle; bundle = bundle->next) {
+        switch_time_exp_lt(&tm, bundle->loaded);
+        switch_strftime_nocheck(loaded, &retsize, sizeof(loaded), "%Y-%m-%d %H:%M:%S", &tm);
+
+        stream->write_function(stream, "%s [entries: %u, size: %"SWITCH_SIZE_T_FMT", version: %u, loaded: %s, hits: %"SWITCH_UINT64_T_FMT"]\n",
+                               bundle->path, bundle->count, bundle->size, bundle->generation, loaded, bundle->hits);
+    }
+    stream->write_function(stream, "misses: %"SWITCH_UINT64_T_FMT"\n", bundles.misses);
+    switch_mutex_unlock(bundles.mutex);
+}
@@ -0,0 +1,596 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+
+extern globals_t globals;
+
+#define EVLOOP_QUEUE_SIZE       4096
+#define EVLOOP_WAIT_MAX_US      1000000
+#define EVLOOP_TIMERS_GROW      16
+#define EVLOOP_IDLE_GC_US       5000000
+
+typedef struct {
+    uint32_t                id;
+    uint32_t                interval;   // ms, 0 - once
+    uint8_t                 fl_cancelled;
+    switch_time_t           expires;
+    JSValue                 func;
+    int                     argc;
+    JSValue                 *argv;
+} evloop_timer_t;
+
+typedef struct evloop_pending_s {
+    uint32_t                id;
+    JSValue                 resolving_funcs[2];
+    struct evloop_pending_s *next;
+} evloop_pending_t;
+
+typedef struct evloop_completion_s {
+    uint32_t                id;
+    void                    *data;
+    evloop_result_func_t    *result_func;
+    evloop_free_func_t      *free_func;
+    struct evloop_completion_s *next;
+} evloop_completion_t;
+
+struct evloop_s {
+    switch_queue_t          *completions;
+    switch_mutex_t          *overflow_mutex;
+    evloop_completion_t     *overflow_head;     // completions which didn't fit into the queue (in order)
+    evloop_completion_t     *overflow_tail;
+    uint32_t                posted;             // tasks posted and not handled yet (atomic)
+    evloop_timer_t          **timers;       // min-heap by expires
+    evloop_timer_t          *firing;
+    uint32_t                timers_count;
+    uint32_t                timers_size;
+    uint32_t                timers_seq;
+    evloop_pending_t        *pending;
+    uint32_t                pending_count;
+    uint32_t                pending_seq;
+    uint32_t                refs;           // keep the loop running while there is nothing to wait for
+    switch_time_t           gc_time;
+    uint8_t                 fl_gc_dirty;        // js code was executed since the last gc
+};
+
+static evloop_completion_t evloop_wakeup_marker;
+
+static evloop_t *evloop_from_ctx(JSContext *ctx) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    return (script ? script->evloop : NULL);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// timers heap
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+static inline int evloop_timer_before(evloop_timer_t *a, evloop_timer_t *b) {
+    return (a->expires < b->expires || (a->expires == b->expires && a->id < b->id));
+}
+
+static void evloop_heap_swap(evloop_t *evloop, uint32_t a, uint32_t b) {
+    evloop_timer_t *t = evloop->timers[a];
+    evloop->timers[a] = evloop->timers[b];
+    evloop->timers[b] = t;
+}
+
+static void evloop_heap_up(evloop_t *evloop, uint32_t idx) {
+    while(idx > 0) {
+        uint32_t parent = (idx - 1) / 2;
+        if(!evloop_timer_before(evloop->timers[idx], evloop->timers[parent])) {
+            break;
+        }
+        evloop_heap_swap(evloop, idx, parent);
+        idx = parent;
+    }
+}
+
+static void evloop_heap_down(evloop_t *evloop, uint32_t idx) {
+    while(true) {
+        uint32_t l = (idx * 2) + 1, r = l + 1, min = idx;
+
+        if(l < evloop->timers_count && evloop_timer_before(evloop->timers[l], evloop->timers[min])) min = l;
+        if(r < evloop->timers_count && evloop_timer_before(evloop->timers[r], evloop->timers[min])) min = r;
+        if(min == idx) {
+            break;
+        }
+        evloop_heap_swap(evloop, idx, min);
+        idx = min;
+    }
+}
+
+static switch_status_t evloop_heap_push(evloop_t *evloop, evloop_timer_t *timer) {
+    if(evloop->timers_count == evloop->timers_size) {
+        uint32_t nsize = evloop->timers_size + EVLOOP_TIMERS_GROW;
+        evloop_timer_t **tmp = realloc(evloop->timers, nsize * sizeof(evloop_timer_t *));
+
+        if(!tmp) {
+            return SWITCH_STATUS_MEMERR;
+        }
+        evloop->timers = tmp;
+        evloop->timers_size = nsize;
+    }
+
+    evloop->timers[evloop->timers_count] = timer;
+    evloop_heap_up(evloop, evloop->timers_count);
+    evloop->timers_count++;
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+static evloop_timer_t *evloop_heap_remove(evloop_t *evloop, uint32_t idx) {
+    evloop_timer_t *timer = evloop->timers[idx];
+
+    evloop->timers_count--;
+    if(idx != evloop->timers_count) {
+        evloop->timers[idx] = evloop->timers[evloop->timers_count];
+        evloop_heap_down(evloop, idx);
+        evloop_heap_up(evloop, idx);
+    }
+
+    return timer;
+}
+
+static void evloop_timer_free(JSContext *ctx, evloop_timer_t *timer) {
+    if(!timer) {
+        return;
+    }
+    JS_FreeValue(ctx, timer->func);
+    for(int i = 0; i < timer->argc; i++) {
+        JS_FreeValue(ctx, timer->argv[i]);
+    }
+    js_free(ctx, timer->argv);
+    js_free(ctx, timer);
+}
+
+static uint8_t evloop_timer_cancel(JSContext *ctx, evloop_t *evloop, uint32_t id) {
+    if(evloop->firing && evloop->firing->id == id) {
+        evloop->firing->fl_cancelled = true;
+        return true;
+    }
+    for(uint32_t i = 0; i < evloop->timers_count; i++) {
+        if(evloop->timers[i]->id == id) {
+            evloop_timer_free(ctx, evloop_heap_remove(evloop, i));
+            return true;
+        }
+    }
+    return false;
+}
+
+static void evloop_timers_fire(evloop_t *evloop, JSContext *ctx) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    switch_time_t now = switch_micro_time_now();
+    evloop_timer_t *timer = NULL;
+    JSValue ret_val;
+
+    while(evloop->timers_count && evloop->timers[0]->expires <= now) {
+        timer = evloop_heap_remove(evloop, 0);
+        evloop->fl_gc_dirty = true;
+
+        evloop->firing = timer;
+        ret_val = JS_Call(ctx, timer->func, JS_UNDEFINED, timer->argc, (JSValueConst *)timer->argv);
+        evloop->firing = NULL;
+
+        if(JS_IsException(ret_val)) {
+            js_ctx_dump_error(script, ctx);
+        }
+        JS_FreeValue(ctx, ret_val);
+
+        if(timer->interval && !timer->fl_cancelled) {
+            timer->expires = now + ((switch_time_t)timer->interval * 1000);
+            if(evloop_heap_push(evloop, timer) == SWITCH_STATUS_SUCCESS) {
+                continue;
+            }
+        }
+        evloop_timer_free(ctx, timer);
+
+        if(script->fl_exit || script->fl_interrupt) {
+            break;
+        }
+    }
+}
+
+// setTimeout(func, delayMsec, [args...]) / setInterval(func, delayMsec, [args...])
+static JSValue js_set_timer(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic) {
+    evloop_t *evloop = evloop_from_ctx(ctx);
+    evloop_timer_t *timer = NULL;
+    int64_t delay = 0;
+
+    if(!evloop) {
+        return JS_ThrowTypeError(ctx, "Event loop is not available");
+    }
+    if(argc < 1 || !JS_IsFunction(ctx, argv[0])) {
+        return JS_ThrowTypeError(ctx, "%s(func, delay, [args])", (magic ? "setInterval" : "setTimeout"));
+    }
+    if(argc > 1 && JS_ToInt64(ctx, &delay, argv[1])) {
+        return JS_EXCEPTION;
+    }
+    if(delay < 0) {
+        delay = 0;
+    }
+
+    timer = js_mallocz(ctx, sizeof(evloop_timer_t));
+    if(!timer) {
+        return JS_EXCEPTION;
+    }
+
+    if(argc > 2) {
+        timer->argv = js_mallocz(ctx, sizeof(JSValue) * (argc - 2));
+        if(!timer->argv) {
+            js_free(ctx, timer);
+            return JS_EXCEPTION;
+        }
+        for(int i = 2; i < argc; i++) {
+            timer->argv[timer->argc++] = JS_DupValue(ctx, argv[i]);
+        }
+    }
+
+    timer->id = ++evloop->timers_seq;
+    timer->func = JS_DupValue(ctx, argv[0]);
+    timer->interval = (magic ? (delay > 0 ? (uint32_t)delay : 1) : 0);
+    timer->expires = switch_micro_time_now() + (delay * 1000);
+
+    if(evloop_heap_push(evloop, timer) != SWITCH_STATUS_SUCCESS) {
+        evloop_timer_free(ctx, timer);
+        return JS_ThrowInternalError(ctx, "Unable to add timer");
+    }
+
+    return JS_NewUint32(ctx, timer->id);
+}
+
+// clearTimeout(id) / clearInterval(id)
+static JSValue js_clear_timer(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    evloop_t *evloop = evloop_from_ctx(ctx);
+    uint32_t id = 0;
+
+    if(!evloop || argc < 1 || QJS_IS_NULL(argv[0])) {
+        return JS_FALSE;
+    }
+    if(JS_ToUint32(ctx, &id, argv[0])) {
+        return JS_EXCEPTION;
+    }
+
+    return (evloop_timer_cancel(ctx, evloop, id) ? JS_TRUE : JS_FALSE);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// completions
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+static void evloop_completion_free(evloop_completion_t *completion) {
+    if(!completion || completion == &evloop_wakeup_marker) {
+        return;
+    }
+    if(completion->free_func && completion->data) {
+        completion->free_func(completion->data);
+    }
+    switch_safe_free(completion);
+}
+
+static void evloop_completion_handle(evloop_t *evloop, JSContext *ctx, evloop_completion_t *completion) {
+    evloop_pending_t *pending = NULL, *prev = NULL;
+    JSValue result, ret_val;
+    uint8_t fl_reject = false;
+
+    if(completion == &evloop_wakeup_marker) {
+        return;
+    }
+
+    /* posted task, isn't bound to a promise */
+    if(!completion->id) {
+        __atomic_sub_fetch(&evloop->posted, 1, __ATOMIC_SEQ_CST);
+        evloop->fl_gc_dirty = true;
+        if(completion->result_func) {
+            ret_val = completion->result_func(ctx, completion->data);
+            if(JS_IsException(ret_val)) {
+                js_ctx_dump_error(JS_GetContextOpaque(ctx), ctx);
+            }
+            JS_FreeValue(ctx, ret_val);
+        }
+        evloop_completion_free(completion);
+        return;
+    }
+
+    for(pending = evloop->pending; pending; prev = pending, pending = pending->next) {
+        if(pending->id == completion->id) {
+            if(prev) { prev->next = pending->next; } else { evloop->pending = pending->next; }
+            evloop->pending_count--;
+            break;
+        }
+    }
+
+    if(pending) {
+        evloop->fl_gc_dirty = true;
+        result = (completion->result_func ? completion->result_func(ctx, completion->data) : JS_UNDEFINED);
+        if(JS_IsException(result)) {
+            result = JS_GetException(ctx);
+            fl_reject = true;
+        }
+
+        ret_val = JS_Call(ctx, pending->resolving_funcs[fl_reject ? 1 : 0], JS_UNDEFINED, 1, (JSValueConst *)&result);
+        JS_FreeValue(ctx, ret_val);
+        JS_FreeValue(ctx, result);
+
+        JS_FreeValue(ctx, pending->resolving_funcs[0]);
+        JS_FreeValue(ctx, pending->resolving_funcs[1]);
+        js_free(ctx, pending);
+    }
+
+    evloop_completion_free(completion);
+}
+
+/* takes the completions which didn't fit into the queue, they are handled after the queued ones */
+static evloop_completion_t *evloop_overflow_take(evloop_t *evloop) {
+    evloop_completion_t *list = NULL;
+
+    switch_mutex_lock(evloop->overflow_mutex);
+    list = evloop->overflow_head;
+    evloop->overflow_tail = NULL;
+    __atomic_store_n(&evloop->overflow_head, NULL, __ATOMIC_SEQ_CST);
+    switch_mutex_unlock(evloop->overflow_mutex);
+
+    return list;
+}
+
+static void evloop_rejection_tracker(JSContext *ctx, JSValueConst promise, JSValueConst reason, BOOL is_handled, void *opaque) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    const char *str = NULL;
+
+    if(is_handled || (script && script->fl_exit)) {
+        return;
+    }
+
+    str = JS_ToCString(ctx, reason);
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "QJS [%s]: Possibly unhandled promise rejection: %s\n", (script ? script->name : "?"), (str ? str : "[no error message]"));
+    JS_FreeCString(ctx, str);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+switch_status_t evloop_create(evloop_t **evloop, switch_memory_pool_t *pool) {
+    evloop_t *evloop_local = NULL;
+
+    if(!(evloop_local = switch_core_alloc(pool, sizeof(evloop_t)))) {
+        return SWITCH_STATUS_MEMERR;
+    }
+    if(switch_queue_create(&evloop_local->completions, EVLOOP_QUEUE_SIZE, pool) != SWITCH_STATUS_SUCCESS) {
+        return SWITCH_STATUS_GENERR;
+    }
+    if(switch_mutex_init(&evloop_local->overflow_mutex, SWITCH_MUTEX_NESTED, pool) != SWITCH_STATUS_SUCCESS) {
+        return SWITCH_STATUS_GENERR;
+    }
+
+    *evloop = evloop_local;
+    return SWITCH_STATUS_SUCCESS;
+}
+
+/**
+ ** drops timers and unresolved promises, must be called before the context is destroyed
+ **/
+void evloop_clear(evloop_t *evloop, JSContext *ctx) {
+    evloop_pending_t *pending = NULL;
+
+    if(!evloop) {
+        return;
+    }
+
+    while(evloop->timers_count) {
+        evloop_timer_free(ctx, evloop_heap_remove(evloop, evloop->timers_count - 1));
+    }
+    switch_safe_free(evloop->timers);
+    evloop->timers_size = 0;
+
+    while((pending = evloop->pending)) {
+        evloop->pending = pending->next;
+        JS_FreeValue(ctx, pending->resolving_funcs[0]);
+        JS_FreeValue(ctx, pending->resolving_funcs[1]);
+        js_free(ctx, pending);
+    }
+    evloop->pending_count = 0;
+}
+
+/**
+ ** frees completions which were posted after the loop had finished
+ ** must be called when no more producers can refer to the loop
+ **/
+void evloop_destroy(evloop_t **evloop) {
+    evloop_t *evloop_local = *evloop;
+    evloop_completion_t *completion = NULL, *next = NULL;
+    void *pop = NULL;
+
+    if(!evloop_local) {
+        return;
+    }
+
+    while(switch_queue_trypop(evloop_local->completions, &pop) == SWITCH_STATUS_SUCCESS) {
+        evloop_completion_free((evloop_completion_t *)pop);
+    }
+    for(completion = evloop_overflow_take(evloop_local); completion; completion = next) {
+        next = completion->next;
+        evloop_completion_free(completion);
+    }
+    switch_queue_term(evloop_local->completions);
+
+    *evloop = NULL;
+}
+
+void evloop_register_globals(JSContext *ctx, JSValue global_obj) {
+    JS_SetHostPromiseRejectionTracker(JS_GetRuntime(ctx), evloop_rejection_tracker, NULL);
+
+    JS_SetPropertyStr(ctx, global_obj, "setTimeout", JS_NewCFunctionMagic(ctx, js_set_timer, "setTimeout", 2, JS_CFUNC_generic_magic, 0));
+    JS_SetPropertyStr(ctx, global_obj, "setInterval", JS_NewCFunctionMagic(ctx, js_set_timer, "setInterval", 2, JS_CFUNC_generic_magic, 1));
+    JS_SetPropertyStr(ctx, global_obj, "clearTimeout", JS_NewCFunction(ctx, js_clear_timer, "clearTimeout", 1));
+    JS_SetPropertyStr(ctx, global_obj, "clearInterval", JS_NewCFunction(ctx, js_clear_timer, "clearInterval", 1));
+}
+
+/**
+ ** returns a new promise which is settled when the native side calls evloop_complete() with the same id
+ **/
+JSValue evloop_promise_new(JSContext *ctx, evloop_t **evloop, uint32_t *id) {
+    evloop_t *evloop_local = evloop_from_ctx(ctx);
+    evloop_pending_t *pending = NULL;
+    JSValue promise;
+
+    if(!evloop_local) {
+        return JS_ThrowTypeError(ctx, "Event loop is not available");
+    }
+
+    pending = js_mallocz(ctx, sizeof(evloop_pending_t));
+    if(!pending) {
+        return JS_EXCEPTION;
+    }
+
+    promise = JS_NewPromiseCapability(ctx, pending->resolving_funcs);
+    if(JS_IsException(promise)) {
+        js_free(ctx, pending);
+        return promise;
+    }
+
+    pending->id = ++evloop_local->pending_seq;
+    if(!pending->id) {
+        pending->id = ++evloop_local->pending_seq;
+    }
+    pending->next = evloop_local->pending;
+    evloop_local->pending = pending;
+    evloop_local->pending_count++;
+
+    *evloop = evloop_local;
+    *id = pending->id;
+
+    return promise;
+}
+
+/**
+ ** can be called from any thread
+ ** the data is always released by free_func (when it is given)
+ ** when the queue is full the completion goes to the overflow list, so a promise is never left pending,
+ ** the list takes everything until the loop has taken it, so the queue holds only the older completions
+ **/
+switch_status_t evloop_complete(evloop_t *evloop, uint32_t id, void *data, evloop_result_func_t *result_func, evloop_free_func_t *free_func) {
+    evloop_completion_t *completion = NULL;
+
+    switch_assert(evloop);
+
+    switch_zmalloc(completion, sizeof(evloop_completion_t));
+    completion->id = id;
+    completion->data = data;
+    completion->result_func = result_func;
+    completion->free_func = free_func;
+
+    if(!id) {
+        __atomic_add_fetch(&evloop->posted, 1, __ATOMIC_SEQ_CST);
+    }
+
+    if(__atomic_load_n(&evloop->overflow_head, __ATOMIC_SEQ_CST) || switch_queue_trypush(evloop->completions, completion) != SWITCH_STATUS_SUCCESS) {
+        /* the queue isn't empty, so the loop is going to wake up and take the list as well */
+        switch_mutex_lock(evloop->overflow_mutex);
+        if(evloop->overflow_tail) { evloop->overflow_tail->next = completion; } else { __atomic_store_n(&evloop->overflow_head, completion, __ATOMIC_SEQ_CST); }
+        evloop->overflow_tail = completion;
+        switch_mutex_unlock(evloop->overflow_mutex);
+    }
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+/**
+ ** runs func in the loop (script thread), can be called from any thread
+ ** the data is always released by free_func (when it is given), even if the loop has gone without running the task
+ **/
+switch_status_t evloop_post(evloop_t *evloop, evloop_result_func_t *func, void *data, evloop_free_func_t *free_func) {
+    return evloop_complete(evloop, 0, data, func, free_func);
+}
+
+/**
+ ** the loop doesn't finish while it's referenced (script thread only)
+ **/
+void evloop_ref(evloop_t *evloop) {
+    if(evloop) {
+        evloop->refs++;
+    }
+}
+
+void evloop_unref(evloop_t *evloop) {
+    if(evloop && evloop->refs) {
+        evloop->refs--;
+    }
+}
+
+void evloop_wakeup(evloop_t *evloop) {
+    if(evloop) {
+        switch_queue_trypush(evloop->completions, &evloop_wakeup_marker);
+    }
+}
+
+/**
+ ** runs pending jobs, timers and native completions until there is nothing to wait for
+ ** or the script is interrupted, sleeps in the queue when idle
+ **/
+void evloop_run(evloop_t *evloop, JSContext *ctx) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    JSRuntime *rt = JS_GetRuntime(ctx);
+    switch_channel_t *channel = (script->session ? switch_core_session_get_channel(script->session) : NULL);
+    JSContext *job_ctx = NULL;
+    evloop_completion_t *completion = NULL, *next = NULL;
+    switch_interval_time_t wait = 0;
+    switch_time_t now = 0;
+    void *pop = NULL;
+
+    while(true) {
+        if(globals.fl_shutdown || script->fl_exit || script_budget_exceeded(script)) {
+            break;
+        }
+        if(channel && !switch_channel_ready(channel)) {
+            break;
+        }
+
+        while(JS_IsJobPending(rt)) {
+            evloop->fl_gc_dirty = true;
+            if(JS_ExecutePendingJob(rt, &job_ctx) < 0) {
+                js_ctx_dump_error(script, job_ctx);
+            }
+            if(script->fl_exit || script->fl_interrupt) {
+                break;
+            }
+        }
+
+        evloop_timers_fire(evloop, ctx);
+
+        if(JS_IsJobPending(rt)) {
+            continue;
+        }
+        if(!evloop->timers_count && !evloop->pending_count && !evloop->refs && !__atomic_load_n(&evloop->posted, __ATOMIC_SEQ_CST)) {
+            break;
+        }
+
+        now = switch_micro_time_now();
+        wait = EVLOOP_WAIT_MAX_US;
+        if(evloop->timers_count) {
+            wait = (evloop->timers[0]->expires > now ? (evloop->timers[0]->expires - now) : 0);
+            if(wait > EVLOOP_WAIT_MAX_US) wait = EVLOOP_WAIT_MAX_US;
+        }
+
+        /* going to be idle for a while, good time to collect garbage */
+        if(wait >= 100000 && evloop->fl_gc_dirty && (now - evloop->gc_time) >= EVLOOP_IDLE_GC_US) {
+            script_gc_run(script);
+            evloop->gc_time = now;
+            evloop->fl_gc_dirty = false;
+        }
+        stats_update(script, false);
+
+        if(wait > 0) {
+            if(switch_queue_pop_timeout(evloop->completions, &pop, wait) == SWITCH_STATUS_SUCCESS) {
+                evloop_completion_handle(evloop, ctx, (evloop_completion_t *)pop);
+            }
+        }
+        while(switch_queue_trypop(evloop->completions, &pop) == SWITCH_STATUS_SUCCESS) {
+            evloop_completion_handle(evloop, ctx, (evloop_completion_t *)pop);
+        }
+        /* the list is newer than anything left in the queue */
+        if(__atomic_load_n(&evloop->overflow_head, __ATOMIC_SEQ_CST)) {
+            for(completion = evloop_overflow_take(evloop); completion; completion = next) {
+                next = completion->next;
+                evloop_completion_handle(evloop, ctx, completion);
+            }
+        }
+    }
+}
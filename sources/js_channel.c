@@ -0,0 +1,558 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "js_channel.h"
+
+extern globals_t globals;
+
+#define CLASS_NAME          "Channel"
+#define PROP_NAME           0
+#define PROP_SIZE           1
+
+#define QUEUE_MAX_LEN       100000
+#define RX_WAIT_SLICE_US    100000
+#define ORPHAN_TTL_US       (60 * 1000000)
+#define ORPHAN_REAP_BATCH   64
+
+#ifdef JS_WRITE_OBJ_REFERENCE
+ #define CHANNEL_WRITE_FLAGS    JS_WRITE_OBJ_REFERENCE
+ #define CHANNEL_READ_FLAGS     JS_READ_OBJ_REFERENCE
+#else
+ #define CHANNEL_WRITE_FLAGS    0
+ #define CHANNEL_READ_FLAGS     0
+#endif
+
+#define CHANNEL_SANITY_CHECK() if (!js_channel || !js_channel->queue) { \
+           return JS_ThrowTypeError(ctx, "Channel is closed"); \
+        }
+
+static struct {
+    switch_mutex_t          *mutex;
+    switch_hash_t           *channels;
+    switch_time_t           reap_time;
+} registry;
+
+static void js_channel_finalizer(JSRuntime *rt, JSValue val);
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+// queue: many producers (any script thread), one consumer at a time (rx_mutex)
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+static void js_channel_queue_push(js_channel_queue_t *q, js_channel_msg_t *msg) {
+    js_channel_msg_t *prev = NULL;
+
+    __atomic_store_n(&msg->next, NULL, __ATOMIC_RELAXED);
+    prev = __atomic_exchange_n(&q->head, msg, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&prev->next, msg, __ATOMIC_SEQ_CST);
+}
+
+/* must be called under rx_mutex */
+static js_channel_msg_t *js_channel_queue_pop(js_channel_queue_t *q) {
+    js_channel_msg_t *tail = q->tail;
+    js_channel_msg_t *next = __atomic_load_n(&tail->next, __ATOMIC_SEQ_CST);
+
+    if(tail == &q->stub) {
+        if(!next) {
+            return NULL;
+        }
+        q->tail = tail = next;
+        next = __atomic_load_n(&tail->next, __ATOMIC_SEQ_CST);
+    }
+    if(next) {
+        q->tail = next;
+        goto out;
+    }
+
+    /* the last one, a producer can be in the middle of push */
+    if(tail != __atomic_load_n(&q->head, __ATOMIC_SEQ_CST)) {
+        return NULL;
+    }
+    js_channel_queue_push(q, &q->stub);
+
+    if(!(next = __atomic_load_n(&tail->next, __ATOMIC_SEQ_CST))) {
+        return NULL;
+    }
+    q->tail = next;
+out:
+    __atomic_sub_fetch(&q->count, 1, __ATOMIC_SEQ_CST);
+    return tail;
+}
+
+static void js_channel_msg_free(js_channel_msg_t **msg) {
+    if(msg && *msg) {
+        switch_safe_free((*msg)->data);
+        switch_safe_free(*msg);
+    }
+}
+
+static void js_channel_queue_destroy(js_channel_queue_t *q) {
+    switch_memory_pool_t *pool = q->pool;
+    js_channel_msg_t *msg = NULL;
+
+    switch_mutex_lock(q->rx_mutex);
+    while((msg = js_channel_queue_pop(q)) != NULL) {
+        js_channel_msg_free(&msg);
+    }
+    switch_mutex_unlock(q->rx_mutex);
+
+    switch_safe_free(q);
+    switch_core_destroy_memory_pool(&pool);
+}
+
+/**
+ ** the queues without handles are kept while they have messages (a receiver can open it later),
+ ** those nobody has opened for ORPHAN_TTL_US are dropped, must be called under the registry mutex
+ **/
+static void js_channel_orphans_reap(switch_time_t now) {
+    js_channel_queue_t *reaped[ORPHAN_REAP_BATCH] = { 0 };
+    switch_hash_index_t *hidx = NULL;
+    uint32_t count = 0;
+    void *hval = NULL;
+
+    if(now < registry.reap_time) {
+        return;
+    }
+    registry.reap_time = now + 1000000;
+
+    for(hidx = switch_core_hash_first_iter(registry.channels, hidx); hidx && count < ORPHAN_REAP_BATCH; hidx = switch_core_hash_next(&hidx)) {
+        js_channel_queue_t *q = NULL;
+
+        switch_core_hash_this(hidx, NULL, NULL, &hval);
+        q = (js_channel_queue_t *)hval;
+        if(!q->refs && q->orphaned && (now - q->orphaned) >= ORPHAN_TTL_US) {
+            reaped[count++] = q;
+        }
+    }
+    switch_safe_free(hidx);
+
+    for(uint32_t i = 0; i < count; i++) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Channel '%s' wasn't opened for %us, %u messages dropped\n",
+            reaped[i]->name, (ORPHAN_TTL_US / 1000000), __atomic_load_n(&reaped[i]->count, __ATOMIC_SEQ_CST));
+        switch_core_hash_delete(registry.channels, reaped[i]->name);
+        js_channel_queue_destroy(reaped[i]);
+    }
+}
+
+static js_channel_queue_t *js_channel_queue_take(const char *name) {
+    js_channel_queue_t *q = NULL;
+    switch_memory_pool_t *pool = NULL;
+
+    switch_mutex_lock(registry.mutex);
+    js_channel_orphans_reap(switch_micro_time_now());
+
+    if((q = switch_core_hash_find(registry.channels, name))) {
+        q->refs++;
+        q->orphaned = 0;
+        goto out;
+    }
+
+    if(switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "switch_core_new_memory_pool()\n");
+        goto out;
+    }
+
+    switch_zmalloc(q, sizeof(js_channel_queue_t));
+    q->pool = pool;
+    q->name = switch_core_strdup(pool, name);
+    q->head = q->tail = &q->stub;
+    q->refs = 1;
+    switch_mutex_init(&q->rx_mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_thread_cond_create(&q->rx_cond, pool);
+
+    switch_core_hash_insert(registry.channels, q->name, q);
+out:
+    switch_mutex_unlock(registry.mutex);
+    return q;
+}
+
+/* the messages are counted by the handle holders only, so the count can't change once the last handle is gone */
+static void js_channel_queue_release(js_channel_queue_t *q) {
+    uint8_t fl_destroy = false;
+
+    switch_mutex_lock(registry.mutex);
+    if(q->refs) q->refs--;
+    if(!q->refs) {
+        if(__atomic_load_n(&q->count, __ATOMIC_SEQ_CST)) {
+            q->orphaned = switch_micro_time_now();
+        } else {
+            switch_core_hash_delete(registry.channels, q->name);
+            fl_destroy = true;
+        }
+    }
+    switch_mutex_unlock(registry.mutex);
+
+    if(fl_destroy) {
+        js_channel_queue_destroy(q);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+static void js_channel_array_buffer_free(JSRuntime *rt, void *opaque, void *ptr) {
+    free(ptr);
+}
+
+/**
+ ** a top level ArrayBuffer goes as plain bytes and becomes the backing store of the receiver's buffer,
+ ** everything else is serialized by JS_WriteObject
+ **/
+static js_channel_msg_t *js_channel_msg_create(JSContext *ctx, JSValueConst val) {
+    js_channel_msg_t *msg = NULL;
+    uint8_t *wbuf = NULL, *buf = NULL;
+    size_t len = 0;
+    uint8_t fl_raw = false;
+
+    if(JS_IsObject(val) && (buf = JS_GetArrayBuffer(ctx, &len, val))) {
+        fl_raw = true;
+    } else {
+        if(JS_IsObject(val)) {
+            JS_FreeValue(ctx, JS_GetException(ctx));
+        }
+        if(!(wbuf = JS_WriteObject(ctx, &len, val, CHANNEL_WRITE_FLAGS))) {
+            return NULL;
+        }
+        buf = wbuf;
+    }
+
+    switch_zmalloc(msg, sizeof(js_channel_msg_t));
+    msg->fl_raw = fl_raw;
+    msg->len = len;
+    if(len) {
+        switch_malloc(msg->data, len);
+        memcpy(msg->data, buf, len);
+    }
+
+    if(wbuf) {
+        js_free(ctx, wbuf);
+    }
+    return msg;
+}
+
+static JSValue js_channel_msg_value(JSContext *ctx, js_channel_msg_t *msg) {
+    JSValue ret_val;
+
+    if(msg->fl_raw) {
+        ret_val = JS_NewArrayBuffer(ctx, msg->data, msg->len, js_channel_array_buffer_free, NULL, false);
+        if(!JS_IsException(ret_val)) {
+            msg->data = NULL;
+        }
+        return ret_val;
+    }
+
+    return JS_ReadObject(ctx, msg->data, msg->len, CHANNEL_READ_FLAGS);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+static JSValue js_channel_property_get(JSContext *ctx, JSValueConst this_val, int magic) {
+    js_channel_t *js_channel = JS_GetOpaque2(ctx, this_val, js_channel_get_classid(ctx));
+
+    if(!js_channel || !js_channel->queue) {
+        return JS_UNDEFINED;
+    }
+
+    switch(magic) {
+        case PROP_NAME:
+            return JS_NewString(ctx, js_channel->queue->name);
+        case PROP_SIZE:
+            return JS_NewUint32(ctx, __atomic_load_n(&js_channel->queue->count, __ATOMIC_SEQ_CST));
+    }
+
+    return JS_UNDEFINED;
+}
+
+static JSValue js_channel_property_set(JSContext *ctx, JSValueConst this_val, JSValue val, int magic) {
+    return JS_FALSE;
+}
+
+// post(value)
+static JSValue js_channel_post(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    js_channel_t *js_channel = JS_GetOpaque2(ctx, this_val, js_channel_get_classid(ctx));
+    js_channel_queue_t *q = NULL;
+    js_channel_msg_t *msg = NULL;
+
+    CHANNEL_SANITY_CHECK();
+
+    if(argc < 1) {
+        return JS_ThrowTypeError(ctx, "Not enough arguments");
+    }
+
+    q = js_channel->queue;
+
+    if(__atomic_add_fetch(&q->count, 1, __ATOMIC_SEQ_CST) > QUEUE_MAX_LEN) {
+        __atomic_sub_fetch(&q->count, 1, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&q->dropped, 1, __ATOMIC_RELAXED);
+        return JS_FALSE;
+    }
+
+    if(!(msg = js_channel_msg_create(ctx, argv[0]))) {
+        __atomic_sub_fetch(&q->count, 1, __ATOMIC_SEQ_CST);
+        return JS_EXCEPTION;
+    }
+
+    js_channel_queue_push(q, msg);
+    __atomic_add_fetch(&q->posted, 1, __ATOMIC_RELAXED);
+
+    if(__atomic_load_n(&q->waiters, __ATOMIC_SEQ_CST)) {
+        switch_mutex_lock(q->rx_mutex);
+        switch_thread_cond_signal(q->rx_cond);
+        switch_mutex_unlock(q->rx_mutex);
+    }
+
+    return JS_TRUE;
+}
+
+// receive([timeout]) - without timeout waits until a message arrives, 0 - doesn't wait
+static JSValue js_channel_receive(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    js_channel_t *js_channel = JS_GetOpaque2(ctx, this_val, js_channel_get_classid(ctx));
+    script_t *script = JS_GetContextOpaque(ctx);
+    js_channel_queue_t *q = NULL;
+    js_channel_msg_t *msg = NULL;
+    JSValue ret_val = JS_UNDEFINED;
+    uint32_t timeout = 0;
+    uint8_t fl_forever = (argc < 1);
+
+    CHANNEL_SANITY_CHECK();
+
+    if(argc > 0) {
+        JS_ToUint32(ctx, &timeout, argv[0]);
+    }
+
+    q = js_channel->queue;
+
+    switch_mutex_lock(q->rx_mutex);
+    if(!(msg = js_channel_queue_pop(q)) && (timeout || fl_forever)) {
+        switch_time_t end = switch_micro_time_now() + ((switch_time_t)timeout * 1000);
+        switch_time_t now = 0;
+
+        __atomic_add_fetch(&q->waiters, 1, __ATOMIC_SEQ_CST);
+        while(!(msg = js_channel_queue_pop(q))) {
+            now = switch_micro_time_now();
+            if(globals.fl_shutdown || (script && script->fl_interrupt) || (!fl_forever && now >= end)) {
+                break;
+            }
+            switch_thread_cond_timedwait(q->rx_cond, q->rx_mutex, ((fl_forever || (end - now) > RX_WAIT_SLICE_US) ? RX_WAIT_SLICE_US : (end - now)));
+        }
+        __atomic_sub_fetch(&q->waiters, 1, __ATOMIC_SEQ_CST);
+    }
+    switch_mutex_unlock(q->rx_mutex);
+
+    if(msg) {
+        ret_val = js_channel_msg_value(ctx, msg);
+        js_channel_msg_free(&msg);
+    }
+
+    return ret_val;
+}
+
+static JSValue js_channel_close(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    js_channel_t *js_channel = JS_GetOpaque2(ctx, this_val, js_channel_get_classid(ctx));
+
+    if(!js_channel || !js_channel->queue) {
+        return JS_FALSE;
+    }
+
+    js_channel_queue_release(js_channel->queue);
+    js_channel->queue = NULL;
+
+    return JS_TRUE;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+static JSClassDef js_channel_class = {
+    CLASS_NAME,
+    .finalizer = js_channel_finalizer,
+};
+
+static const JSCFunctionListEntry js_channel_proto_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("name", js_channel_property_get, js_channel_property_set, PROP_NAME),
+    JS_CGETSET_MAGIC_DEF("size", js_channel_property_get, js_channel_property_set, PROP_SIZE),
+    //
+    JS_CFUNC_DEF("post", 1, js_channel_post),
+    JS_CFUNC_DEF("receive", 1, js_channel_receive),
+    JS_CFUNC_DEF("close", 0, js_channel_close),
+};
+
+static void js_channel_finalizer(JSRuntime *rt, JSValue val) {
+    js_channel_t *js_channel = JS_GetOpaque(val, js_channel_get_classid2(rt));
+
+    if(!js_channel) {
+        return;
+    }
+
+    js_native_object_finalized(rt);
+
+#ifdef MOD_QUICKJS_DEBUG
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-channel-finalizer: js_channel=%p\n", js_channel);
+#endif
+
+    if(js_channel->queue) {
+        js_channel_queue_release(js_channel->queue);
+    }
+
+    js_free_rt(rt, js_channel);
+}
+
+/* new Channel([name]) / Channel.open([name]), the name of the own script id by default */
+static JSValue js_channel_object_create(JSContext *ctx, JSValueConst proto, int argc, JSValueConst *argv) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    js_channel_t *js_channel = NULL;
+    const char *name = NULL;
+    JSValue obj = JS_UNDEFINED;
+    JSValue err = JS_UNDEFINED;
+
+    if(argc > 0 && !QJS_IS_NULL(argv[0])) {
+        name = JS_ToCString(ctx, argv[0]);
+    }
+    if(zstr(name) && (!script || zstr(script->id))) {
+        err = JS_ThrowTypeError(ctx, "Invalid argument: name");
+        goto fail;
+    }
+
+    js_channel = js_mallocz(ctx, sizeof(js_channel_t));
+    if(!js_channel) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "js_mallocz()\n");
+        goto fail;
+    }
+
+    if(!(js_channel->queue = js_channel_queue_take(zstr(name) ? script->id : name))) {
+        err = JS_ThrowInternalError(ctx, "Unable to open channel");
+        goto fail;
+    }
+
+    obj = JS_NewObjectProtoClass(ctx, proto, js_channel_get_classid(ctx));
+    if(JS_IsException(obj)) { goto fail; }
+
+    JS_SetOpaque(obj, js_channel);
+    js_native_object_created(ctx);
+
+#ifdef MOD_QUICKJS_DEBUG
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-channel-constructor: js_channel=%p, name=%s\n", js_channel, js_channel->queue->name);
+#endif
+
+    JS_FreeCString(ctx, name);
+    return obj;
+fail:
+    if(js_channel) {
+        if(js_channel->queue) {
+            js_channel_queue_release(js_channel->queue);
+        }
+        js_free(ctx, js_channel);
+    }
+    JS_FreeCString(ctx, name);
+    JS_FreeValue(ctx, obj);
+    return (JS_IsUndefined(err) ? JS_EXCEPTION : err);
+}
+
+static JSValue js_channel_contructor(JSContext *ctx, JSValueConst new_target, int argc, JSValueConst *argv) {
+    JSValue proto, obj;
+
+    proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+    if(JS_IsException(proto)) {
+        return JS_EXCEPTION;
+    }
+
+    obj = js_channel_object_create(ctx, proto, argc, argv);
+    JS_FreeValue(ctx, proto);
+
+    return obj;
+}
+
+static JSValue js_channel_open(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    JSValue proto = JS_GetClassProto(ctx, js_channel_get_classid(ctx));
+    JSValue obj = js_channel_object_create(ctx, proto, argc, argv);
+
+    JS_FreeValue(ctx, proto);
+    return obj;
+}
+
+static const JSCFunctionListEntry js_channel_static_funcs[] = {
+    JS_CFUNC_DEF("open", 1, js_channel_open),
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+// Public
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+JSClassID js_channel_get_classid2(JSRuntime *rt) {
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(rt);
+    switch_assert(jsrt);
+    if(!jsrt->class_id_channel) {
+        jsrt->class_id_channel = js_class_id_register(rt, JS_CLASS_ID_CHANNEL, &js_channel_class);
+    }
+    return jsrt->class_id_channel;
+}
+JSClassID js_channel_get_classid(JSContext *ctx) {
+    return  js_channel_get_classid2(JS_GetRuntime(ctx));
+}
+
+switch_status_t js_channel_class_register(JSContext *ctx, JSValue global_obj) {
+    JSClassID class_id = js_channel_get_classid(ctx);
+    JSValue obj_proto, obj_class;
+
+#ifdef MOD_QUICKJS_DEBUG
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Class registered [%s / %d]\n", CLASS_NAME, class_id);
+#endif
+
+    obj_proto = JS_NewObject(ctx);
+    js_set_function_list(ctx, obj_proto, CLASS_NAME, js_channel_proto_funcs, ARRAY_SIZE(js_channel_proto_funcs));
+
+    obj_class = JS_NewCFunction2(ctx, js_channel_contructor, CLASS_NAME, 1, JS_CFUNC_constructor, 0);
+    JS_SetConstructor(ctx, obj_class, obj_proto);
+    JS_SetClassProto(ctx, class_id, obj_proto);
+    js_set_function_list(ctx, obj_class, CLASS_NAME, js_channel_static_funcs, ARRAY_SIZE(js_channel_static_funcs));
+
+    JS_SetPropertyStr(ctx, global_obj, CLASS_NAME, obj_class);
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+switch_status_t js_channel_registry_init(switch_memory_pool_t *pool) {
+    memset(&registry, 0, sizeof(registry));
+
+    switch_mutex_init(&registry.mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_core_hash_init(&registry.channels);
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+/**
+ ** should be called after all scripts were finished (the handles release the channels),
+ ** drops the queues which were left with messages
+ **/
+void js_channel_registry_shutdown() {
+    switch_hash_index_t *hidx = NULL;
+    void *hval = NULL;
+
+    switch_mutex_lock(registry.mutex);
+    if(registry.channels) {
+        for(hidx = switch_core_hash_first_iter(registry.channels, hidx); hidx; hidx = switch_core_hash_next(&hidx)) {
+            switch_core_hash_this(hidx, NULL, NULL, &hval);
+            if(!((js_channel_queue_t *)hval)->refs) {
+                js_channel_queue_destroy((js_channel_queue_t *)hval);
+            }
+        }
+        switch_safe_free(hidx);
+        switch_core_hash_destroy(&registry.channels);
+    }
+    switch_mutex_unlock(registry.mutex);
+}
+
+void js_channel_registry_stats(switch_stream_handle_t *stream) {
+    switch_hash_index_t *hidx = NULL;
+    js_channel_queue_t *q = NULL;
+    void *hval = NULL;
+    uint32_t total = 0;
+
+    switch_mutex_lock(registry.mutex);
+    for(hidx = switch_core_hash_first_iter(registry.channels, hidx); hidx; hidx = switch_core_hash_next(&hidx)) {
+        switch_core_hash_this(hidx, NULL, NULL, &hval);
+        q = (js_channel_queue_t *)hval;
+
+        stream->write_function(stream, "%s: pending: %u, posted: %"SWITCH_UINT64_T_FMT", dropped: %"SWITCH_UINT64_T_FMT", handles: %u\n",
+            q->name, __atomic_load_n(&q->count, __ATOMIC_SEQ_CST), __atomic_load_n(&q->posted, __ATOMIC_RELAXED), __atomic_load_n(&q->dropped, __ATOMIC_RELAXED), q->refs
+        );
+        total++;
+    }
+    switch_safe_free(hidx);
+    switch_mutex_unlock(registry.mutex);
+
+    stream->write_function(stream, "total: %u\n", total);
+}
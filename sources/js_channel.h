@@ -0,0 +1,45 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#ifndef JS_CHANNEL_H
+#define JS_CHANNEL_H
+#include "mod_quickjs.h"
+
+typedef struct js_channel_msg_s {
+    struct js_channel_msg_s     *next;
+    uint8_t                     *data;
+    size_t                      len;
+    uint8_t                     fl_raw;         // ArrayBuffer bytes as is (not serialized)
+} js_channel_msg_t;
+
+typedef struct {
+    char                        *name;
+    uint32_t                    refs;           // under the registry mutex
+    switch_time_t               orphaned;       // no handles left, but there are messages (under the registry mutex)
+    uint32_t                    count;          // atomic
+    uint32_t                    waiters;        // atomic
+    uint64_t                    posted;
+    uint64_t                    dropped;
+    js_channel_msg_t            *head;          // producers side (atomic)
+    js_channel_msg_t            *tail;          // consumer side (under rx_mutex)
+    js_channel_msg_t            stub;
+    switch_mutex_t              *rx_mutex;
+    switch_thread_cond_t        *rx_cond;
+    switch_memory_pool_t        *pool;
+} js_channel_queue_t;
+
+typedef struct {
+    js_channel_queue_t          *queue;
+} js_channel_t;
+
+JSClassID js_channel_get_classid(JSContext *ctx);
+JSClassID js_channel_get_classid2(JSRuntime *rt);
+switch_status_t js_channel_class_register(JSContext *ctx, JSValue global_obj);
+
+switch_status_t js_channel_registry_init(switch_memory_pool_t *pool);
+void js_channel_registry_shutdown();
+void js_channel_registry_stats(switch_stream_handle_t *stream);
+
+#endif
+
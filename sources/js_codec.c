@@ -210,6 +210,8 @@ static void js_codec_finalizer(JSRuntime *rt, JSValue val) {
         return;
     }
 
+    js_native_object_finalized(rt);
+
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-codec-finalizer: js_codec=%p, codec=%p\n", js_codec, js_codec->codec);
 #endif
@@ -307,6 +309,7 @@ static JSValue js_codec_contructor(JSContext *ctx, JSValueConst new_target, int
     if(JS_IsException(obj)) { goto fail; }
 
     JS_SetOpaque(obj, js_codec);
+    js_native_object_created(ctx);
     JS_FreeCString(ctx, name);
 
 #ifdef MOD_QUICKJS_DEBUG
@@ -338,35 +341,27 @@ fail:
 // Public
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------
 JSClassID js_codec_get_classid2(JSRuntime *rt) {
-    script_t *script = JS_GetRuntimeOpaque(rt);
-    switch_assert(script);
-    return script->class_id_codec;
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(rt);
+    switch_assert(jsrt);
+    if(!jsrt->class_id_codec) {
+        jsrt->class_id_codec = js_class_id_register(rt, JS_CLASS_ID_CODEC, &js_codec_class);
+    }
+    return jsrt->class_id_codec;
 }
 JSClassID js_codec_get_classid(JSContext *ctx) {
     return  js_codec_get_classid2(JS_GetRuntime(ctx));
 }
 
-switch_status_t js_codec_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id) {
+switch_status_t js_codec_class_register(JSContext *ctx, JSValue global_obj) {
+    JSClassID class_id = js_codec_get_classid(ctx);
     JSValue obj_proto, obj_class;
-    script_t *script = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
-
-    switch_assert(script);
-
-    if(JS_IsRegisteredClass(JS_GetRuntime(ctx), class_id)) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Class with id (%d) already registered!\n", class_id);
-        return SWITCH_STATUS_FALSE;
-    }
-
-    JS_NewClassID(&class_id);
-    JS_NewClass(JS_GetRuntime(ctx), class_id, &js_codec_class);
-    script->class_id_codec = class_id;
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Class registered [%s / %d]\n", CLASS_NAME, class_id);
 #endif
 
     obj_proto = JS_NewObject(ctx);
-    JS_SetPropertyFunctionList(ctx, obj_proto, js_codec_proto_funcs, ARRAY_SIZE(js_codec_proto_funcs));
+    js_set_function_list(ctx, obj_proto, CLASS_NAME, js_codec_proto_funcs, ARRAY_SIZE(js_codec_proto_funcs));
 
     obj_class = JS_NewCFunction2(ctx, js_codec_contructor, CLASS_NAME, 1, JS_CFUNC_constructor, 0);
     JS_SetConstructor(ctx, obj_class, obj_proto);
@@ -393,7 +388,7 @@ JSValue js_codec_from_session_wcodec(JSContext *ctx, switch_core_session_t *sess
 
     proto = JS_NewObject(ctx);
     if(JS_IsException(proto)) { return proto; }
-    JS_SetPropertyFunctionList(ctx, proto, js_codec_proto_funcs, ARRAY_SIZE(js_codec_proto_funcs));
+    js_set_function_list(ctx, proto, CLASS_NAME, js_codec_proto_funcs, ARRAY_SIZE(js_codec_proto_funcs));
 
     obj = JS_NewObjectProtoClass(ctx, proto, js_codec_get_classid(ctx));
     JS_FreeValue(ctx, proto);
@@ -419,6 +414,7 @@ JSValue js_codec_from_session_wcodec(JSContext *ctx, switch_core_session_t *sess
     js_codec->fl_can_destroy = SWITCH_FALSE;
 
     JS_SetOpaque(obj, js_codec);
+    js_native_object_created(ctx);
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-wcodec-from-session: js_codec=%p, codec=%p\n", js_codec, js_codec->codec);
@@ -442,7 +438,7 @@ JSValue js_codec_from_session_rcodec(JSContext *ctx, switch_core_session_t *sess
 
     proto = JS_NewObject(ctx);
     if(JS_IsException(proto)) { return proto; }
-    JS_SetPropertyFunctionList(ctx, proto, js_codec_proto_funcs, ARRAY_SIZE(js_codec_proto_funcs));
+    js_set_function_list(ctx, proto, CLASS_NAME, js_codec_proto_funcs, ARRAY_SIZE(js_codec_proto_funcs));
 
     obj = JS_NewObjectProtoClass(ctx, proto, js_codec_get_classid(ctx));
     JS_FreeValue(ctx, proto);
@@ -468,6 +464,7 @@ JSValue js_codec_from_session_rcodec(JSContext *ctx, switch_core_session_t *sess
     js_codec->fl_can_destroy = SWITCH_FALSE;
 
     JS_SetOpaque(obj, js_codec);
+    js_native_object_created(ctx);
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-rcodec-from-session: js_codec=%p, codec=%p\n", js_codec, js_codec->codec);
@@ -24,6 +24,29 @@
 
 static void js_curl_finalizer(JSRuntime *rt, JSValue val);
 
+static JSValue js_curl_result_object(JSContext *ctx, js_curl_result_t *cresult) {
+    JSValue ret_obj = JS_NewObject(ctx);
+
+    JS_SetPropertyStr(ctx, ret_obj, "class",JS_NewString(ctx, "CurlResult"));
+    JS_SetPropertyStr(ctx, ret_obj, "jid",  JS_NewInt32(ctx, cresult->jid));
+    JS_SetPropertyStr(ctx, ret_obj, "body", JS_NewStringLen(ctx, (char *)cresult->body, cresult->body_len));
+    JS_SetPropertyStr(ctx, ret_obj, "code", JS_NewInt32(ctx, cresult->http_code));
+
+    return ret_obj;
+}
+
+static JSValue js_curl_async_result(JSContext *ctx, void *data) {
+    if(!data) {
+        return JS_ThrowInternalError(ctx, "Unable to perform request");
+    }
+    return js_curl_result_object(ctx, (js_curl_result_t *)data);
+}
+
+static void js_curl_async_result_free(void *data) {
+    js_curl_result_t *cresult = (js_curl_result_t *)data;
+    js_curl_result_free(&cresult);
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------
 static js_curl_result_t *js_curl_request_exec(js_curl_creq_conf_t *creq_conf) {
     switch_status_t status = SWITCH_STATUS_FALSE;
@@ -54,6 +77,11 @@ static void *SWITCH_THREAD_FUNC js_curl_request_exec_thread(switch_thread_t *thr
     res = js_curl_request_exec(creq_conf);
     if(res) {
         res->jid = creq_conf->jid;
+    }
+
+    if(creq_conf->evloop) {
+        evloop_complete(creq_conf->evloop, creq_conf->pid, res, js_curl_async_result, js_curl_async_result_free);
+    } else if(res) {
         if(switch_queue_trypush(js_curl->events, res) != SWITCH_STATUS_SUCCESS) {
             js_curl_result_free(&res);
         }
@@ -72,7 +100,11 @@ static uint32_t js_curl_request_exec_async(js_curl_creq_conf_t *creq_conf) {
 
     if(js_curl_job_can_start(creq_conf->js_curl_ref) == SWITCH_STATUS_SUCCESS) {
         jid = creq_conf->jid = js_curl_job_next_id(creq_conf->js_curl_ref);
-        launch_thread(creq_conf->pool, js_curl_request_exec_thread, creq_conf);
+        if(wpool_submit(WPOOL_PRIO_AUX, js_curl_request_exec_thread, creq_conf) != SWITCH_STATUS_SUCCESS) {
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Unable to queue the request (workers are busy)\n");
+            js_curl_job_finished(creq_conf->js_curl_ref);
+            jid = JID_NONE;
+        }
     }
 
     return jid;
@@ -436,9 +468,10 @@ out:
 }
 
 /**
- ** bgPerform( [string|arrayBuffer] || {type: [file|simple], name: fieldName, value: fieldValue}, {...})
+ ** performBg( [string|arrayBuffer] || {type: [file|simple], name: fieldName, value: fieldValue}, {...})
+ ** performAsync(...) - the same, but returns a promise which is resolved with the result
  **/
-static JSValue js_curl_perform_bg_request(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+static JSValue js_curl_perform_bg_request(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic) {
     js_curl_t *js_curl = JS_GetOpaque2(ctx, this_val, js_curl_get_classid(ctx));
     switch_status_t status = SWITCH_STATUS_SUCCESS;
     js_curl_creq_conf_t *creq_conf = NULL;
@@ -520,8 +553,23 @@ static JSValue js_curl_perform_bg_request(JSContext *ctx, JSValueConst this_val,
         creq_conf->curl_conf->ssl_verfyhost = js_curl->fl_ssl_verfyhost;
         creq_conf->curl_conf->ssl_verfypeer = js_curl->fl_ssl_verfypeer;
 
-        uint32_t jid = js_curl_request_exec_async(creq_conf);
-        ret_obj = (jid > 0 ? JS_NewInt32(ctx, jid) : JS_FALSE);
+        if(magic) {
+            ret_obj = evloop_promise_new(ctx, &creq_conf->evloop, &creq_conf->pid);
+            if(JS_IsException(ret_obj)) {
+                switch_goto_status(SWITCH_STATUS_FALSE, out);
+            }
+            if(!js_curl_request_exec_async(creq_conf)) {
+                evloop_complete(creq_conf->evloop, creq_conf->pid, NULL, js_curl_async_result, NULL);
+                switch_goto_status(SWITCH_STATUS_FALSE, out);
+            }
+        } else {
+            uint32_t jid = js_curl_request_exec_async(creq_conf);
+            if(jid == JID_NONE) {
+                ret_obj = JS_FALSE;
+                switch_goto_status(SWITCH_STATUS_FALSE, out);
+            }
+            ret_obj = JS_NewInt32(ctx, jid);
+        }
     }
 out:
     if(status != SWITCH_STATUS_SUCCESS) {
@@ -544,11 +592,7 @@ static JSValue js_curl_get_bg_request_result(JSContext *ctx, JSValueConst this_v
     if(switch_queue_trypop(js_curl->events, &pop) == SWITCH_STATUS_SUCCESS) {
         js_curl_result_t *cresult = (js_curl_result_t *)pop;
         if(cresult) {
-            ret_obj = JS_NewObject(ctx);
-            JS_SetPropertyStr(ctx, ret_obj, "class",JS_NewString(ctx, "CurlResult"));
-            JS_SetPropertyStr(ctx, ret_obj, "jid",  JS_NewInt32(ctx, cresult->jid));
-            JS_SetPropertyStr(ctx, ret_obj, "body", JS_NewStringLen(ctx, cresult->body, cresult->body_len));
-            JS_SetPropertyStr(ctx, ret_obj, "code", JS_NewInt32(ctx, cresult->http_code));
+            ret_obj = js_curl_result_object(ctx, cresult);
         }
         js_curl_result_free(&cresult);
     }
@@ -579,19 +623,21 @@ static const JSCFunctionListEntry js_curl_proto_funcs[] = {
     JS_CGETSET_MAGIC_DEF("proxyCAcert", js_curl_property_get, js_curl_property_set, PROP_SSL_PROXY_CACERT),
     //
     JS_CFUNC_DEF("perform", 1, js_curl_perform_request),
-    JS_CFUNC_DEF("performBg", 1, js_curl_perform_bg_request),
+    JS_CFUNC_MAGIC_DEF("performBg", 1, js_curl_perform_bg_request, 0),
+    JS_CFUNC_MAGIC_DEF("performAsync", 1, js_curl_perform_bg_request, 1),
     JS_CFUNC_DEF("getResult", 1, js_curl_get_bg_request_result),
 };
 
 static void js_curl_finalizer(JSRuntime *rt, JSValue val) {
     js_curl_t *js_curl = JS_GetOpaque(val, js_curl_get_classid2(rt));
     switch_memory_pool_t *pool = (js_curl ? js_curl->pool : NULL);
-    uint8_t fl_wloop = true;
 
     if(!js_curl || js_curl->fl_destroying) {
         return;
     }
 
+    js_native_object_finalized(rt);
+
     js_curl->fl_destroying = true;
 
     if(js_curl->events) {
@@ -599,20 +645,15 @@ static void js_curl_finalizer(JSRuntime *rt, JSValue val) {
         switch_queue_term(js_curl->events);
     }
 
-    switch_mutex_lock(js_curl->mutex);
-    fl_wloop = (js_curl->active_jobs != 0);
-    switch_mutex_unlock(js_curl->mutex);
-
-    if(fl_wloop) {
+    if(js_curl->mutex) {
+        switch_mutex_lock(js_curl->mutex);
+        while(js_curl->active_jobs > 0) {
 #ifdef MOD_QUICKJS_DEBUG
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Waiting for termination of '%d' jobs...\n", js_curl->active_jobs);
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Waiting for termination of '%d' jobs...\n", js_curl->active_jobs);
 #endif
-        while(fl_wloop) {
-            switch_mutex_lock(js_curl->mutex);
-            fl_wloop = (js_curl->active_jobs != 0);
-            switch_mutex_unlock(js_curl->mutex);
-            switch_yield(100000);
+            switch_thread_cond_timedwait(js_curl->cond, js_curl->mutex, 1000000);
         }
+        switch_mutex_unlock(js_curl->mutex);
     }
 
     if(pool) {
@@ -688,6 +729,10 @@ static JSValue js_curl_contructor(JSContext *ctx, JSValueConst new_target, int a
         switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "switch_mutex_init()\n");
         goto fail;
     }
+    if(switch_thread_cond_create(&js_curl->cond, pool) != SWITCH_STATUS_SUCCESS) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "switch_thread_cond_create()\n");
+        goto fail;
+    }
 
     proto = JS_GetPropertyStr(ctx, new_target, "prototype");
     if(JS_IsException(proto)) { goto fail; }
@@ -697,6 +742,7 @@ static JSValue js_curl_contructor(JSContext *ctx, JSValueConst new_target, int a
     if(JS_IsException(obj)) { goto fail; }
 
     JS_SetOpaque(obj, js_curl);
+    js_native_object_created(ctx);
 
     JS_FreeCString(ctx, url);
     JS_FreeCString(ctx, method);
@@ -731,35 +777,27 @@ fail:
 // Public
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------
 JSClassID js_curl_get_classid2(JSRuntime *rt) {
-    script_t *script = JS_GetRuntimeOpaque(rt);
-    switch_assert(script);
-    return script->class_id_curl;
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(rt);
+    switch_assert(jsrt);
+    if(!jsrt->class_id_curl) {
+        jsrt->class_id_curl = js_class_id_register(rt, JS_CLASS_ID_CURL, &js_curl_class);
+    }
+    return jsrt->class_id_curl;
 }
 JSClassID js_curl_get_classid(JSContext *ctx) {
     return  js_curl_get_classid2(JS_GetRuntime(ctx));
 }
 
-switch_status_t js_curl_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id) {
+switch_status_t js_curl_class_register(JSContext *ctx, JSValue global_obj) {
+    JSClassID class_id = js_curl_get_classid(ctx);
     JSValue obj_proto, obj_class;
-    script_t *script = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
-
-    switch_assert(script);
-
-    if(JS_IsRegisteredClass(JS_GetRuntime(ctx), class_id)) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Class with id (%d) already registered!\n", class_id);
-        return SWITCH_STATUS_FALSE;
-    }
-
-    JS_NewClassID(&class_id);
-    JS_NewClass(JS_GetRuntime(ctx), class_id, &js_curl_class);
-    script->class_id_curl = class_id;
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Class registered [%s / %d]\n", CLASS_NAME, class_id);
 #endif
 
     obj_proto = JS_NewObject(ctx);
-    JS_SetPropertyFunctionList(ctx, obj_proto, js_curl_proto_funcs, ARRAY_SIZE(js_curl_proto_funcs));
+    js_set_function_list(ctx, obj_proto, CLASS_NAME, js_curl_proto_funcs, ARRAY_SIZE(js_curl_proto_funcs));
 
     obj_class = JS_NewCFunction2(ctx, js_curl_contructor, CLASS_NAME, 1, JS_CFUNC_constructor, 0);
     JS_SetConstructor(ctx, obj_class, obj_proto);
@@ -26,6 +26,7 @@ typedef struct {
     char                    *proxy;
     switch_memory_pool_t    *pool;
     switch_mutex_t          *mutex;
+    switch_thread_cond_t    *cond;              // signaled when active_jobs drops to 0
     switch_queue_t          *events;
     uint32_t                job_seq;
     uint32_t                active_jobs;
@@ -44,12 +45,14 @@ typedef struct {
     switch_memory_pool_t    *pool;
     curl_conf_t             *curl_conf;
     js_curl_t               *js_curl_ref;
+    evloop_t                *evloop;        // performAsync
+    uint32_t                pid;
 } js_curl_creq_conf_t;
 
 /* js_curl.c */
 JSClassID js_curl_get_classid(JSContext *ctx);
 JSClassID js_curl_get_classid2(JSRuntime *rt);
-switch_status_t js_curl_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id);
+switch_status_t js_curl_class_register(JSContext *ctx, JSValue global_obj);
 
 /* js_curl_misc.c */
 switch_status_t js_curl_result_alloc(js_curl_result_t **result, uint32_t http_code, uint8_t *body, uint32_t body_len);
@@ -105,6 +105,9 @@ void js_curl_job_finished(js_curl_t *js_curl) {
 
     switch_mutex_lock(js_curl->mutex);
     if(js_curl->active_jobs > 0) js_curl->active_jobs--;
+    if(!js_curl->active_jobs && js_curl->cond) {
+        switch_thread_cond_broadcast(js_curl->cond);
+    }
     switch_mutex_unlock(js_curl->mutex);
 }
 
@@ -216,6 +216,8 @@ static void js_dbh_finalizer(JSRuntime *rt, JSValue val) {
         return;
     }
 
+    js_native_object_finalized(rt);
+
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-dbh-finalizer: js_dbh=%p, dbh=%p\n", js_dbh, js_dbh->dbh);
 #endif
@@ -280,6 +282,7 @@ static JSValue js_dbh_contructor(JSContext *ctx, JSValueConst new_target, int ar
     if(JS_IsException(obj)) { goto fail; }
 
     JS_SetOpaque(obj, js_dbh);
+    js_native_object_created(ctx);
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-dbh-constructor: js_dbh=%p, dbh=%p\n", js_dbh, dbh);
@@ -307,36 +310,28 @@ fail:
 // Public
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------
 JSClassID js_dbh_get_classid2(JSRuntime *rt) {
-    script_t *script = JS_GetRuntimeOpaque(rt);
-    switch_assert(script);
-    return script->class_id_dbh;
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(rt);
+    switch_assert(jsrt);
+    if(!jsrt->class_id_dbh) {
+        jsrt->class_id_dbh = js_class_id_register(rt, JS_CLASS_ID_DBH, &js_dbh_class);
+    }
+    return jsrt->class_id_dbh;
 }
 JSClassID js_dbh_get_classid(JSContext *ctx) {
     return  js_dbh_get_classid2(JS_GetRuntime(ctx));
 }
 
 
-switch_status_t js_dbh_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id) {
+switch_status_t js_dbh_class_register(JSContext *ctx, JSValue global_obj) {
+    JSClassID class_id = js_dbh_get_classid(ctx);
     JSValue obj_proto, obj_class;
-    script_t *script = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
-
-    switch_assert(script);
-
-    if(JS_IsRegisteredClass(JS_GetRuntime(ctx), class_id)) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Class with id (%d) already registered!\n", class_id);
-        return SWITCH_STATUS_FALSE;
-    }
-
-    JS_NewClassID(&class_id);
-    JS_NewClass(JS_GetRuntime(ctx), class_id, &js_dbh_class);
-    script->class_id_dbh = class_id;
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Class registered [%s / %d]\n", CLASS_NAME, class_id);
 #endif
 
     obj_proto = JS_NewObject(ctx);
-    JS_SetPropertyFunctionList(ctx, obj_proto, js_dbh_proto_funcs, ARRAY_SIZE(js_dbh_proto_funcs));
+    js_set_function_list(ctx, obj_proto, CLASS_NAME, js_dbh_proto_funcs, ARRAY_SIZE(js_dbh_proto_funcs));
 
     obj_class = JS_NewCFunction2(ctx, js_dbh_contructor, CLASS_NAME, 1, JS_CFUNC_constructor, 0);
     JS_SetConstructor(ctx, obj_class, obj_proto);
@@ -15,7 +15,7 @@ typedef struct {
 
 JSClassID js_dbh_get_classid(JSContext *ctx);
 JSClassID js_dbh_get_classid2(JSRuntime *rt);
-switch_status_t js_dbh_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id);
+switch_status_t js_dbh_class_register(JSContext *ctx, JSValue global_obj);
 
 
 #endif
@@ -203,6 +203,8 @@ static void js_event_finalizer(JSRuntime *rt, JSValue val) {
         return;
     }
 
+    js_native_object_finalized(rt);
+
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-event-finalizer: js_event=%p, event=%p\n", js_event, js_event->event);
 #endif
@@ -268,6 +270,7 @@ static JSValue js_event_contructor(JSContext *ctx, JSValueConst new_target, int
 
     js_event->event = event;
     JS_SetOpaque(obj, js_event);
+    js_native_object_created(ctx);
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-event-constructor: js-event=%p, event=%p\n", js_event, js_event->event);
@@ -289,35 +292,27 @@ fail:
 // Public
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------
 JSClassID js_event_get_classid2(JSRuntime *rt) {
-    script_t *script = JS_GetRuntimeOpaque(rt);
-    switch_assert(script);
-    return script->class_id_event;
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(rt);
+    switch_assert(jsrt);
+    if(!jsrt->class_id_event) {
+        jsrt->class_id_event = js_class_id_register(rt, JS_CLASS_ID_EVENT, &js_event_class);
+    }
+    return jsrt->class_id_event;
 }
 JSClassID js_event_get_classid(JSContext *ctx) {
     return  js_event_get_classid2(JS_GetRuntime(ctx));
 }
 
-switch_status_t js_event_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id) {
+switch_status_t js_event_class_register(JSContext *ctx, JSValue global_obj) {
+    JSClassID class_id = js_event_get_classid(ctx);
     JSValue obj_proto, obj_class;
-    script_t *script = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
-
-    switch_assert(script);
-
-    if(JS_IsRegisteredClass(JS_GetRuntime(ctx), class_id)) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Class with id (%d) already registered!\n", class_id);
-        return SWITCH_STATUS_FALSE;
-    }
-
-    JS_NewClassID(&class_id);
-    JS_NewClass(JS_GetRuntime(ctx), class_id, &js_event_class);
-    script->class_id_event = class_id;
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Class registered [%s / %d]\n", CLASS_NAME, class_id);
 #endif
 
     obj_proto = JS_NewObject(ctx);
-    JS_SetPropertyFunctionList(ctx, obj_proto, js_event_proto_funcs, ARRAY_SIZE(js_event_proto_funcs));
+    js_set_function_list(ctx, obj_proto, CLASS_NAME, js_event_proto_funcs, ARRAY_SIZE(js_event_proto_funcs));
 
     obj_class = JS_NewCFunction2(ctx, js_event_contructor, CLASS_NAME, 1, JS_CFUNC_constructor, 0);
     JS_SetConstructor(ctx, obj_class, obj_proto);
@@ -340,7 +335,7 @@ JSValue js_event_object_create(JSContext *ctx, switch_event_t *event) {
 
     proto = JS_NewObject(ctx);
     if(JS_IsException(proto)) { return proto; }
-    JS_SetPropertyFunctionList(ctx, proto, js_event_proto_funcs, ARRAY_SIZE(js_event_proto_funcs));
+    js_set_function_list(ctx, proto, CLASS_NAME, js_event_proto_funcs, ARRAY_SIZE(js_event_proto_funcs));
 
     obj = JS_NewObjectProtoClass(ctx, proto, js_event_get_classid(ctx));
     JS_FreeValue(ctx, proto);
@@ -349,6 +344,7 @@ JSValue js_event_object_create(JSContext *ctx, switch_event_t *event) {
 
     js_event->event = event;
     JS_SetOpaque(obj, js_event);
+    js_native_object_created(ctx);
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-event-obj-created: js_event=%p\n", js_event);
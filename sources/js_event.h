@@ -12,7 +12,7 @@ typedef struct {
 
 JSClassID js_event_get_classid(JSContext *ctx);
 JSClassID js_event_get_classid2(JSRuntime *rt);
-switch_status_t js_event_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id);
+switch_status_t js_event_class_register(JSContext *ctx, JSValue global_obj);
 
 JSValue js_event_object_create(JSContext *ctx, switch_event_t *event);
 
@@ -306,6 +306,8 @@ static void js_eventhandler_finalizer(JSRuntime *rt, JSValue val) {
         return;
     }
 
+    js_native_object_finalized(rt);
+
     if(js_eventhandler->custom_events) {
         switch_core_hash_destroy(&js_eventhandler->custom_events);
     }
@@ -372,6 +374,7 @@ static JSValue js_eventhandler_contructor(JSContext *ctx, JSValueConst new_targe
     if(JS_IsException(obj)) { goto fail; }
 
     JS_SetOpaque(obj, js_eventhandler);
+    js_native_object_created(ctx);
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-eventhandler-constructor: js_eventhandler=%p\n", js_eventhandler);
@@ -402,35 +405,27 @@ fail:
 // Public
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------
 JSClassID js_eventhandler_get_classid2(JSRuntime *rt) {
-    script_t *script = JS_GetRuntimeOpaque(rt);
-    switch_assert(script);
-    return script->class_id_eventhandler;
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(rt);
+    switch_assert(jsrt);
+    if(!jsrt->class_id_eventhandler) {
+        jsrt->class_id_eventhandler = js_class_id_register(rt, JS_CLASS_ID_EVENTHANDLER, &js_eventhandler_class);
+    }
+    return jsrt->class_id_eventhandler;
 }
 JSClassID js_eventhandler_get_classid(JSContext *ctx) {
     return  js_eventhandler_get_classid2(JS_GetRuntime(ctx));
 }
 
-switch_status_t js_eventhandler_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id) {
+switch_status_t js_eventhandler_class_register(JSContext *ctx, JSValue global_obj) {
+    JSClassID class_id = js_eventhandler_get_classid(ctx);
     JSValue obj_proto, obj_class;
-    script_t *script = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
-
-    switch_assert(script);
-
-    if(JS_IsRegisteredClass(JS_GetRuntime(ctx), class_id)) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Class with id (%d) already registered!\n", class_id);
-        return SWITCH_STATUS_FALSE;
-    }
-
-    JS_NewClassID(&class_id);
-    JS_NewClass(JS_GetRuntime(ctx), class_id, &js_eventhandler_class);
-    script->class_id_eventhandler = class_id;
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Class registered [%s / %d]\n", CLASS_NAME, class_id);
 #endif
 
     obj_proto = JS_NewObject(ctx);
-    JS_SetPropertyFunctionList(ctx, obj_proto, js_eventhandler_proto_funcs, ARRAY_SIZE(js_eventhandler_proto_funcs));
+    js_set_function_list(ctx, obj_proto, CLASS_NAME, js_eventhandler_proto_funcs, ARRAY_SIZE(js_eventhandler_proto_funcs));
 
     obj_class = JS_NewCFunction2(ctx, js_eventhandler_contructor, CLASS_NAME, 1, JS_CFUNC_constructor, 0);
     JS_SetConstructor(ctx, obj_class, obj_proto);
@@ -17,7 +17,7 @@ typedef struct {
 
 JSClassID js_eventhandler_get_classid(JSContext *ctx);
 JSClassID js_eventhandler_get_classid2(JSRuntime *rt);
-switch_status_t js_eventhandler_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id);
+switch_status_t js_eventhandler_class_register(JSContext *ctx, JSValue global_obj);
 
 #endif
 
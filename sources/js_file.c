@@ -613,6 +613,8 @@ static void js_file_finalizer(JSRuntime *rt, JSValue val) {
         return;
     }
 
+    js_native_object_finalized(rt);
+
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-file-finalizer: js_file=%p, fd=%p, dir=%p\n", js_file, js_file->fd, js_file->dir);
 #endif
@@ -679,6 +681,7 @@ static JSValue js_file_contructor(JSContext *ctx, JSValueConst new_target, int a
     if(JS_IsException(obj)) { goto fail; }
 
     JS_SetOpaque(obj, js_file);
+    js_native_object_created(ctx);
     JS_FreeCString(ctx, path);
 
 #ifdef MOD_QUICKJS_DEBUG
@@ -702,35 +705,27 @@ fail:
 // Public
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------
 JSClassID js_file_get_classid2(JSRuntime *rt) {
-    script_t *script = JS_GetRuntimeOpaque(rt);
-    switch_assert(script);
-    return script->class_id_file;
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(rt);
+    switch_assert(jsrt);
+    if(!jsrt->class_id_file) {
+        jsrt->class_id_file = js_class_id_register(rt, JS_CLASS_ID_FILE, &js_file_class);
+    }
+    return jsrt->class_id_file;
 }
 JSClassID js_file_get_classid(JSContext *ctx) {
     return  js_file_get_classid2(JS_GetRuntime(ctx));
 }
 
-switch_status_t js_file_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id) {
+switch_status_t js_file_class_register(JSContext *ctx, JSValue global_obj) {
+    JSClassID class_id = js_file_get_classid(ctx);
     JSValue obj_proto, obj_class;
-    script_t *script = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
-
-    switch_assert(script);
-
-    if(JS_IsRegisteredClass(JS_GetRuntime(ctx), class_id)) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Class with id (%d) already registered!\n", class_id);
-        return SWITCH_STATUS_FALSE;
-    }
-
-    JS_NewClassID(&class_id);
-    JS_NewClass(JS_GetRuntime(ctx), class_id, &js_file_class);
-    script->class_id_file = class_id;
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Class registered [%s / %d]\n", CLASS_NAME, class_id);
 #endif
 
     obj_proto = JS_NewObject(ctx);
-    JS_SetPropertyFunctionList(ctx, obj_proto, js_file_proto_funcs, ARRAY_SIZE(js_file_proto_funcs));
+    js_set_function_list(ctx, obj_proto, CLASS_NAME, js_file_proto_funcs, ARRAY_SIZE(js_file_proto_funcs));
 
     obj_class = JS_NewCFunction2(ctx, js_file_contructor, CLASS_NAME, 1, JS_CFUNC_constructor, 0);
     JS_SetConstructor(ctx, obj_class, obj_proto);
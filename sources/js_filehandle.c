@@ -323,6 +323,8 @@ static void js_fh_finalizer(JSRuntime *rt, JSValue val) {
         return;
     }
 
+    js_native_object_finalized(rt);
+
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-fh-finalizer: js_fh=%p, fh=%p\n", js_fh, js_fh->fh);
 #endif
@@ -427,6 +429,7 @@ static JSValue js_fh_contructor(JSContext *ctx, JSValueConst new_target, int arg
     js_fh->session = (jss ? jss->session : NULL);
     js_fh->fl_auto_close = SWITCH_TRUE;
     JS_SetOpaque(obj, js_fh);
+    js_native_object_created(ctx);
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-fh-constructor: js_fh=%p, fh=%p\n", js_fh, js_fh->fh);
@@ -453,35 +456,27 @@ fail:
 // Public
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------
 JSClassID js_file_handle_get_classid2(JSRuntime *rt) {
-    script_t *script = JS_GetRuntimeOpaque(rt);
-    switch_assert(script);
-    return script->class_id_filehandle;
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(rt);
+    switch_assert(jsrt);
+    if(!jsrt->class_id_filehandle) {
+        jsrt->class_id_filehandle = js_class_id_register(rt, JS_CLASS_ID_FILEHANDLE, &js_fh_class);
+    }
+    return jsrt->class_id_filehandle;
 }
 JSClassID js_file_handle_get_classid(JSContext *ctx) {
     return  js_file_handle_get_classid2(JS_GetRuntime(ctx));
 }
 
-switch_status_t js_file_handle_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id) {
+switch_status_t js_file_handle_class_register(JSContext *ctx, JSValue global_obj) {
+    JSClassID class_id = js_file_handle_get_classid(ctx);
     JSValue obj_proto, obj_class;
-    script_t *script = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
-
-    switch_assert(script);
-
-    if(JS_IsRegisteredClass(JS_GetRuntime(ctx), class_id)) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Class with id (%d) already registered!\n", class_id);
-        return SWITCH_STATUS_FALSE;
-    }
-
-    JS_NewClassID(&class_id);
-    JS_NewClass(JS_GetRuntime(ctx), class_id, &js_fh_class);
-    script->class_id_filehandle = class_id;
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Class registered [%s / %d]\n", CLASS_NAME, class_id);
 #endif
 
     obj_proto = JS_NewObject(ctx);
-    JS_SetPropertyFunctionList(ctx, obj_proto, js_fh_proto_funcs, ARRAY_SIZE(js_fh_proto_funcs));
+    js_set_function_list(ctx, obj_proto, CLASS_NAME, js_fh_proto_funcs, ARRAY_SIZE(js_fh_proto_funcs));
 
     obj_class = JS_NewCFunction2(ctx, js_fh_contructor, CLASS_NAME, 1, JS_CFUNC_constructor, 0);
     JS_SetConstructor(ctx, obj_class, obj_proto);
@@ -504,7 +499,7 @@ JSValue js_file_handle_object_create(JSContext *ctx, switch_file_handle_t *fh, s
 
     proto = JS_NewObject(ctx);
     if(JS_IsException(proto)) { return proto; }
-    JS_SetPropertyFunctionList(ctx, proto, js_fh_proto_funcs, ARRAY_SIZE(js_fh_proto_funcs));
+    js_set_function_list(ctx, proto, CLASS_NAME, js_fh_proto_funcs, ARRAY_SIZE(js_fh_proto_funcs));
 
     obj = JS_NewObjectProtoClass(ctx, proto, js_file_handle_get_classid(ctx));
     JS_FreeValue(ctx, proto);
@@ -514,6 +509,7 @@ JSValue js_file_handle_object_create(JSContext *ctx, switch_file_handle_t *fh, s
     js_fh->fh = fh;
     js_fh->session = session;
     JS_SetOpaque(obj, js_fh);
+    js_native_object_created(ctx);
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-fh-obj-created: js_fh=%p, fh=%p\n", js_fh, js_fh->fh);
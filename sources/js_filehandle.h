@@ -15,7 +15,7 @@ typedef struct {
 
 JSClassID js_file_handle_get_classid(JSContext *ctx);
 JSClassID js_file_handle_get_classid2(JSRuntime *rt);
-switch_status_t js_file_handle_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id);
+switch_status_t js_file_handle_class_register(JSContext *ctx, JSValue global_obj);
 
 JSValue js_file_handle_object_create(JSContext *ctx, switch_file_handle_t *fh, switch_core_session_t *session);
 
@@ -330,6 +330,7 @@ static JSValue  js_session_speak(JSContext *ctx, JSValueConst this_val, int argc
     }
 
     switch_channel_flush_dtmf(switch_core_session_get_channel(jss->session));
+    script_gc_idle(JS_GetContextOpaque(ctx));
     switch_ivr_speak_text(jss->session, tts_engine, tts_language, (alt_text ? alt_text : text), &args);
 
     JS_FreeCString(ctx, text);
@@ -407,6 +408,7 @@ static JSValue  js_session_speak_ex(JSContext *ctx, JSValueConst this_val, int a
     }
 
     switch_channel_flush_dtmf(switch_core_session_get_channel(jss->session));
+    script_gc_idle(JS_GetContextOpaque(ctx));
     switch_ivr_speak_text(jss->session, (tts_engine ? tts_engine : ch_tts_engine), (tts_language ? tts_language : ch_tts_language), (alt_text ? alt_text : text), &args);
 
     JS_FreeCString(ctx, tts_engine);
@@ -529,6 +531,8 @@ static JSValue js_session_fg_playback(JSContext *ctx, JSValueConst this_val, int
 
     switch_channel_flush_dtmf(switch_core_session_get_channel(jss->session));
 
+    script_gc_idle(JS_GetContextOpaque(ctx));
+
     jss->fg_stream_fh = &fh;
     switch_ivr_play_file(jss->session, &fh, (file_name ? file_name : file_obj_fname), &args);
     jss->fg_stream_fh = NULL;
@@ -1489,6 +1493,9 @@ static JSValue js_session_get_event(JSContext *ctx, JSValueConst this_val, int a
         return js_event_object_create(ctx, event);
     }
 
+    /* nothing to do, the script is polling */
+    script_gc_idle(JS_GetContextOpaque(ctx));
+
     return JS_UNDEFINED;
 }
 
@@ -1607,6 +1614,7 @@ static JSValue js_session_sleep(JSContext *ctx, JSValueConst this_val, int argc,
     }
 
     switch_channel_flush_dtmf(switch_core_session_get_channel(jss->session));
+    script_gc_idle(JS_GetContextOpaque(ctx));
     switch_ivr_sleep(jss->session, msec, false, &args);
 
     return JS_TRUE;
@@ -1767,6 +1775,9 @@ static JSValue js_session_frame_write(JSContext *ctx, JSValueConst this_val, int
 
     switch_core_session_write_frame(jss->session, &write_frame, SWITCH_IO_FLAG_NONE, 0);
 
+    /* the frame is out, there is a whole ptime until the next one */
+    script_gc_idle(JS_GetContextOpaque(ctx));
+
     return JS_NewInt64(ctx, len);
 }
 
@@ -1928,15 +1939,8 @@ static const JSCFunctionListEntry js_session_proto_funcs[] = {
     JS_CFUNC_DEF("sayPhrase", 1, js_session_say_phrase)
 };
 
-static void js_session_finalizer(JSRuntime *rt, JSValue val) {
-    js_session_t *jss = JS_GetOpaque(val, js_session_get_classid2(rt));
-    uint8_t fl_wloop = false;
-
-    if(!jss) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "(jss == NULL)\n");
-        return;
-    }
-
+/* stops the streams and releases the channel, the object stays but doesn't refer to the session anymore */
+static void js_session_detach(js_session_t *jss) {
     jss->fl_ready = false;
 
     if(jss->bg_streams) {
@@ -1945,21 +1949,13 @@ static void js_session_finalizer(JSRuntime *rt, JSValue val) {
 
     if(jss->mutex) {
         switch_mutex_lock(jss->mutex);
-        fl_wloop = (jss->wlock > 0);
-        switch_mutex_unlock(jss->mutex);
-
-        if(fl_wloop) {
+        while(jss->wlock > 0) {
 #ifdef MOD_QUICKJS_DEBUG
             switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Waiting for unlock ('%d' locks) ...\n", jss->wlock);
 #endif
-
-            while(fl_wloop) {
-                switch_mutex_lock(jss->mutex);
-                fl_wloop = (jss->wlock > 0);
-                switch_mutex_unlock(jss->mutex);
-                switch_yield(100000);
-            }
+            switch_thread_cond_timedwait(jss->cond, jss->mutex, 1000000);
         }
+        switch_mutex_unlock(jss->mutex);
     }
 
     if(jss->session) {
@@ -1976,6 +1972,19 @@ static void js_session_finalizer(JSRuntime *rt, JSValue val) {
             switch_core_session_rwunlock(jss->session);
         }
     }
+}
+
+static void js_session_finalizer(JSRuntime *rt, JSValue val) {
+    js_session_t *jss = JS_GetOpaque(val, js_session_get_classid2(rt));
+
+    if(!jss) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "(jss == NULL)\n");
+        return;
+    }
+
+    js_native_object_finalized(rt);
+
+    js_session_detach(jss);
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-session-finalizer: jss=%p, session=%p\n", jss, jss->session);
@@ -2063,6 +2072,7 @@ static JSValue js_session_contructor(JSContext *ctx, JSValueConst new_target, in
 
 
     switch_mutex_init(&jss->mutex, SWITCH_MUTEX_NESTED, switch_core_session_get_pool(jss->session));
+    switch_thread_cond_create(&jss->cond, switch_core_session_get_pool(jss->session));
     switch_core_session_get_read_impl(jss->session, &read_impl);
 
     jss->ctx = ctx;
@@ -2077,6 +2087,7 @@ static JSValue js_session_contructor(JSContext *ctx, JSValueConst new_target, in
 
 out:
     JS_SetOpaque(obj, jss);
+    js_native_object_created(ctx);
     JS_FreeCString(ctx, data);
 
 #ifdef MOD_QUICKJS_DEBUG
@@ -2100,35 +2111,27 @@ fail:
 // Public
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------
 JSClassID js_session_get_classid2(JSRuntime *rt) {
-    script_t *script = JS_GetRuntimeOpaque(rt);
-    switch_assert(script);
-    return script->class_id_session;
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(rt);
+    switch_assert(jsrt);
+    if(!jsrt->class_id_session) {
+        jsrt->class_id_session = js_class_id_register(rt, JS_CLASS_ID_SESSION, &js_session_class);
+    }
+    return jsrt->class_id_session;
 }
 JSClassID js_session_get_classid(JSContext *ctx) {
     return  js_session_get_classid2(JS_GetRuntime(ctx));
 }
 
-switch_status_t js_session_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id) {
+switch_status_t js_session_class_register(JSContext *ctx, JSValue global_obj) {
+    JSClassID class_id = js_session_get_classid(ctx);
     JSValue obj_proto, obj_class;
-    script_t *script = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
-
-    switch_assert(script);
-
-    if(JS_IsRegisteredClass(JS_GetRuntime(ctx), class_id)) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Class with id (%d) already registered!\n", class_id);
-        return SWITCH_STATUS_FALSE;
-    }
-
-    JS_NewClassID(&class_id);
-    JS_NewClass(JS_GetRuntime(ctx), class_id, &js_session_class);
-    script->class_id_session = class_id;
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Class registered [%s / %d]\n", CLASS_NAME, class_id);
 #endif
 
     obj_proto = JS_NewObject(ctx);
-    JS_SetPropertyFunctionList(ctx, obj_proto, js_session_proto_funcs, ARRAY_SIZE(js_session_proto_funcs));
+    js_set_function_list(ctx, obj_proto, CLASS_NAME, js_session_proto_funcs, ARRAY_SIZE(js_session_proto_funcs));
 
     obj_class = JS_NewCFunction2(ctx, js_session_contructor, CLASS_NAME, 2, JS_CFUNC_constructor, 0);
     JS_SetConstructor(ctx, obj_class, obj_proto);
@@ -2152,7 +2155,7 @@ JSValue js_session_object_create(JSContext *ctx, switch_core_session_t *session)
 
     proto = JS_NewObject(ctx);
     if(JS_IsException(proto)) { return proto; }
-    JS_SetPropertyFunctionList(ctx, proto, js_session_proto_funcs, ARRAY_SIZE(js_session_proto_funcs));
+    js_set_function_list(ctx, proto, CLASS_NAME, js_session_proto_funcs, ARRAY_SIZE(js_session_proto_funcs));
 
     obj = JS_NewObjectProtoClass(ctx, proto, js_session_get_classid(ctx));
     JS_FreeValue(ctx, proto);
@@ -2160,6 +2163,7 @@ JSValue js_session_object_create(JSContext *ctx, switch_core_session_t *session)
 
     //
     switch_mutex_init(&jss->mutex, SWITCH_MUTEX_NESTED, switch_core_session_get_pool(session));
+    switch_thread_cond_create(&jss->cond, switch_core_session_get_pool(session));
     switch_core_session_get_read_impl(session, &read_impl);
 
     jss->ctx = ctx;
@@ -2176,6 +2180,7 @@ JSValue js_session_object_create(JSContext *ctx, switch_core_session_t *session)
     jss->fl_no_unlock = true;
 
     JS_SetOpaque(obj, jss);
+    js_native_object_created(ctx);
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-session-obj-created: jss=%p, session=%p\n", jss, jss->session);
@@ -2184,6 +2189,25 @@ JSValue js_session_object_create(JSContext *ctx, switch_core_session_t *session)
     return obj;
 }
 
+/**
+ ** releases the session which was lent to the script (see: service.c)
+ ** the object can outlive the session, it behaves as not initialized after that
+ **/
+void js_session_object_detach(JSContext *ctx, JSValueConst obj) {
+    js_session_t *jss = JS_GetOpaque(obj, js_session_get_classid(ctx));
+
+    if(!jss || !jss->session) {
+        return;
+    }
+
+    js_session_detach(jss);
+
+    /* the mutex and the cond belong to the session pool */
+    jss->session = NULL;
+    jss->mutex = NULL;
+    jss->cond = NULL;
+}
+
 JSValue js_session_ext_bridge(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
     js_session_t *jss_a = NULL;
     js_session_t *jss_b = NULL;
@@ -12,6 +12,7 @@ typedef struct {
     switch_core_session_t   *session;
     JSContext               *ctx;
     switch_mutex_t          *mutex;
+    switch_thread_cond_t    *cond;              // signaled when wlock or bg_streams drops to 0
     switch_file_handle_t    *bg_stream_fh;
     switch_file_handle_t    *fg_stream_fh;
     JSValue                 on_hangup;
@@ -34,9 +35,10 @@ typedef struct {
 /* js_session.c */
 JSClassID js_session_get_classid(JSContext *ctx);
 JSClassID js_session_get_classid2(JSRuntime *rt);
-switch_status_t js_session_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id);
+switch_status_t js_session_class_register(JSContext *ctx, JSValue global_obj);
 
 JSValue js_session_object_create(JSContext *ctx, switch_core_session_t *session);
+void js_session_object_detach(JSContext *ctx, JSValueConst obj);
 JSValue js_session_ext_bridge(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
 
 /* js_session_misc.c */
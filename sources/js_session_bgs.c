@@ -6,6 +6,8 @@
 
 extern globals_t globals;
 
+#define BG_STREAM_STOP_TIMEOUT_US   5000000
+
 typedef struct {
     char                    *data;
     switch_memory_pool_t    *pool;
@@ -105,6 +107,9 @@ static switch_status_t session_playback_perform(js_session_t *jss, switch_memory
         switch_mutex_lock(jss->mutex);
         if(jss->bg_streams) jss->bg_streams--;
         jss->bg_stream_fh = NULL;
+        if(!jss->bg_streams && jss->cond) {
+            switch_thread_cond_broadcast(jss->cond);
+        }
         switch_mutex_unlock(jss->mutex);
 
         js_session_release(jss);
@@ -141,7 +146,10 @@ switch_status_t js_session_bgs_stream_start(js_session_t *jss, const char *path)
     params->data = switch_core_strdup(pool_local, path);
 
     if(js_session_take(params->js_session)) {
-        launch_thread(pool_local, bg_playback_thread, params);
+        if((status = wpool_submit(WPOOL_PRIO_AUX, bg_playback_thread, params)) != SWITCH_STATUS_SUCCESS) {
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Unable to start background playback (workers are busy)\n");
+            js_session_release(params->js_session);
+        }
     }
 
 out:
@@ -156,22 +164,25 @@ out:
 
 switch_status_t js_session_bgs_stream_stop(js_session_t *jss) {
     switch_status_t  status = SWITCH_STATUS_SUCCESS;
-    uint32_t x = 0;
+    switch_time_t deadline = 0, now = 0;
 
     if(jss->bg_streams) {
         switch_channel_set_flag(switch_core_session_get_channel(jss->session), CF_BREAK);
+        deadline = switch_micro_time_now() + BG_STREAM_STOP_TIMEOUT_US;
 
+        switch_mutex_lock(jss->mutex);
         while(jss->bg_streams) {
             if(globals.fl_shutdown || !jss->fl_ready) {
                 break;
             }
-            if(++x > 500) {
+            if((now = switch_micro_time_now()) >= deadline) {
                 switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Unable to stop background stream (session: %s)\n", jss->session_id);
                 status = SWITCH_STATUS_FALSE;
                 break;
             }
-            switch_yield(10000);
+            switch_thread_cond_timedwait(jss->cond, jss->mutex, (deadline - now));
         }
+        switch_mutex_unlock(jss->mutex);
     }
 
     return status;
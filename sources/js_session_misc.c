@@ -24,6 +24,9 @@ void js_session_release(js_session_t *session) {
 
     switch_mutex_lock(session->mutex);
     if(session->wlock) { session->wlock--; }
+    if(!session->wlock && session->cond) {
+        switch_thread_cond_broadcast(session->cond);
+    }
     switch_mutex_unlock(session->mutex);
 }
 
@@ -0,0 +1,667 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "js_sharedmap.h"
+
+#define CLASS_NAME              "SharedMap"
+#define PROP_NAME               0
+
+#define SHMAP_STRIPES           64
+#define SHMAP_SWEEP_INTERVAL    1000000     // us
+#define SHMAP_DEFAULT_NAME      "default"
+
+typedef struct {
+    switch_mutex_t          *mutex;
+    switch_hash_t           *hash;
+    uint32_t                count;
+    uint32_t                ttl_count;      // entries with expiry, the sweep is skipped without them
+    switch_time_t           swept;
+} shmap_stripe_t;
+
+static struct {
+    shmap_stripe_t          stripes[SHMAP_STRIPES];
+    uint64_t                expired;
+    uint8_t                 fl_ready;
+} store;
+
+static void js_sharedmap_finalizer(JSRuntime *rt, JSValue val);
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+// store
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+static shmap_stripe_t *shmap_stripe(const char *key) {
+    uint32_t h = 2166136261U;
+
+    for(const char *p = key; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619U;
+    }
+
+    return &store.stripes[h % SHMAP_STRIPES];
+}
+
+static void shmap_entry_free(shmap_entry_t **entry) {
+    if(entry && *entry) {
+        switch_safe_free((*entry)->data);
+        switch_safe_free(*entry);
+    }
+}
+
+/* must be called under the stripe mutex */
+static void shmap_delete(shmap_stripe_t *stripe, const char *key) {
+    shmap_entry_t *entry = switch_core_hash_delete(stripe->hash, key);
+
+    if(entry) {
+        if(entry->expires && stripe->ttl_count) stripe->ttl_count--;
+        if(stripe->count) stripe->count--;
+        shmap_entry_free(&entry);
+    }
+}
+
+/* must be called under the stripe mutex, expired entries are removed on access */
+static shmap_entry_t *shmap_lookup(shmap_stripe_t *stripe, const char *key, switch_time_t now) {
+    shmap_entry_t *entry = switch_core_hash_find(stripe->hash, key);
+
+    if(entry && entry->expires && entry->expires <= now) {
+        shmap_delete(stripe, key);
+        __atomic_add_fetch(&store.expired, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    return entry;
+}
+
+/* must be called under the stripe mutex, replaces the existing entry */
+static void shmap_store(shmap_stripe_t *stripe, const char *key, shmap_entry_t *entry) {
+    shmap_delete(stripe, key);
+    switch_core_hash_insert(stripe->hash, key, entry);
+
+    stripe->count++;
+    if(entry->expires) stripe->ttl_count++;
+}
+
+/* must be called under the stripe mutex */
+static void shmap_sweep(shmap_stripe_t *stripe, switch_time_t now) {
+    switch_hash_index_t *hidx = NULL;
+    char **keys = NULL;
+    uint32_t keys_len = 0, keys_size = 0;
+    const void *hkey = NULL;
+    void *hval = NULL;
+
+    if(!stripe->ttl_count || (now - stripe->swept) < SHMAP_SWEEP_INTERVAL) {
+        return;
+    }
+    stripe->swept = now;
+
+    for(hidx = switch_core_hash_first_iter(stripe->hash, hidx); hidx; hidx = switch_core_hash_next(&hidx)) {
+        shmap_entry_t *entry = NULL;
+
+        switch_core_hash_this(hidx, &hkey, NULL, &hval);
+        entry = (shmap_entry_t *)hval;
+
+        if(entry->expires && entry->expires <= now) {
+            if(keys_len == keys_size) {
+                keys_size = (keys_size ? keys_size * 2 : 32);
+                keys = realloc(keys, sizeof(char *) * keys_size);
+                switch_assert(keys);
+            }
+            keys[keys_len++] = strdup((char *)hkey);
+        }
+    }
+    switch_safe_free(hidx);
+
+    for(uint32_t i = 0; i < keys_len; i++) {
+        shmap_delete(stripe, keys[i]);
+        switch_safe_free(keys[i]);
+    }
+    __atomic_add_fetch(&store.expired, keys_len, __ATOMIC_RELAXED);
+    switch_safe_free(keys);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+static char *js_sharedmap_key(JSContext *ctx, js_sharedmap_t *js_sharedmap, JSValueConst jkey) {
+    const char *key = NULL;
+    char *full_key = NULL;
+
+    if(QJS_IS_NULL(jkey) || !(key = JS_ToCString(ctx, jkey)) || zstr(key)) {
+        JS_FreeCString(ctx, key);
+        JS_ThrowTypeError(ctx, "Invalid argument: key");
+        return NULL;
+    }
+
+    full_key = switch_mprintf("%s/%s", js_sharedmap->name, key);
+    JS_FreeCString(ctx, key);
+
+    return full_key;
+}
+
+/* returns a new entry or NULL (the exception is thrown) */
+static shmap_entry_t *js_sharedmap_entry_create(JSContext *ctx, JSValueConst val, uint32_t ttl) {
+    shmap_entry_t *entry = NULL;
+    const char *str = NULL;
+    uint8_t *buf = NULL;
+    size_t len = 0;
+
+    switch_zmalloc(entry, sizeof(shmap_entry_t));
+
+    if(JS_IsBool(val)) {
+        entry->type = SHMAP_TYPE_BOOL;
+        entry->ival = JS_ToBool(ctx, val);
+    } else if(JS_IsNumber(val)) {
+        if(JS_VALUE_GET_TAG(val) == JS_TAG_INT) {
+            entry->type = SHMAP_TYPE_INT;
+            JS_ToInt64(ctx, &entry->ival, val);
+        } else {
+            entry->type = SHMAP_TYPE_DOUBLE;
+            JS_ToFloat64(ctx, &entry->dval, val);
+        }
+    } else if(JS_IsString(val)) {
+        if(!(str = JS_ToCStringLen(ctx, &len, val))) {
+            goto fail;
+        }
+        entry->type = SHMAP_TYPE_STRING;
+        entry->len = len;
+        switch_malloc(entry->data, len + 1);
+        memcpy(entry->data, str, len);
+        entry->data[len] = '\0';
+        JS_FreeCString(ctx, str);
+    } else if(JS_IsObject(val) && (buf = JS_GetArrayBuffer(ctx, &len, val))) {
+        entry->type = SHMAP_TYPE_BUFFER;
+        entry->len = len;
+        if(len) {
+            switch_malloc(entry->data, len);
+            memcpy(entry->data, buf, len);
+        }
+    } else {
+        if(JS_IsObject(val)) {
+            JS_FreeValue(ctx, JS_GetException(ctx));
+        }
+        JS_ThrowTypeError(ctx, "Unsupported value type (expected: boolean, number, string, ArrayBuffer)");
+        goto fail;
+    }
+
+    entry->expires = (ttl ? switch_micro_time_now() + ((switch_time_t)ttl * 1000) : 0);
+    return entry;
+fail:
+    shmap_entry_free(&entry);
+    return NULL;
+}
+
+static JSValue js_sharedmap_entry_value(JSContext *ctx, shmap_entry_t *entry) {
+    switch(entry->type) {
+        case SHMAP_TYPE_INT:
+            return JS_NewInt64(ctx, entry->ival);
+        case SHMAP_TYPE_DOUBLE:
+            return JS_NewFloat64(ctx, entry->dval);
+        case SHMAP_TYPE_STRING:
+            return JS_NewStringLen(ctx, (char *)entry->data, entry->len);
+        case SHMAP_TYPE_BUFFER:
+            return JS_NewArrayBufferCopy(ctx, entry->data, entry->len);
+        case SHMAP_TYPE_BOOL:
+            return JS_NewBool(ctx, entry->ival);
+    }
+    return JS_UNDEFINED;
+}
+
+static uint8_t js_sharedmap_entry_equals(shmap_entry_t *a, shmap_entry_t *b) {
+    if((a->type == SHMAP_TYPE_INT && b->type == SHMAP_TYPE_INT) || (a->type == SHMAP_TYPE_BOOL && b->type == SHMAP_TYPE_BOOL)) {
+        return (a->ival == b->ival);
+    }
+    if((a->type == SHMAP_TYPE_INT || a->type == SHMAP_TYPE_DOUBLE) && (b->type == SHMAP_TYPE_INT || b->type == SHMAP_TYPE_DOUBLE)) {
+        return ((a->type == SHMAP_TYPE_INT ? (double)a->ival : a->dval) == (b->type == SHMAP_TYPE_INT ? (double)b->ival : b->dval));
+    }
+    if(a->type != b->type || a->len != b->len) {
+        return false;
+    }
+    return (a->len == 0 || memcmp(a->data, b->data, a->len) == 0);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+static JSValue js_sharedmap_property_get(JSContext *ctx, JSValueConst this_val, int magic) {
+    js_sharedmap_t *js_sharedmap = JS_GetOpaque2(ctx, this_val, js_sharedmap_get_classid(ctx));
+
+    if(!js_sharedmap) {
+        return JS_UNDEFINED;
+    }
+
+    switch(magic) {
+        case PROP_NAME:
+            return JS_NewString(ctx, js_sharedmap->name);
+    }
+
+    return JS_UNDEFINED;
+}
+
+static JSValue js_sharedmap_property_set(JSContext *ctx, JSValueConst this_val, JSValue val, int magic) {
+    return JS_FALSE;
+}
+
+// get(key)
+static JSValue js_sharedmap_get(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    js_sharedmap_t *js_sharedmap = JS_GetOpaque2(ctx, this_val, js_sharedmap_get_classid(ctx));
+    JSValue ret_val = JS_UNDEFINED;
+    shmap_stripe_t *stripe = NULL;
+    shmap_entry_t *entry = NULL;
+    char *key = NULL;
+
+    if(!js_sharedmap) {
+        return JS_ThrowTypeError(ctx, "Invalid object");
+    }
+    if(argc < 1) {
+        return JS_ThrowTypeError(ctx, "Not enough arguments");
+    }
+    if(!(key = js_sharedmap_key(ctx, js_sharedmap, argv[0]))) {
+        return JS_EXCEPTION;
+    }
+
+    stripe = shmap_stripe(key);
+    switch_mutex_lock(stripe->mutex);
+    if((entry = shmap_lookup(stripe, key, switch_micro_time_now()))) {
+        ret_val = js_sharedmap_entry_value(ctx, entry);
+    }
+    switch_mutex_unlock(stripe->mutex);
+
+    switch_safe_free(key);
+    return ret_val;
+}
+
+// set(key, value, [ttl])
+static JSValue js_sharedmap_set(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    js_sharedmap_t *js_sharedmap = JS_GetOpaque2(ctx, this_val, js_sharedmap_get_classid(ctx));
+    shmap_stripe_t *stripe = NULL;
+    shmap_entry_t *entry = NULL;
+    switch_time_t now = 0;
+    uint32_t ttl = 0;
+    char *key = NULL;
+
+    if(!js_sharedmap) {
+        return JS_ThrowTypeError(ctx, "Invalid object");
+    }
+    if(argc < 2) {
+        return JS_ThrowTypeError(ctx, "Not enough arguments");
+    }
+    if(argc > 2) {
+        JS_ToUint32(ctx, &ttl, argv[2]);
+    }
+    if(!(entry = js_sharedmap_entry_create(ctx, argv[1], ttl))) {
+        return JS_EXCEPTION;
+    }
+    if(!(key = js_sharedmap_key(ctx, js_sharedmap, argv[0]))) {
+        shmap_entry_free(&entry);
+        return JS_EXCEPTION;
+    }
+
+    now = switch_micro_time_now();
+    stripe = shmap_stripe(key);
+
+    switch_mutex_lock(stripe->mutex);
+    shmap_sweep(stripe, now);
+    shmap_store(stripe, key, entry);
+    switch_mutex_unlock(stripe->mutex);
+
+    switch_safe_free(key);
+    return JS_TRUE;
+}
+
+// has(key)
+static JSValue js_sharedmap_has(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    js_sharedmap_t *js_sharedmap = JS_GetOpaque2(ctx, this_val, js_sharedmap_get_classid(ctx));
+    shmap_stripe_t *stripe = NULL;
+    uint8_t found = false;
+    char *key = NULL;
+
+    if(!js_sharedmap) {
+        return JS_ThrowTypeError(ctx, "Invalid object");
+    }
+    if(argc < 1) {
+        return JS_ThrowTypeError(ctx, "Not enough arguments");
+    }
+    if(!(key = js_sharedmap_key(ctx, js_sharedmap, argv[0]))) {
+        return JS_EXCEPTION;
+    }
+
+    stripe = shmap_stripe(key);
+    switch_mutex_lock(stripe->mutex);
+    found = (shmap_lookup(stripe, key, switch_micro_time_now()) != NULL);
+    switch_mutex_unlock(stripe->mutex);
+
+    switch_safe_free(key);
+    return (found ? JS_TRUE : JS_FALSE);
+}
+
+// delete(key)
+static JSValue js_sharedmap_delete(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    js_sharedmap_t *js_sharedmap = JS_GetOpaque2(ctx, this_val, js_sharedmap_get_classid(ctx));
+    shmap_stripe_t *stripe = NULL;
+    uint8_t found = false;
+    char *key = NULL;
+
+    if(!js_sharedmap) {
+        return JS_ThrowTypeError(ctx, "Invalid object");
+    }
+    if(argc < 1) {
+        return JS_ThrowTypeError(ctx, "Not enough arguments");
+    }
+    if(!(key = js_sharedmap_key(ctx, js_sharedmap, argv[0]))) {
+        return JS_EXCEPTION;
+    }
+
+    stripe = shmap_stripe(key);
+    switch_mutex_lock(stripe->mutex);
+    if((found = (shmap_lookup(stripe, key, switch_micro_time_now()) != NULL))) {
+        shmap_delete(stripe, key);
+    }
+    switch_mutex_unlock(stripe->mutex);
+
+    switch_safe_free(key);
+    return (found ? JS_TRUE : JS_FALSE);
+}
+
+// incr(key, [delta], [ttl]) - returns the new value, a missed key starts from 0, ttl is applied only to the new key
+static JSValue js_sharedmap_incr(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    js_sharedmap_t *js_sharedmap = JS_GetOpaque2(ctx, this_val, js_sharedmap_get_classid(ctx));
+    JSValue ret_val = JS_UNDEFINED;
+    shmap_stripe_t *stripe = NULL;
+    shmap_entry_t *entry = NULL;
+    switch_time_t now = 0;
+    int64_t delta = 1;
+    uint32_t ttl = 0;
+    char *key = NULL;
+
+    if(!js_sharedmap) {
+        return JS_ThrowTypeError(ctx, "Invalid object");
+    }
+    if(argc < 1) {
+        return JS_ThrowTypeError(ctx, "Not enough arguments");
+    }
+    if(argc > 1 && !QJS_IS_NULL(argv[1])) {
+        JS_ToInt64(ctx, &delta, argv[1]);
+    }
+    if(argc > 2) {
+        JS_ToUint32(ctx, &ttl, argv[2]);
+    }
+    if(!(key = js_sharedmap_key(ctx, js_sharedmap, argv[0]))) {
+        return JS_EXCEPTION;
+    }
+
+    now = switch_micro_time_now();
+    stripe = shmap_stripe(key);
+
+    switch_mutex_lock(stripe->mutex);
+    shmap_sweep(stripe, now);
+
+    if(!(entry = shmap_lookup(stripe, key, now))) {
+        switch_zmalloc(entry, sizeof(shmap_entry_t));
+        entry->type = SHMAP_TYPE_INT;
+        entry->expires = (ttl ? now + ((switch_time_t)ttl * 1000) : 0);
+        shmap_store(stripe, key, entry);
+    }
+
+    if(entry->type == SHMAP_TYPE_INT) {
+        entry->ival += delta;
+        ret_val = JS_NewInt64(ctx, entry->ival);
+    } else if(entry->type == SHMAP_TYPE_DOUBLE) {
+        entry->dval += delta;
+        ret_val = JS_NewFloat64(ctx, entry->dval);
+    } else {
+        ret_val = JS_ThrowTypeError(ctx, "Value is not a number");
+    }
+    switch_mutex_unlock(stripe->mutex);
+
+    switch_safe_free(key);
+    return ret_val;
+}
+
+// cas(key, expected, value, [ttl]) - expected 'undefined' means the key must not exist
+static JSValue js_sharedmap_cas(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    js_sharedmap_t *js_sharedmap = JS_GetOpaque2(ctx, this_val, js_sharedmap_get_classid(ctx));
+    shmap_entry_t *expected = NULL, *entry = NULL, *cur = NULL;
+    shmap_stripe_t *stripe = NULL;
+    switch_time_t now = 0;
+    uint8_t success = false;
+    uint32_t ttl = 0;
+    char *key = NULL;
+
+    if(!js_sharedmap) {
+        return JS_ThrowTypeError(ctx, "Invalid object");
+    }
+    if(argc < 3) {
+        return JS_ThrowTypeError(ctx, "Not enough arguments");
+    }
+    if(argc > 3) {
+        JS_ToUint32(ctx, &ttl, argv[3]);
+    }
+    if(!QJS_IS_NULL(argv[1]) && !(expected = js_sharedmap_entry_create(ctx, argv[1], 0))) {
+        return JS_EXCEPTION;
+    }
+    if(!(entry = js_sharedmap_entry_create(ctx, argv[2], ttl))) {
+        goto out;
+    }
+    if(!(key = js_sharedmap_key(ctx, js_sharedmap, argv[0]))) {
+        goto out;
+    }
+
+    now = switch_micro_time_now();
+    stripe = shmap_stripe(key);
+
+    switch_mutex_lock(stripe->mutex);
+    cur = shmap_lookup(stripe, key, now);
+    if(expected ? (cur && js_sharedmap_entry_equals(cur, expected)) : (cur == NULL)) {
+        shmap_store(stripe, key, entry);
+        entry = NULL;
+        success = true;
+    }
+    switch_mutex_unlock(stripe->mutex);
+
+out:
+    shmap_entry_free(&expected);
+    shmap_entry_free(&entry);
+    if(!key) {
+        return JS_EXCEPTION;
+    }
+    switch_safe_free(key);
+    return (success ? JS_TRUE : JS_FALSE);
+}
+
+// ttl(key) - remaining time to live (ms), -1 if the key doesn't expire
+static JSValue js_sharedmap_ttl(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    js_sharedmap_t *js_sharedmap = JS_GetOpaque2(ctx, this_val, js_sharedmap_get_classid(ctx));
+    JSValue ret_val = JS_UNDEFINED;
+    shmap_stripe_t *stripe = NULL;
+    shmap_entry_t *entry = NULL;
+    switch_time_t now = 0;
+    char *key = NULL;
+
+    if(!js_sharedmap) {
+        return JS_ThrowTypeError(ctx, "Invalid object");
+    }
+    if(argc < 1) {
+        return JS_ThrowTypeError(ctx, "Not enough arguments");
+    }
+    if(!(key = js_sharedmap_key(ctx, js_sharedmap, argv[0]))) {
+        return JS_EXCEPTION;
+    }
+
+    now = switch_micro_time_now();
+    stripe = shmap_stripe(key);
+
+    switch_mutex_lock(stripe->mutex);
+    if((entry = shmap_lookup(stripe, key, now))) {
+        ret_val = JS_NewInt64(ctx, (entry->expires ? (entry->expires - now) / 1000 : -1));
+    }
+    switch_mutex_unlock(stripe->mutex);
+
+    switch_safe_free(key);
+    return ret_val;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+static JSClassDef js_sharedmap_class = {
+    CLASS_NAME,
+    .finalizer = js_sharedmap_finalizer,
+};
+
+static const JSCFunctionListEntry js_sharedmap_proto_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("name", js_sharedmap_property_get, js_sharedmap_property_set, PROP_NAME),
+    //
+    JS_CFUNC_DEF("get", 1, js_sharedmap_get),
+    JS_CFUNC_DEF("set", 3, js_sharedmap_set),
+    JS_CFUNC_DEF("has", 1, js_sharedmap_has),
+    JS_CFUNC_DEF("delete", 1, js_sharedmap_delete),
+    JS_CFUNC_DEF("incr", 3, js_sharedmap_incr),
+    JS_CFUNC_DEF("cas", 4, js_sharedmap_cas),
+    JS_CFUNC_DEF("ttl", 1, js_sharedmap_ttl),
+};
+
+static void js_sharedmap_finalizer(JSRuntime *rt, JSValue val) {
+    js_sharedmap_t *js_sharedmap = JS_GetOpaque(val, js_sharedmap_get_classid2(rt));
+
+    if(!js_sharedmap) {
+        return;
+    }
+
+    js_native_object_finalized(rt);
+
+#ifdef MOD_QUICKJS_DEBUG
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-sharedmap-finalizer: js_sharedmap=%p\n", js_sharedmap);
+#endif
+
+    switch_safe_free(js_sharedmap->name);
+    js_free_rt(rt, js_sharedmap);
+}
+
+// new SharedMap([name])
+static JSValue js_sharedmap_contructor(JSContext *ctx, JSValueConst new_target, int argc, JSValueConst *argv) {
+    js_sharedmap_t *js_sharedmap = NULL;
+    const char *name = NULL;
+    JSValue obj = JS_UNDEFINED;
+    JSValue err = JS_UNDEFINED;
+    JSValue proto;
+
+    if(argc > 0 && !QJS_IS_NULL(argv[0])) {
+        name = JS_ToCString(ctx, argv[0]);
+    }
+
+    js_sharedmap = js_mallocz(ctx, sizeof(js_sharedmap_t));
+    if(!js_sharedmap) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "js_mallocz()\n");
+        goto fail;
+    }
+    js_sharedmap->name = strdup(zstr(name) ? SHMAP_DEFAULT_NAME : name);
+
+    proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+    if(JS_IsException(proto)) { goto fail; }
+
+    obj = JS_NewObjectProtoClass(ctx, proto, js_sharedmap_get_classid(ctx));
+    JS_FreeValue(ctx, proto);
+    if(JS_IsException(obj)) { goto fail; }
+
+    JS_SetOpaque(obj, js_sharedmap);
+    js_native_object_created(ctx);
+
+#ifdef MOD_QUICKJS_DEBUG
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-sharedmap-constructor: js_sharedmap=%p, name=%s\n", js_sharedmap, js_sharedmap->name);
+#endif
+
+    JS_FreeCString(ctx, name);
+    return obj;
+fail:
+    if(js_sharedmap) {
+        switch_safe_free(js_sharedmap->name);
+        js_free(ctx, js_sharedmap);
+    }
+    JS_FreeCString(ctx, name);
+    JS_FreeValue(ctx, obj);
+    return (JS_IsUndefined(err) ? JS_EXCEPTION : err);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+// Public
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+JSClassID js_sharedmap_get_classid2(JSRuntime *rt) {
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(rt);
+    switch_assert(jsrt);
+    if(!jsrt->class_id_sharedmap) {
+        jsrt->class_id_sharedmap = js_class_id_register(rt, JS_CLASS_ID_SHAREDMAP, &js_sharedmap_class);
+    }
+    return jsrt->class_id_sharedmap;
+}
+JSClassID js_sharedmap_get_classid(JSContext *ctx) {
+    return  js_sharedmap_get_classid2(JS_GetRuntime(ctx));
+}
+
+switch_status_t js_sharedmap_class_register(JSContext *ctx, JSValue global_obj) {
+    JSClassID class_id = js_sharedmap_get_classid(ctx);
+    JSValue obj_proto, obj_class;
+
+#ifdef MOD_QUICKJS_DEBUG
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Class registered [%s / %d]\n", CLASS_NAME, class_id);
+#endif
+
+    obj_proto = JS_NewObject(ctx);
+    js_set_function_list(ctx, obj_proto, CLASS_NAME, js_sharedmap_proto_funcs, ARRAY_SIZE(js_sharedmap_proto_funcs));
+
+    obj_class = JS_NewCFunction2(ctx, js_sharedmap_contructor, CLASS_NAME, 1, JS_CFUNC_constructor, 0);
+    JS_SetConstructor(ctx, obj_class, obj_proto);
+    JS_SetClassProto(ctx, class_id, obj_proto);
+
+    JS_SetPropertyStr(ctx, global_obj, CLASS_NAME, obj_class);
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+switch_status_t js_sharedmap_store_init(switch_memory_pool_t *pool) {
+    memset(&store, 0, sizeof(store));
+
+    for(int i = 0; i < SHMAP_STRIPES; i++) {
+        switch_mutex_init(&store.stripes[i].mutex, SWITCH_MUTEX_NESTED, pool);
+        switch_core_hash_init(&store.stripes[i].hash);
+    }
+    store.fl_ready = true;
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+void js_sharedmap_store_shutdown() {
+    switch_hash_index_t *hidx = NULL;
+    void *hval = NULL;
+
+    if(!store.fl_ready) {
+        return;
+    }
+    store.fl_ready = false;
+
+    for(int i = 0; i < SHMAP_STRIPES; i++) {
+        shmap_stripe_t *stripe = &store.stripes[i];
+
+        switch_mutex_lock(stripe->mutex);
+        for(hidx = switch_core_hash_first_iter(stripe->hash, hidx); hidx; hidx = switch_core_hash_next(&hidx)) {
+            shmap_entry_t *entry = NULL;
+
+            switch_core_hash_this(hidx, NULL, NULL, &hval);
+            entry = (shmap_entry_t *)hval;
+            shmap_entry_free(&entry);
+        }
+        switch_safe_free(hidx);
+        switch_core_hash_destroy(&stripe->hash);
+        switch_mutex_unlock(stripe->mutex);
+    }
+}
+
+void js_sharedmap_store_stats(switch_stream_handle_t *stream) {
+    uint32_t count = 0, ttl_count = 0, stripe_max = 0;
+
+    for(int i = 0; i < SHMAP_STRIPES; i++) {
+        shmap_stripe_t *stripe = &store.stripes[i];
+
+        switch_mutex_lock(stripe->mutex);
+        count += stripe->count;
+        ttl_count += stripe->ttl_count;
+        if(stripe->count > stripe_max) stripe_max = stripe->count;
+        switch_mutex_unlock(stripe->mutex);
+    }
+
+    stream->write_function(stream, "entries: %u (with ttl: %u), expired: %"SWITCH_UINT64_T_FMT", stripes: %u (max entries per stripe: %u)\n",
+        count, ttl_count, __atomic_load_n(&store.expired, __ATOMIC_RELAXED), SHMAP_STRIPES, stripe_max
+    );
+}
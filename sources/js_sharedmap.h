@@ -0,0 +1,37 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#ifndef JS_SHAREDMAP_H
+#define JS_SHAREDMAP_H
+#include "mod_quickjs.h"
+
+#define SHMAP_TYPE_INT      1
+#define SHMAP_TYPE_DOUBLE   2
+#define SHMAP_TYPE_STRING   3
+#define SHMAP_TYPE_BUFFER   4
+#define SHMAP_TYPE_BOOL     5
+
+typedef struct {
+    uint8_t                 type;
+    int64_t                 ival;           // int / bool
+    double                  dval;
+    uint8_t                 *data;          // string / buffer
+    size_t                  len;
+    switch_time_t           expires;        // 0 - never
+} shmap_entry_t;
+
+typedef struct {
+    char                    *name;
+} js_sharedmap_t;
+
+JSClassID js_sharedmap_get_classid(JSContext *ctx);
+JSClassID js_sharedmap_get_classid2(JSRuntime *rt);
+switch_status_t js_sharedmap_class_register(JSContext *ctx, JSValue global_obj);
+
+switch_status_t js_sharedmap_store_init(switch_memory_pool_t *pool);
+void js_sharedmap_store_shutdown();
+void js_sharedmap_store_stats(switch_stream_handle_t *stream);
+
+#endif
+
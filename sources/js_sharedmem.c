@@ -0,0 +1,445 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "js_sharedmem.h"
+#include <math.h>
+
+extern globals_t globals;
+
+#define CLASS_NAME              "SharedMemory"
+#define SHMEM_NAME_MAX          128
+#define SHMEM_WAIT_SLICE_US     100000
+#define SHMEM_HDR_SIZE          ((sizeof(shmem_region_t) + 15) & ~((size_t)15))   // keeps the data aligned for Atomics
+
+/**
+ ** the SharedArrayBuffer memory of all runtimes comes from here (JS_SetSharedArrayBufferFunctions),
+ ** a region is refcounted by the buffers which refer to it, so SharedMemory.open() can give the same memory
+ ** to any runtime: it lives while at least one script holds a buffer of it.
+ ** Atomics.wait/notify work across the runtimes (the runtimes are allowed to block, see js_atomics_wait)
+ ** the anonymous buffers (new SharedArrayBuffer) never leave their runtime (channels don't pass them),
+ ** so they are allocated by the runtime itself (sab_opaque): rt-memory-limit, the arena and the heap stats apply to them
+ **/
+static struct {
+    switch_mutex_t          *mutex;
+    switch_hash_t           *regions;       // name => shmem_region_t
+    uint32_t                regions_count;
+    size_t                  regions_size;
+    uint32_t                anon_count;
+    uint8_t                 fl_ready;
+    switch_mutex_t          *wait_mutex;
+    switch_thread_cond_t    *wait_cond;
+    struct shmem_waiter_s   *waiters;
+} shmem;
+
+/* Atomics.wait() caller, lives on its stack */
+typedef struct shmem_waiter_s {
+    void                    *addr;
+    uint8_t                 fl_notified;
+    struct shmem_waiter_s   *next;
+} shmem_waiter_t;
+
+static inline shmem_region_t *shmem_region(void *ptr) {
+    return (shmem_region_t *)((uint8_t *)ptr - SHMEM_HDR_SIZE);
+}
+
+static inline uint8_t *shmem_region_data(shmem_region_t *reg) {
+    return ((uint8_t *)reg + SHMEM_HDR_SIZE);
+}
+
+static void *shmem_sab_alloc(void *opaque, size_t size) {
+    JSRuntime *rt = (JSRuntime *)opaque;
+    shmem_region_t *reg = NULL;
+
+    if(!(reg = js_malloc_rt(rt, SHMEM_HDR_SIZE + size))) {
+        return NULL;
+    }
+    memset(reg, 0, SHMEM_HDR_SIZE + size);
+    reg->refs = 1;
+    reg->size = size;
+
+    __atomic_add_fetch(&shmem.anon_count, 1, __ATOMIC_RELAXED);
+    return shmem_region_data(reg);
+}
+
+/* the named regions are counted under the mutex: open() can find the region while the last buffer is being freed */
+static void shmem_sab_dup(void *opaque, void *ptr) {
+    shmem_region_t *reg = shmem_region(ptr);
+
+    if(reg->name) {
+        switch_mutex_lock(shmem.mutex);
+        reg->refs++;
+        switch_mutex_unlock(shmem.mutex);
+    } else {
+        __atomic_add_fetch(&reg->refs, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void shmem_sab_free(void *opaque, void *ptr) {
+    JSRuntime *rt = (JSRuntime *)opaque;
+    shmem_region_t *reg = shmem_region(ptr);
+
+    if(reg->name) {
+        switch_mutex_lock(shmem.mutex);
+        if(reg->refs && --reg->refs == 0) {
+            if(shmem.regions) {
+                switch_core_hash_delete(shmem.regions, reg->name);
+                shmem.regions_count--;
+                shmem.regions_size -= reg->size;
+            }
+            switch_safe_free(reg->name);
+            switch_safe_free(reg);
+        }
+        switch_mutex_unlock(shmem.mutex);
+        return;
+    }
+
+    if(__atomic_sub_fetch(&reg->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        __atomic_sub_fetch(&shmem.anon_count, 1, __ATOMIC_RELAXED);
+        js_free_rt(rt, reg);
+    }
+}
+
+/**
+ ** SharedMemory.open(name, size)
+ ** returns a SharedArrayBuffer of the region, creates it (zero filled) if it doesn't exist,
+ ** size can be omitted for the existing one
+ **/
+static JSValue js_sharedmem_open(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    shmem_region_t *reg = NULL;
+    const char *name = NULL;
+    JSValue ret_val = JS_UNDEFINED;
+    int64_t size = 0;
+
+    if(!shmem.fl_ready) {
+        return JS_ThrowTypeError(ctx, "Shared memory is not available");
+    }
+    if(argc < 1 || !JS_IsString(argv[0])) {
+        return JS_ThrowTypeError(ctx, "Invalid arguments (name, size)");
+    }
+    if(argc > 1 && !QJS_IS_NULL(argv[1]) && JS_ToInt64(ctx, &size, argv[1])) {
+        return JS_EXCEPTION;
+    }
+    if(size < 0) {
+        return JS_ThrowRangeError(ctx, "Invalid size");
+    }
+
+    name = JS_ToCString(ctx, argv[0]);
+    if(zstr(name) || strlen(name) >= SHMEM_NAME_MAX) {
+        ret_val = JS_ThrowTypeError(ctx, "Invalid name");
+        goto out;
+    }
+
+    switch_mutex_lock(shmem.mutex);
+    if(!shmem.regions) {
+        ret_val = JS_ThrowTypeError(ctx, "Shared memory is not available");
+        goto unlock;
+    }
+    if((reg = switch_core_hash_find(shmem.regions, name))) {
+        if((size_t)size > reg->size) {
+            ret_val = JS_ThrowRangeError(ctx, "Region '%s' exists with a smaller size (%"SWITCH_SIZE_T_FMT")", name, reg->size);
+            goto unlock;
+        }
+    } else {
+        if(!size) {
+            ret_val = JS_ThrowRangeError(ctx, "Region '%s' not found (size is required to create it)", name);
+            goto unlock;
+        }
+        if(globals.cfg_shmem_size_max && (shmem.regions_size + (size_t)size) > globals.cfg_shmem_size_max) {
+            ret_val = JS_ThrowRangeError(ctx, "Shared memory limit exceeded (shared-memory-max)");
+            goto unlock;
+        }
+
+        switch_zmalloc(reg, SHMEM_HDR_SIZE + (size_t)size);
+        reg->size = (size_t)size;
+        reg->name = strdup(name);
+
+        switch_core_hash_insert(shmem.regions, reg->name, reg);
+        shmem.regions_count++;
+        shmem.regions_size += reg->size;
+    }
+
+    /* takes a reference through sab_dup (the mutex is nested) */
+    ret_val = JS_NewArrayBuffer(ctx, shmem_region_data(reg), reg->size, NULL, NULL, true);
+
+    if(!reg->refs) {
+        switch_core_hash_delete(shmem.regions, reg->name);
+        shmem.regions_count--;
+        shmem.regions_size -= reg->size;
+        switch_safe_free(reg->name);
+        switch_safe_free(reg);
+    }
+unlock:
+    switch_mutex_unlock(shmem.mutex);
+out:
+    JS_FreeCString(ctx, name);
+    return ret_val;
+}
+
+/* SharedMemory.exists(name) */
+static JSValue js_sharedmem_exists(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    const char *name = NULL;
+    uint8_t fl_found = false;
+
+    if(argc < 1 || !JS_IsString(argv[0])) {
+        return JS_ThrowTypeError(ctx, "Invalid arguments (name)");
+    }
+
+    name = JS_ToCString(ctx, argv[0]);
+    if(!zstr(name) && shmem.fl_ready) {
+        switch_mutex_lock(shmem.mutex);
+        fl_found = (shmem.regions && switch_core_hash_find(shmem.regions, name) != NULL);
+        switch_mutex_unlock(shmem.mutex);
+    }
+    JS_FreeCString(ctx, name);
+
+    return (fl_found ? JS_TRUE : JS_FALSE);
+}
+
+/**
+ ** Atomics.wait/notify replacements: the quickjs wait blocks in the runtime without looking at the script state,
+ ** so a script waiting without a timeout couldn't be interrupted (qjs int) and held the module unload,
+ ** here the wait goes in slices and gives up on interrupt, exit and shutdown.
+ ** all contexts get both functions, so the waiters and the notifiers always meet in the same list
+ **/
+static uint8_t *shmem_atomics_addr(JSContext *ctx, JSValueConst ta, JSValueConst index_val, size_t *bpe) {
+    JSValue buf_val = JS_UNDEFINED;
+    size_t offset = 0, length = 0, size = 0;
+    uint64_t index = 0;
+    uint8_t *data = NULL;
+
+    buf_val = JS_GetTypedArrayBuffer(ctx, ta, &offset, &length, bpe);
+    if(JS_IsException(buf_val)) {
+        return NULL;
+    }
+    data = JS_GetArrayBuffer(ctx, &size, buf_val);
+    JS_FreeValue(ctx, buf_val);
+
+    if(!data) {
+        return NULL;
+    }
+    if(*bpe != 4 && *bpe != 8) {
+        JS_ThrowTypeError(ctx, "Int32Array or BigInt64Array expected");
+        return NULL;
+    }
+    if(JS_ToIndex(ctx, &index, index_val)) {
+        return NULL;
+    }
+    if(index >= (length / *bpe)) {
+        JS_ThrowRangeError(ctx, "Out-of-bound access");
+        return NULL;
+    }
+
+    return (data + offset + (index * *bpe));
+}
+
+// Atomics.wait(typedArray, index, value, [timeout])
+static JSValue js_atomics_wait(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    shmem_waiter_t waiter = { 0 };
+    uint8_t *addr = NULL;
+    size_t bpe = 0;
+    int64_t value = 0;
+    int32_t value32 = 0;
+    double timeout = -1;
+    switch_time_t end = 0, now = 0;
+    uint8_t fl_equal = false, fl_interrupted = false;
+
+    if(argc < 3) {
+        return JS_ThrowTypeError(ctx, "Invalid arguments (typedArray, index, value, [timeout])");
+    }
+    if(!(addr = shmem_atomics_addr(ctx, argv[0], argv[1], &bpe))) {
+        return JS_EXCEPTION;
+    }
+    if(bpe == 8) {
+        if(JS_ToBigInt64(ctx, &value, argv[2])) return JS_EXCEPTION;
+    } else {
+        if(JS_ToInt32(ctx, &value32, argv[2])) return JS_EXCEPTION;
+    }
+    if(argc > 3 && !JS_IsUndefined(argv[3])) {
+        if(JS_ToFloat64(ctx, &timeout, argv[3])) return JS_EXCEPTION;
+        if(isnan(timeout)) timeout = -1;
+        else if(timeout < 0) timeout = 0;
+    }
+    if(timeout >= 0) {
+        end = switch_micro_time_now() + (switch_time_t)(timeout * 1000);
+    }
+
+    switch_mutex_lock(shmem.wait_mutex);
+    if(bpe == 8) {
+        fl_equal = (__atomic_load_n((int64_t *)addr, __ATOMIC_SEQ_CST) == value);
+    } else {
+        fl_equal = (__atomic_load_n((int32_t *)addr, __ATOMIC_SEQ_CST) == value32);
+    }
+    if(!fl_equal) {
+        switch_mutex_unlock(shmem.wait_mutex);
+        return JS_NewString(ctx, "not-equal");
+    }
+
+    waiter.addr = addr;
+    waiter.next = shmem.waiters;
+    shmem.waiters = &waiter;
+
+    while(!waiter.fl_notified) {
+        if(globals.fl_shutdown || (script && (script->fl_interrupt || script->fl_exit))) {
+            fl_interrupted = true;
+            break;
+        }
+        now = switch_micro_time_now();
+        if(end && now >= end) {
+            break;
+        }
+        switch_thread_cond_timedwait(shmem.wait_cond, shmem.wait_mutex, ((!end || (end - now) > SHMEM_WAIT_SLICE_US) ? SHMEM_WAIT_SLICE_US : (end - now)));
+    }
+
+    if(!waiter.fl_notified) {
+        for(shmem_waiter_t **pp = &shmem.waiters; *pp; pp = &(*pp)->next) {
+            if(*pp == &waiter) {
+                *pp = waiter.next;
+                break;
+            }
+        }
+    }
+    switch_mutex_unlock(shmem.wait_mutex);
+
+    if(waiter.fl_notified) {
+        return JS_NewString(ctx, "ok");
+    }
+    if(fl_interrupted) {
+        return JS_ThrowInternalError(ctx, "Atomics.wait interrupted");
+    }
+    return JS_NewString(ctx, "timed-out");
+}
+
+// Atomics.notify(typedArray, index, [count])
+static JSValue js_atomics_notify(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    uint8_t *addr = NULL;
+    size_t bpe = 0;
+    double count = INFINITY;
+    uint32_t woken = 0;
+
+    if(argc < 2) {
+        return JS_ThrowTypeError(ctx, "Invalid arguments (typedArray, index, [count])");
+    }
+    if(!(addr = shmem_atomics_addr(ctx, argv[0], argv[1], &bpe))) {
+        return JS_EXCEPTION;
+    }
+    if(argc > 2 && !JS_IsUndefined(argv[2])) {
+        if(JS_ToFloat64(ctx, &count, argv[2])) return JS_EXCEPTION;
+        if(isnan(count) || count < 0) count = 0;
+    }
+
+    /* the oldest ones first */
+    switch_mutex_lock(shmem.wait_mutex);
+    while(woken < count) {
+        shmem_waiter_t **last = NULL;
+
+        for(shmem_waiter_t **pp = &shmem.waiters; *pp; pp = &(*pp)->next) {
+            if((*pp)->addr == addr) {
+                last = pp;
+            }
+        }
+        if(!last) {
+            break;
+        }
+        (*last)->fl_notified = true;
+        *last = (*last)->next;
+        woken++;
+    }
+    if(woken) {
+        switch_thread_cond_broadcast(shmem.wait_cond);
+    }
+    switch_mutex_unlock(shmem.wait_mutex);
+
+    return JS_NewUint32(ctx, woken);
+}
+
+static const JSCFunctionListEntry js_sharedmem_static_funcs[] = {
+    JS_CFUNC_DEF("open", 2, js_sharedmem_open),
+    JS_CFUNC_DEF("exists", 1, js_sharedmem_exists),
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+// Public
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------
+void js_sharedmem_runtime_setup(JSRuntime *rt) {
+    JSSharedArrayBufferFunctions sab_funcs = {
+        .sab_alloc = shmem_sab_alloc,
+        .sab_free = shmem_sab_free,
+        .sab_dup = shmem_sab_dup,
+        .sab_opaque = rt
+    };
+
+    JS_SetSharedArrayBufferFunctions(rt, &sab_funcs);
+}
+
+void js_sharedmem_register_globals(JSContext *ctx, JSValue global_obj) {
+    JSValue atomics = JS_GetPropertyStr(ctx, global_obj, "Atomics");
+
+    if(JS_IsObject(atomics)) {
+        JS_SetPropertyStr(ctx, atomics, "wait", JS_NewCFunction(ctx, js_atomics_wait, "wait", 4));
+        JS_SetPropertyStr(ctx, atomics, "notify", JS_NewCFunction(ctx, js_atomics_notify, "notify", 3));
+    }
+    JS_FreeValue(ctx, atomics);
+}
+
+switch_status_t js_sharedmem_class_register(JSContext *ctx, JSValue global_obj) {
+    JSValue obj = JS_NewObject(ctx);
+
+    js_set_function_list(ctx, obj, CLASS_NAME, js_sharedmem_static_funcs, ARRAY_SIZE(js_sharedmem_static_funcs));
+    JS_SetPropertyStr(ctx, global_obj, CLASS_NAME, obj);
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+switch_status_t js_sharedmem_init(switch_memory_pool_t *pool) {
+    memset(&shmem, 0, sizeof(shmem));
+
+    switch_mutex_init(&shmem.mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_mutex_init(&shmem.wait_mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_thread_cond_create(&shmem.wait_cond, pool);
+    switch_core_hash_init(&shmem.regions);
+    shmem.fl_ready = true;
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+/**
+ ** should be called after the runtimes were destroyed (they free the buffers),
+ ** the regions which are still referenced are detached from the table and freed by their last buffer
+ **/
+void js_sharedmem_shutdown() {
+    if(!shmem.fl_ready) {
+        return;
+    }
+
+    switch_mutex_lock(shmem.mutex);
+    if(shmem.regions_count) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Shared memory regions are still referenced (%u), detached\n", shmem.regions_count);
+    }
+    shmem.fl_ready = false;
+    switch_core_hash_destroy(&shmem.regions);
+    shmem.regions = NULL;
+    shmem.regions_count = 0;
+    shmem.regions_size = 0;
+    switch_mutex_unlock(shmem.mutex);
+}
+
+void js_sharedmem_stats(switch_stream_handle_t *stream) {
+    switch_hash_index_t *hidx = NULL;
+
+    switch_mutex_lock(shmem.mutex);
+    stream->write_function(stream, "regions: %u, size: %"SWITCH_SIZE_T_FMT" bytes (max: %"SWITCH_SIZE_T_FMT"), anonymous buffers: %u\n",
+        shmem.regions_count, shmem.regions_size, globals.cfg_shmem_size_max, __atomic_load_n(&shmem.anon_count, __ATOMIC_RELAXED)
+    );
+    for(hidx = (shmem.regions ? switch_core_hash_first_iter(shmem.regions, hidx) : NULL); hidx; hidx = switch_core_hash_next(&hidx)) {
+        shmem_region_t *reg = NULL;
+        void *hval = NULL;
+
+        switch_core_hash_this(hidx, NULL, NULL, &hval);
+        reg = (shmem_region_t *)hval;
+        stream->write_function(stream, "%s: size: %"SWITCH_SIZE_T_FMT", refs: %u\n", reg->name, reg->size, reg->refs);
+    }
+    switch_safe_free(hidx);
+    switch_mutex_unlock(shmem.mutex);
+}
@@ -0,0 +1,23 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#ifndef JS_SHAREDMEM_H
+#define JS_SHAREDMEM_H
+#include "mod_quickjs.h"
+
+typedef struct {
+    uint32_t                refs;           // SharedArrayBuffer objects in all runtimes
+    size_t                  size;
+    char                    *name;          // NULL - anonymous (new SharedArrayBuffer)
+} shmem_region_t;
+
+void js_sharedmem_runtime_setup(JSRuntime *rt);
+void js_sharedmem_register_globals(JSContext *ctx, JSValue global_obj);
+switch_status_t js_sharedmem_class_register(JSContext *ctx, JSValue global_obj);
+
+switch_status_t js_sharedmem_init(switch_memory_pool_t *pool);
+void js_sharedmem_shutdown();
+void js_sharedmem_stats(switch_stream_handle_t *stream);
+
+#endif
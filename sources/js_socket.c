@@ -413,6 +413,8 @@ static void js_socket_finalizer(JSRuntime *rt, JSValue val) {
         return;
     }
 
+    js_native_object_finalized(rt);
+
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-socket-finalizer: js_socket=%p, socket=%p\n", js_socket, js_socket->socket);
 #endif
@@ -541,6 +543,7 @@ static JSValue js_socket_contructor(JSContext *ctx, JSValueConst new_target, int
     if(JS_IsException(obj)) { goto fail; }
 
     JS_SetOpaque(obj, js_socket);
+    js_native_object_created(ctx);
     JS_FreeCString(ctx, lo_addr_str);
     JS_FreeCString(ctx, mc_addr_str);
 
@@ -573,35 +576,27 @@ fail:
 // Public
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------
 JSClassID js_socket_get_classid2(JSRuntime *rt) {
-    script_t *script = JS_GetRuntimeOpaque(rt);
-    switch_assert(script);
-    return script->class_id_socket;
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(rt);
+    switch_assert(jsrt);
+    if(!jsrt->class_id_socket) {
+        jsrt->class_id_socket = js_class_id_register(rt, JS_CLASS_ID_SOCKET, &js_socket_class);
+    }
+    return jsrt->class_id_socket;
 }
 JSClassID js_socket_get_classid(JSContext *ctx) {
     return  js_socket_get_classid2(JS_GetRuntime(ctx));
 }
 
-switch_status_t js_socket_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id) {
+switch_status_t js_socket_class_register(JSContext *ctx, JSValue global_obj) {
+    JSClassID class_id = js_socket_get_classid(ctx);
     JSValue obj_proto, obj_class;
-    script_t *script = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
-
-    switch_assert(script);
-
-    if(JS_IsRegisteredClass(JS_GetRuntime(ctx), class_id)) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Class with id (%d) already registered!\n", class_id);
-        return SWITCH_STATUS_FALSE;
-    }
-
-    JS_NewClassID(&class_id);
-    JS_NewClass(JS_GetRuntime(ctx), class_id, &js_socket_class);
-    script->class_id_socket = class_id;
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Class registered [%s / %d]\n", CLASS_NAME, class_id);
 #endif
 
     obj_proto = JS_NewObject(ctx);
-    JS_SetPropertyFunctionList(ctx, obj_proto, js_socket_proto_funcs, ARRAY_SIZE(js_socket_proto_funcs));
+    js_set_function_list(ctx, obj_proto, CLASS_NAME, js_socket_proto_funcs, ARRAY_SIZE(js_socket_proto_funcs));
 
     obj_class = JS_NewCFunction2(ctx, js_socket_contructor, CLASS_NAME, 1, JS_CFUNC_constructor, 0);
     JS_SetConstructor(ctx, obj_class, obj_proto);
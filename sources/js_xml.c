@@ -288,6 +288,8 @@ static void js_xml_finalizer(JSRuntime *rt, JSValue val) {
         return;
     }
 
+    js_native_object_finalized(rt);
+
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-xml-finalizer: js_xml=%p, xml=%p, fl_free_xml=%i\n", js_xml, js_xml->xml, js_xml->fl_free_xml);
 #endif
@@ -342,6 +344,7 @@ static JSValue js_xml_contructor(JSContext *ctx, JSValueConst new_target, int ar
     if(JS_IsException(obj)) { goto fail; }
 
     JS_SetOpaque(obj, js_xml);
+    js_native_object_created(ctx);
     JS_FreeCString(ctx, data);
 
 #ifdef MOD_QUICKJS_DEBUG
@@ -371,7 +374,7 @@ static JSValue js_xml_object_create(JSContext *ctx, switch_xml_t xml) {
 
     proto = JS_NewObject(ctx);
     if(JS_IsException(proto)) { return proto; }
-    JS_SetPropertyFunctionList(ctx, proto, js_xml_proto_funcs, ARRAY_SIZE(js_xml_proto_funcs));
+    js_set_function_list(ctx, proto, CLASS_NAME, js_xml_proto_funcs, ARRAY_SIZE(js_xml_proto_funcs));
 
     obj = JS_NewObjectProtoClass(ctx, proto, js_xml_get_classid(ctx));
     JS_FreeValue(ctx, proto);
@@ -382,6 +385,7 @@ static JSValue js_xml_object_create(JSContext *ctx, switch_xml_t xml) {
     js_xml->fl_free_xml = 0;
 
     JS_SetOpaque(obj, js_xml);
+    js_native_object_created(ctx);
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "js-xml-obj-created: js_xml=%p, xml=%p\n", js_xml, js_xml->xml);
@@ -394,35 +398,27 @@ static JSValue js_xml_object_create(JSContext *ctx, switch_xml_t xml) {
 // Public
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------
 JSClassID js_xml_get_classid2(JSRuntime *rt) {
-    script_t *script = JS_GetRuntimeOpaque(rt);
-    switch_assert(script);
-    return script->class_id_xml;
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(rt);
+    switch_assert(jsrt);
+    if(!jsrt->class_id_xml) {
+        jsrt->class_id_xml = js_class_id_register(rt, JS_CLASS_ID_XML, &js_xml_class);
+    }
+    return jsrt->class_id_xml;
 }
 JSClassID js_xml_get_classid(JSContext *ctx) {
     return  js_xml_get_classid2(JS_GetRuntime(ctx));
 }
 
-switch_status_t js_xml_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id) {
+switch_status_t js_xml_class_register(JSContext *ctx, JSValue global_obj) {
+    JSClassID class_id = js_xml_get_classid(ctx);
     JSValue obj_proto, obj_class;
-    script_t *script = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
-
-    switch_assert(script);
-
-    if(JS_IsRegisteredClass(JS_GetRuntime(ctx), class_id)) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Class with id (%d) already registered!\n", class_id);
-        return SWITCH_STATUS_FALSE;
-    }
-
-    JS_NewClassID(&class_id);
-    JS_NewClass(JS_GetRuntime(ctx), class_id, &js_xml_class);
-    script->class_id_xml = class_id;
 
 #ifdef MOD_QUICKJS_DEBUG
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Class registered [%s / %d]\n", CLASS_NAME, class_id);
 #endif
 
     obj_proto = JS_NewObject(ctx);
-    JS_SetPropertyFunctionList(ctx, obj_proto, js_xml_proto_funcs, ARRAY_SIZE(js_xml_proto_funcs));
+    js_set_function_list(ctx, obj_proto, CLASS_NAME, js_xml_proto_funcs, ARRAY_SIZE(js_xml_proto_funcs));
 
     obj_class = JS_NewCFunction2(ctx, js_xml_contructor, CLASS_NAME, 1, JS_CFUNC_constructor, 0);
     JS_SetConstructor(ctx, obj_class, obj_proto);
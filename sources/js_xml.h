@@ -13,7 +13,7 @@ typedef struct {
 
 JSClassID js_xml_get_classid(JSContext *ctx);
 JSClassID js_xml_get_classid2(JSRuntime *rt);
-switch_status_t js_xml_class_register(JSContext *ctx, JSValue global_obj, JSClassID class_id);
+switch_status_t js_xml_class_register(JSContext *ctx, JSValue global_obj);
 
 #endif
 
@@ -0,0 +1,439 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+#include <pthread.h>
+
+extern globals_t globals;
+
+/**
+ ** log object: log.debug|info|notice|warning|error|crit|alert(message [, fields])
+ ** the level is checked before the arguments are touched, so the disabled levels cost only a call
+ ** (log.level, then log-level, and the core runtime level when neither is set)
+ ** with log-buffered the records are appended to a per thread buffer (no locks but a short spin with the writer)
+ ** and the writer thread passes them to switch_log every LOGGER_FLUSH_INTERVAL_MS,
+ ** the buffers start small and grow up to LOGGER_BUFFER_MAX, when it's full the records are dropped (and counted) instead of blocking the script
+ **/
+#define LOGGER_FLUSH_INTERVAL_MS    100
+#define LOGGER_BUFFER_MIN           (4 * 1024)
+#define LOGGER_BUFFER_MAX           (64 * 1024)
+#define LOGGER_RECORD_MAX           4096
+
+typedef struct {
+    uint32_t                len;            // name + text (with \0)
+    uint16_t                name_len;       // script name (with \0), the text follows it
+    uint8_t                 level;
+    char                    data[];
+} logger_record_t;
+
+typedef struct {
+    uint32_t                used;
+    uint32_t                size;
+    uint8_t                 *data;
+} logger_buffer_t;
+
+typedef struct logger_thread_s {
+    struct logger_thread_s  *next;
+    uint8_t                 fl_free;        // the owner has gone, can be taken by a new thread
+    uint8_t                 lock;
+    logger_buffer_t         active;         // filled by the owner
+    logger_buffer_t         spare;          // drained by the writer
+    uint64_t                dropped;
+} logger_thread_t;
+
+static struct {
+    switch_mutex_t          *mutex;
+    logger_thread_t         *threads;
+    pthread_key_t           tls_key;
+    uint64_t                records;
+    uint64_t                dropped;
+    uint8_t                 fl_ready;
+    uint8_t                 fl_writer;
+} logger;
+
+static __thread logger_thread_t *logger_tls = NULL;
+
+static const struct {
+    const char              *name;
+    switch_log_level_t      level;
+} logger_levels[] = {
+    { "debug",      SWITCH_LOG_DEBUG },
+    { "info",       SWITCH_LOG_INFO },
+    { "notice",     SWITCH_LOG_NOTICE },
+    { "warning",    SWITCH_LOG_WARNING },
+    { "error",      SWITCH_LOG_ERROR },
+    { "crit",       SWITCH_LOG_CRIT },
+    { "alert",      SWITCH_LOG_ALERT }
+};
+
+/* the level of the log object: log.level, log-level or the core one */
+static switch_log_level_t logger_level(script_t *script) {
+    int32_t level = -1;
+
+    if(script && script->log_level != SWITCH_LOG_INVALID) {
+        return script->log_level;
+    }
+    if(globals.cfg_log_level != SWITCH_LOG_INVALID) {
+        return globals.cfg_log_level;
+    }
+
+    switch_core_session_ctl(SCSC_LOGLEVEL, &level);
+    return (level >= 0 ? (switch_log_level_t)level : SWITCH_LOG_DEBUG);
+}
+
+static inline void logger_thread_lock(logger_thread_t *lt) {
+    while(__atomic_exchange_n(&lt->lock, 1, __ATOMIC_ACQUIRE)) {
+        switch_os_yield();
+    }
+}
+
+static inline void logger_thread_unlock(logger_thread_t *lt) {
+    __atomic_store_n(&lt->lock, 0, __ATOMIC_RELEASE);
+}
+
+static void logger_thread_release(void *data) {
+    logger_thread_t *lt = (logger_thread_t *)data;
+
+    if(lt) {
+        __atomic_store_n(&lt->fl_free, true, __ATOMIC_RELEASE);
+    }
+}
+
+static logger_thread_t *logger_thread_get() {
+    logger_thread_t *lt = NULL;
+
+    if(logger_tls) {
+        return logger_tls;
+    }
+
+    switch_mutex_lock(logger.mutex);
+    for(lt = logger.threads; lt; lt = lt->next) {
+        if(__atomic_load_n(&lt->fl_free, __ATOMIC_ACQUIRE)) {
+            lt->fl_free = false;
+            break;
+        }
+    }
+    if(!lt) {
+        switch_zmalloc(lt, sizeof(logger_thread_t));
+        lt->next = logger.threads;
+        logger.threads = lt;
+    }
+    switch_mutex_unlock(logger.mutex);
+
+    pthread_setspecific(logger.tls_key, lt);
+    logger_tls = lt;
+
+    return lt;
+}
+
+static void logger_write(script_t *script, switch_log_level_t level, const char *text) {
+    switch_log_printf(SWITCH_CHANNEL_ID_LOG, (script ? script->name : "quickjs"), "log", 0, NULL, level, "%s\n", text);
+}
+
+static inline uint32_t logger_record_size(uint32_t len) {
+    return ((sizeof(logger_record_t) + len + 7) & ~7);
+}
+
+/* must be called under the thread lock */
+static uint8_t logger_buffer_reserve(logger_buffer_t *buf, uint32_t size) {
+    uint32_t nsize = (buf->size ? buf->size : LOGGER_BUFFER_MIN);
+    uint8_t *data = NULL;
+
+    if(buf->used + size <= buf->size) {
+        return true;
+    }
+    while(nsize < buf->used + size && nsize < LOGGER_BUFFER_MAX) {
+        nsize <<= 1;
+    }
+    if(buf->used + size > nsize || !(data = realloc(buf->data, nsize))) {
+        return false;
+    }
+
+    buf->data = data;
+    buf->size = nsize;
+    return true;
+}
+
+static void logger_append(script_t *script, switch_log_level_t level, const char *text, uint32_t len) {
+    const char *name = (script ? script->name : "quickjs");
+    logger_thread_t *lt = NULL;
+    logger_record_t *rec = NULL;
+    uint32_t name_len = 0, rec_size = 0;
+
+    if(!logger.fl_writer) {
+        logger_write(script, level, text);
+        return;
+    }
+
+    lt = logger_thread_get();
+    name_len = strlen(name) + 1;
+    rec_size = logger_record_size(name_len + len + 1);
+
+    logger_thread_lock(lt);
+    if(!logger_buffer_reserve(&lt->active, rec_size)) {
+        lt->dropped++;
+    } else {
+        rec = (logger_record_t *)(lt->active.data + lt->active.used);
+        rec->len = (name_len + len + 1);
+        rec->name_len = name_len;
+        rec->level = level;
+        memcpy(rec->data, name, name_len);
+        memcpy(rec->data + name_len, text, len);
+        rec->data[name_len + len] = '\0';
+        lt->active.used += rec_size;
+    }
+    logger_thread_unlock(lt);
+}
+
+static uint8_t logger_value_needs_quotes(const char *str) {
+    for(; *str; str++) {
+        if((unsigned char)*str < 0x20 || *str == ' ' || *str == '"' || *str == '=' || *str == '\\') {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* key=value, the values with spaces, quotes or control characters are quoted and escaped */
+static void logger_fields_format(JSContext *ctx, JSValueConst obj, switch_stream_handle_t *sh) {
+    JSPropertyEnum *tab = NULL;
+    uint32_t len = 0;
+
+    if(JS_GetOwnPropertyNames(ctx, &tab, &len, obj, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) < 0) {
+        return;
+    }
+
+    for(uint32_t i = 0; i < len; i++) {
+        JSValue val = JS_GetProperty(ctx, obj, tab[i].atom);
+        const char *key = JS_AtomToCString(ctx, tab[i].atom);
+        const char *str = NULL;
+
+        if(JS_IsObject(val) && !JS_IsFunction(ctx, val)) {
+            JSValue json = JS_JSONStringify(ctx, val, JS_UNDEFINED, JS_UNDEFINED);
+            str = (JS_IsException(json) ? NULL : JS_ToCString(ctx, json));
+            JS_FreeValue(ctx, json);
+        } else {
+            str = JS_ToCString(ctx, val);
+        }
+
+        if(key) {
+            if(str && logger_value_needs_quotes(str)) {
+                sh->write_function(sh, " %s=\"", key);
+                stream_write_escaped(sh, str);
+                sh->write_function(sh, "\"");
+            } else {
+                sh->write_function(sh, " %s=%s", key, (str ? str : ""));
+            }
+        }
+
+        JS_FreeCString(ctx, str);
+        JS_FreeCString(ctx, key);
+        JS_FreeValue(ctx, val);
+        JS_FreeAtom(ctx, tab[i].atom);
+    }
+    js_free(ctx, tab);
+}
+
+// log.<level>(message [, fields])
+static JSValue js_log_write(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    switch_log_level_t level = logger_levels[magic].level;
+    switch_stream_handle_t sh = { 0 };
+    const char *msg = NULL;
+
+    /* nothing is converted when the level is off */
+    if(level > logger_level(script)) {
+        return JS_UNDEFINED;
+    }
+
+    SWITCH_STANDARD_STREAM(sh);
+
+    msg = (argc > 0 ? JS_ToCString(ctx, argv[0]) : NULL);
+    sh.write_function(&sh, "%s", (msg ? msg : ""));
+    JS_FreeCString(ctx, msg);
+
+    if(argc > 1 && JS_IsObject(argv[1])) {
+        logger_fields_format(ctx, argv[1], &sh);
+    }
+
+    if(sh.data_len > LOGGER_RECORD_MAX) {
+        ((char *)sh.data)[LOGGER_RECORD_MAX] = '\0';
+        sh.data_len = LOGGER_RECORD_MAX;
+    }
+
+    logger_append(script, level, (char *)sh.data, (uint32_t)sh.data_len);
+
+    switch_safe_free(sh.data);
+    return JS_UNDEFINED;
+}
+
+static JSValue js_log_level_get(JSContext *ctx, JSValueConst this_val) {
+    script_t *script = JS_GetContextOpaque(ctx);
+
+    return JS_NewString(ctx, switch_log_level2str(logger_level(script)));
+}
+
+static JSValue js_log_level_set(JSContext *ctx, JSValueConst this_val, JSValueConst val) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    switch_log_level_t level = SWITCH_LOG_INVALID;
+    const char *str = NULL;
+
+    if(!script) {
+        return JS_UNDEFINED;
+    }
+
+    str = JS_ToCString(ctx, val);
+    if(str) {
+        level = switch_log_str2level(str);
+    }
+    JS_FreeCString(ctx, str);
+
+    if(level == SWITCH_LOG_INVALID) {
+        return JS_ThrowTypeError(ctx, "Invalid log level");
+    }
+
+    script->log_level = level;
+    return JS_UNDEFINED;
+}
+
+/* the magic is the index in logger_levels */
+static const JSCFunctionListEntry js_log_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("debug", 2, js_log_write, 0),
+    JS_CFUNC_MAGIC_DEF("info", 2, js_log_write, 1),
+    JS_CFUNC_MAGIC_DEF("notice", 2, js_log_write, 2),
+    JS_CFUNC_MAGIC_DEF("warning", 2, js_log_write, 3),
+    JS_CFUNC_MAGIC_DEF("error", 2, js_log_write, 4),
+    JS_CFUNC_MAGIC_DEF("crit", 2, js_log_write, 5),
+    JS_CFUNC_MAGIC_DEF("alert", 2, js_log_write, 6),
+    JS_CGETSET_DEF("level", js_log_level_get, js_log_level_set),
+};
+
+/**
+ ** passes the records of all threads to switch_log,
+ ** the buffers are swapped under the thread locks only and the records are written without any locks held,
+ ** so the threads which log (or take a buffer) don't wait for the core log
+ ** (the list only grows at the head and the entries live until shutdown, only the writer drains the spares)
+ **/
+static void logger_flush() {
+    logger_thread_t *threads = NULL;
+
+    switch_mutex_lock(logger.mutex);
+    threads = logger.threads;
+    switch_mutex_unlock(logger.mutex);
+
+    for(logger_thread_t *lt = threads; lt; lt = lt->next) {
+        logger_buffer_t buf = { 0 };
+        uint64_t dropped = 0, records = 0;
+
+        logger_thread_lock(lt);
+        buf = lt->active;
+        lt->active = lt->spare;
+        lt->spare = buf;
+        dropped = lt->dropped;
+        lt->dropped = 0;
+        logger_thread_unlock(lt);
+
+        for(uint32_t pos = 0; pos < buf.used; ) {
+            logger_record_t *rec = (logger_record_t *)(buf.data + pos);
+
+            switch_log_printf(SWITCH_CHANNEL_ID_LOG, rec->data, "log", 0, NULL, rec->level, "%s\n", rec->data + rec->name_len);
+            pos += logger_record_size(rec->len);
+            records++;
+        }
+        lt->spare.used = 0;
+
+        __atomic_add_fetch(&logger.records, records, __ATOMIC_RELAXED);
+        if(dropped) {
+            __atomic_add_fetch(&logger.dropped, dropped, __ATOMIC_RELAXED);
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Log buffer overflow, %"SWITCH_UINT64_T_FMT" records dropped\n", dropped);
+        }
+    }
+}
+
+static void *SWITCH_THREAD_FUNC logger_writer_thread(switch_thread_t *thread, void *obj) {
+    while(!globals.fl_shutdown) {
+        logger_flush();
+        switch_yield(LOGGER_FLUSH_INTERVAL_MS * 1000);
+    }
+
+    /* the scripts are finishing, take what they managed to write */
+    logger.fl_writer = false;
+    logger_flush();
+
+    thread_finished();
+    return NULL;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+switch_status_t logger_init(switch_memory_pool_t *pool) {
+    memset(&logger, 0, sizeof(logger));
+
+    switch_mutex_init(&logger.mutex, SWITCH_MUTEX_NESTED, pool);
+
+    if(pthread_key_create(&logger.tls_key, logger_thread_release) != 0) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "pthread_key_create() failed\n");
+        return SWITCH_STATUS_FALSE;
+    }
+    logger.fl_ready = true;
+
+    if(globals.cfg_log_buffered) {
+        logger.fl_writer = true;
+        launch_thread(pool, logger_writer_thread, NULL);
+    }
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+/**
+ ** should be called after all threads were finished
+ **/
+void logger_shutdown() {
+    logger_thread_t *lt = NULL;
+
+    if(!logger.fl_ready) {
+        return;
+    }
+
+    logger.fl_writer = false;
+    logger_flush();
+
+    switch_mutex_lock(logger.mutex);
+    while((lt = logger.threads)) {
+        logger.threads = lt->next;
+        switch_safe_free(lt->active.data);
+        switch_safe_free(lt->spare.data);
+        switch_safe_free(lt);
+    }
+    logger.fl_ready = false;
+    switch_mutex_unlock(logger.mutex);
+
+    pthread_key_delete(logger.tls_key);
+}
+
+void logger_register_globals(JSContext *ctx, JSValue global_obj) {
+    JSValue log_obj = JS_NewObject(ctx);
+
+    JS_SetPropertyFunctionList(ctx, log_obj, js_log_funcs, ARRAY_SIZE(js_log_funcs));
+    JS_SetPropertyStr(ctx, global_obj, "log", log_obj);
+}
+
+void logger_stats(switch_stream_handle_t *stream) {
+    uint32_t threads = 0;
+    size_t memory = 0;
+
+    switch_mutex_lock(logger.mutex);
+    for(logger_thread_t *lt = logger.threads; lt; lt = lt->next) {
+        threads++;
+        logger_thread_lock(lt);
+        memory += (lt->active.size + lt->spare.size);
+        logger_thread_unlock(lt);
+    }
+    switch_mutex_unlock(logger.mutex);
+
+    stream->write_function(stream, "buffered: %s, level: %s%s\n", (logger.fl_writer ? "yes" : "no"), switch_log_level2str(logger_level(NULL)), (globals.cfg_log_level == SWITCH_LOG_INVALID ? " (core)" : ""));
+    stream->write_function(stream, "records: %"SWITCH_UINT64_T_FMT", dropped: %"SWITCH_UINT64_T_FMT", thread buffers: %u (%"SWITCH_SIZE_T_FMT" bytes)\n",
+        __atomic_load_n(&logger.records, __ATOMIC_RELAXED), __atomic_load_n(&logger.dropped, __ATOMIC_RELAXED), threads, memory);
+}
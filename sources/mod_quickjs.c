@@ -15,6 +15,9 @@
 #include "js_session.h"
 #include "js_curl.h"
 #include "js_dbh.h"
+#include "js_channel.h"
+#include "js_sharedmap.h"
+#include "js_sharedmem.h"
 
 globals_t globals;
 
@@ -70,12 +73,38 @@ static JSValue js_msleep(JSContext *ctx, JSValueConst this_val, int argc, JSValu
     JS_ToUint32(ctx, &msec, argv[0]);
 
     if(msec) {
-        switch_yield(msec * 1000);
+        script_t *script = JS_GetContextOpaque(ctx);
+        switch_time_t end = 0, now = 0;
+
+        script_gc_idle(script);
+        end = switch_micro_time_now() + ((switch_time_t)msec * 1000);
+
+        /* sleep in slices to react on interrupts */
+        while((now = switch_micro_time_now()) < end) {
+            if(globals.fl_shutdown || (script && script->fl_interrupt)) {
+                break;
+            }
+            switch_yield(((end - now) > 100000 ? 100000 : (end - now)));
+        }
     }
 
     return JS_TRUE;
 }
 
+// runtime.gc() - collects garbage right now, returns the pause (ms)
+static JSValue js_runtime_gc(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    switch_time_t start = switch_micro_time_now();
+
+    if(script && script->rt) {
+        script_gc_run(script);
+    } else {
+        JS_RunGC(JS_GetRuntime(ctx));
+    }
+
+    return JS_NewFloat64(ctx, (double)(switch_micro_time_now() - start) / 1000.0);
+}
+
 // setValiable(name, value)
 static JSValue js_global_set(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
     const char *var_str = NULL;
@@ -430,45 +459,42 @@ static JSValue js_chat_send(JSContext *ctx, JSValueConst this_val, int argc, JSV
 // ---------------------------------------------------------------------------------------------------------------------------------------------
 static void xx_js_module_destructor(void *data) {
     if(data) {
-        dlclose(data);
+        solib_release((solib_t *)data);
     }
 }
 
 static JSModuleDef *xxx_js_module_loader(JSContext *ctx, const char *module_name) {
     JSModuleDef *m = NULL;
     JSValue func_val;
-    size_t buf_len;
-    uint8_t *buf;
     char *filename;
+    uint8_t fl_bundle = false;
 
-    if(!strchr(module_name, '/')) {
-        filename = switch_mprintf("%s%s%s", SWITCH_GLOBAL_dirs.script_dir, SWITCH_PATH_SEPARATOR, module_name);
-    } else {
-        filename = (char *)module_name;
-    }
+    /* bundles first, the sources aren't touched then */
+    func_val = bundle_load(ctx, module_name, NULL);
+    if(JS_IsUndefined(func_val)) {
+        if(!strchr(module_name, '/')) {
+            filename = switch_mprintf("%s%s%s", SWITCH_GLOBAL_dirs.script_dir, SWITCH_PATH_SEPARATOR, module_name);
+        } else {
+            filename = (char *)module_name;
+        }
 
 #ifdef MOD_QUICKJS_DEBUG
-    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "load module [%s] (%s)\n", module_name, filename);
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "load module [%s] (%s)\n", module_name, filename);
 #endif
 
-    buf = js_load_file(ctx, &buf_len, filename);
-    if(filename != module_name) {
-        switch_safe_free(filename);
-    }
-
-    if(!buf) {
-        JS_ThrowReferenceError(ctx, "Unable to load module '%s'", module_name);
-        return NULL;
+        func_val = bcache_load(ctx, filename, module_name, JS_EVAL_TYPE_MODULE, NULL);
+        if(filename != module_name) {
+            switch_safe_free(filename);
+        }
+    } else {
+        fl_bundle = true;
     }
 
-    func_val = JS_Eval(ctx, (char *)buf, buf_len, module_name, JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
-    js_free(ctx, buf);
-
     if(JS_IsException(func_val)) {
         return NULL;
     }
 
-    js_module_set_import_meta(ctx, func_val, TRUE, FALSE);
+    js_module_set_import_meta(ctx, func_val, !fl_bundle, FALSE);
     m = JS_VALUE_GET_PTR(func_val);
     JS_FreeValue(ctx, func_val);
 
@@ -480,7 +506,8 @@ static JSModuleDef *xxx_so_module_loader(JSContext *ctx, const char *module_name
     JSModuleDef *m = NULL;
     JSInitModuleFunc *init = NULL;
     char *filename = NULL;
-    void *hd = NULL;
+    solib_t *lib = NULL;
+    char errbuf[255] = { 0 };
 
     if(!strchr(module_name, '/')) {
         filename = switch_mprintf("%s%s%s", SWITCH_GLOBAL_dirs.lib_dir, SWITCH_PATH_SEPARATOR, module_name);
@@ -492,31 +519,24 @@ static JSModuleDef *xxx_so_module_loader(JSContext *ctx, const char *module_name
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "load module [%s] (%s)\n", module_name, filename);
 #endif
 
-    hd = dlopen(filename, RTLD_NOW | RTLD_LOCAL);
+    lib = solib_acquire(filename, &init, errbuf, sizeof(errbuf));
     if(filename != module_name) {
         switch_safe_free(filename);
     }
 
-    if(!hd) {
-        JS_ThrowReferenceError(ctx, "Unable to load module '%s' (%s)", module_name, dlerror());
-        goto fail;
-    }
-
-    init = dlsym(hd, "js_init_module");
-    if(!init) {
-        dlclose(hd);
-        JS_ThrowReferenceError(ctx, "Unable to load module '%s' (missing symbol: js_init_module)", module_name);
+    if(!lib) {
+        JS_ThrowReferenceError(ctx, "Unable to load module '%s' (%s)", module_name, errbuf);
         goto fail;
     }
 
     m = init(ctx, module_name);
     if(m) {
-        js_list_add(script->mod_hlist, hd, xx_js_module_destructor);
+        js_list_add(script->mod_hlist, lib, xx_js_module_destructor);
         return m;
     }
 
     /* fail */
-    dlclose(hd);
+    solib_release(lib);
     JS_ThrowReferenceError(ctx, "Unable to load module '%s' (initialization failed)", module_name);
 fail:
     return NULL;
@@ -541,50 +561,76 @@ JSModuleDef *xxx_module_loader(JSContext *ctx, const char *module_name, void *op
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------
-static switch_status_t script_load(script_t *script) {
-    switch_status_t status = SWITCH_STATUS_SUCCESS;
-    switch_file_t *fd = NULL;
-
-    if(!script) {
-        status = SWITCH_STATUS_FALSE;
-        goto out;
-    }
+typedef struct {
+    uint32_t                wall_time_max;
+    uint32_t                cpu_time_max;
+    uint8_t                 gc_mode;
+    size_t                  gc_threshold;
+    char                    *tags;
+    char                    *service;
+} script_launch_opts_t;
 
-    if((status = switch_file_open(&fd, script->path, SWITCH_FOPEN_READ, SWITCH_FPROT_UREAD, script->pool)) != SWITCH_STATUS_SUCCESS) {
-        return status;
-    }
+/**
+ ** parses launch options: {wall-time=sec,cpu-time=sec,gc=default|idle,gc-threshold=kb,tags=tag1;tag2,service=name}scriptName
+ ** returns the script name without options, tags and service have to be freed by the caller
+ **/
+static char *script_launch_opts_parse(char *script_name, script_launch_opts_t *lopts) {
+    char *opts = NULL, *end = NULL, *argv[8] = { 0 };
+    int argc = 0;
 
-    script->script_len = switch_file_get_size(fd);
-    if(!script->script_len) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Script file is empty (%s)\n", script->path);
-        switch_goto_status(SWITCH_STATUS_FALSE, out);
+    if(zstr(script_name) || *script_name != '{' || !(end = strchr(script_name, '}'))) {
+        return script_name;
     }
 
-    if((script->script_buf = switch_core_alloc(script->pool, script->script_len + 1)) == NULL)  {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "switch_core_alloc()\n");
-        switch_goto_status(SWITCH_STATUS_MEMERR, out);
-    }
+    opts = strndup(script_name + 1, (end - script_name - 1));
+    argc = switch_separate_string(opts, ',', argv, ARRAY_SIZE(argv));
 
-    if(switch_file_read(fd, script->script_buf, &script->script_len) != SWITCH_STATUS_SUCCESS) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Couldn't read file\n");
-        switch_goto_status(SWITCH_STATUS_FALSE, out);
+    for(int i = 0; i < argc; i++) {
+        char *val = strchr(argv[i], '=');
+        if(!val) {
+            continue;
+        }
+        *val++ = '\0';
+
+        if(!strcasecmp(argv[i], "wall-time")) {
+            lopts->wall_time_max = atoi(val);
+        } else if(!strcasecmp(argv[i], "cpu-time")) {
+            lopts->cpu_time_max = atoi(val);
+        } else if(!strcasecmp(argv[i], "gc")) {
+            lopts->gc_mode = (!strcasecmp(val, "idle") ? SCRIPT_GC_MODE_IDLE : SCRIPT_GC_MODE_DEFAULT);
+        } else if(!strcasecmp(argv[i], "gc-threshold")) {
+            int x = atoi(val);
+            if(x >= 0) lopts->gc_threshold = (size_t)x * 1024;
+        } else if(!strcasecmp(argv[i], "tags")) {
+            switch_safe_free(lopts->tags);
+            lopts->tags = (zstr(val) ? NULL : strdup(val));
+        } else if(!strcasecmp(argv[i], "service")) {
+            switch_safe_free(lopts->service);
+            lopts->service = (zstr(val) ? NULL : strdup(val));
+        } else {
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Unsupported launch option (%s)\n", argv[i]);
+        }
     }
 
-    script->script_buf[script->script_len] = '\0';
-
-out:
-    if(fd) {
-        switch_file_close(fd);
-    }
-    return status;
+    switch_safe_free(opts);
+    return (end + 1);
 }
 
-static switch_status_t script_launch(switch_core_session_t *session, char *script_name, char *script_args, char *script_id, uint8_t inbg) {
+switch_status_t script_launch(switch_core_session_t *session, char *script_name, char *script_args, char *script_id, uint8_t inbg, bench_t *bench) {
     switch_status_t status = SWITCH_STATUS_SUCCESS;
     char *script_path_local = NULL;
     char *script_args_local = NULL;
     switch_memory_pool_t *pool = NULL;
     script_t *script = NULL;
+    script_launch_opts_t lopts = { 0 };
+    uint8_t fl_bundle = false;
+
+    lopts.wall_time_max = globals.cfg_script_wall_time_max;
+    lopts.cpu_time_max = globals.cfg_script_cpu_time_max;
+    lopts.gc_mode = globals.cfg_gc_mode;
+    lopts.gc_threshold = globals.cfg_gc_threshold;
+
+    script_name = script_launch_opts_parse(script_name, &lopts);
 
     if(zstr(script_name)) {
         switch_goto_status(SWITCH_STATUS_FALSE, out);
@@ -593,7 +639,10 @@ static switch_status_t script_launch(switch_core_session_t *session, char *scrip
         script_args_local = strdup(script_args);
     }
 
-    if(switch_file_exists(script_name, NULL) == SWITCH_STATUS_SUCCESS) {
+    if(bundle_exists(script_name)) {
+        script_path_local = strdup(script_name);
+        fl_bundle = true;
+    } else if(switch_file_exists(script_name, NULL) == SWITCH_STATUS_SUCCESS) {
         script_path_local = strdup(script_name);
     } else {
         script_path_local = switch_mprintf("%s%s%s", SWITCH_GLOBAL_dirs.script_dir, SWITCH_PATH_SEPARATOR, script_name);
@@ -625,27 +674,50 @@ static switch_status_t script_launch(switch_core_session_t *session, char *scrip
 
     script->pool = pool;
     script->path = switch_core_strdup(pool, script_path_local);
+    script->fl_bundle = fl_bundle;
     script->name = basename(script->path);
     script->args = (!zstr(script_args_local) ? switch_core_strdup(pool, script_args_local) : NULL);
     script->session_id = (session ? switch_core_session_get_uuid(session) : NULL);
     script->session = session;
+    script->wall_time_max = lopts.wall_time_max;
+    script->cpu_time_max = lopts.cpu_time_max;
+    script->gc_mode = lopts.gc_mode;
+    script->gc_threshold = lopts.gc_threshold;
+    script->bench = bench;
+    script->log_level = globals.cfg_log_level;
+    script->service_name = (lopts.service ? switch_core_strdup(pool, lopts.service) : NULL);
 
     switch_mutex_init(&script->mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_thread_cond_create(&script->sem_cond, pool);
 
-    status = script_load(script);
-    if(status != SWITCH_STATUS_SUCCESS) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to load script\n");
-        goto out;
+    if(lopts.tags) {
+        char *tags[SCRIPT_TAGS_MAX] = { 0 };
+        int tags_count = switch_separate_string(lopts.tags, ';', tags, ARRAY_SIZE(tags));
+
+        script->tags = switch_core_alloc(pool, sizeof(char *) * tags_count);
+        for(int i = 0; i < tags_count; i++) {
+            uint8_t fl_dup = zstr(tags[i]);
+
+            for(int j = 0; j < script->tags_count && !fl_dup; j++) {
+                fl_dup = (strcmp(script->tags[j], tags[i]) == 0);
+            }
+            if(!fl_dup) {
+                script->tags[script->tags_count++] = switch_core_strdup(pool, tags[i]);
+            }
+        }
     }
 
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "script-id (%s) [%s]\n", script->id, script->name);
 
-    switch_mutex_lock(globals.mutex_scripts_map);
-    switch_core_hash_insert(globals.scripts_map, script->id, script);
-    switch_mutex_unlock(globals.mutex_scripts_map);
+    registry_add(script);
+    script->timing.queued = switch_micro_time_now();
 
     if(inbg) {
-        launch_thread(pool, script_thread, script);
+        if((status = wpool_submit((session ? WPOOL_PRIO_SESSION : WPOOL_PRIO_BACKGROUND), script_thread, script)) != SWITCH_STATUS_SUCCESS) {
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Unable to launch script, workers are busy (%s)\n", script->name);
+            registry_remove(script);
+            goto out;
+        }
     } else {
         script_thread(NULL, script);
     }
@@ -661,74 +733,158 @@ out:
     }
     switch_safe_free(script_path_local);
     switch_safe_free(script_args_local);
+    switch_safe_free(lopts.tags);
+    switch_safe_free(lopts.service);
     return status;
 }
 
+typedef switch_status_t (js_class_register_func_t)(JSContext *ctx, JSValue global_obj);
+
+static const struct {
+    const char                  *name;
+    js_class_register_func_t    *register_func;
+} js_builtin_classes[] = {
+    { "Session",        js_session_class_register },
+    { "Codec",          js_codec_class_register },
+    { "FileHandle",     js_file_handle_class_register },
+    { "Event",          js_event_class_register },
+    { "File",           js_file_class_register },
+    { "Socket",         js_socket_class_register },
+    { "CoreDB",         js_coredb_class_register },
+    { "EventHandler",   js_eventhandler_class_register },
+    { "XML",            js_xml_class_register },
+    { "CURL",           js_curl_class_register },
+    { "DBH",            js_dbh_class_register },
+    { "Channel",        js_channel_class_register },
+    { "SharedMap",      js_sharedmap_class_register },
+    { "SharedMemory",   js_sharedmem_class_register }
+};
+
+/* replaces the placeholder by the real constructor on first access */
+static JSValue js_builtin_class_getter(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic) {
+    JSValue global_obj = JS_GetGlobalObject(ctx);
+    JSAtom atom = JS_NewAtom(ctx, js_builtin_classes[magic].name);
+    JSValue ret_val;
+
+    JS_DeleteProperty(ctx, global_obj, atom, 0);
+    js_builtin_classes[magic].register_func(ctx, global_obj);
+    ret_val = JS_GetProperty(ctx, global_obj, atom);
+
+    JS_FreeAtom(ctx, atom);
+    JS_FreeValue(ctx, global_obj);
+
+    return ret_val;
+}
+
+/**
+ ** creates a context with the global functions which don't depend on a script
+ ** the runtime opaque must be already set
+ **/
+JSContext *js_builtins_ctx_create(JSRuntime *rt) {
+    JSContext *ctx = NULL;
+    JSValue global_obj, runtime_obj;
+
+    if(!(ctx = JS_NewContext(rt))) {
+        return NULL;
+    }
+
+    global_obj = JS_GetGlobalObject(ctx);
+
+    /* classes are registered on first access */
+    for(int i = 0; i < ARRAY_SIZE(js_builtin_classes); i++) {
+        JSAtom atom = JS_NewAtom(ctx, js_builtin_classes[i].name);
+        JSValue getter = JS_NewCFunctionMagic(ctx, js_builtin_class_getter, js_builtin_classes[i].name, 0, JS_CFUNC_generic_magic, i);
+
+        JS_DefinePropertyGetSet(ctx, global_obj, atom, getter, JS_UNDEFINED, JS_PROP_CONFIGURABLE);
+        JS_FreeAtom(ctx, atom);
+    }
+
+    runtime_obj = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, runtime_obj, "type", JS_NewString(ctx, MOD_RT_TYPE));
+    JS_SetPropertyStr(ctx, runtime_obj, "version", JS_NewString(ctx, MOD_VERSION));
+    JS_SetPropertyStr(ctx, runtime_obj, "switchId", JS_NewString(ctx, switch_core_get_uuid()));
+    JS_SetPropertyStr(ctx, runtime_obj, "switchName", JS_NewString(ctx, switch_core_get_switchname()));
+    JS_SetPropertyStr(ctx, runtime_obj, "switchVersion", JS_NewString(ctx, switch_version_full()));
+    JS_SetPropertyStr(ctx, runtime_obj, "hostname", JS_NewString(ctx, switch_core_get_hostname()));
+    JS_SetPropertyStr(ctx, runtime_obj, "gc", JS_NewCFunction(ctx, js_runtime_gc, "gc", 0));
+    JS_SetPropertyStr(ctx, global_obj, "runtime", runtime_obj);
+
+    /* global fncs */
+    JS_SetPropertyStr(ctx, global_obj, "console_log", JS_NewCFunction(ctx, js_console_log, "console_log", 0));
+    JS_SetPropertyStr(ctx, global_obj, "consoleLog", JS_NewCFunction(ctx, js_console_log, "consoleLog", 0));
+    JS_SetPropertyStr(ctx, global_obj, "msleep", JS_NewCFunction(ctx, js_msleep, "msleep", 1));
+    JS_SetPropertyStr(ctx, global_obj, "bridge", JS_NewCFunction(ctx, js_bridge, "bridge", 2));
+    JS_SetPropertyStr(ctx, global_obj, "system", JS_NewCFunction(ctx, js_system, "system", 1));
+    JS_SetPropertyStr(ctx, global_obj, "exit", JS_NewCFunction(ctx, js_exit, "exit", 1));
+    JS_SetPropertyStr(ctx, global_obj, "md5", JS_NewCFunction(ctx, js_md5, "md5", 1));
+    JS_SetPropertyStr(ctx, global_obj, "crc32", JS_NewCFunction(ctx, js_crc32, "crc32", 1));
+    JS_SetPropertyStr(ctx, global_obj, "unlink", JS_NewCFunction(ctx, js_unlink, "unlink", 1));
+    JS_SetPropertyStr(ctx, global_obj, "mkdir", JS_NewCFunction(ctx, js_mkdir, "mkdir", 1));
+    JS_SetPropertyStr(ctx, global_obj, "dirExists", JS_NewCFunction(ctx, js_dir_exists, "dirExists", 1));
+    JS_SetPropertyStr(ctx, global_obj, "fileExists", JS_NewCFunction(ctx, js_file_exists, "fileExists", 1));
+    JS_SetPropertyStr(ctx, global_obj, "epochTime", JS_NewCFunction(ctx, js_epoch_time, "epochTime", 1));
+    JS_SetPropertyStr(ctx, global_obj, "microTime", JS_NewCFunction(ctx, js_micro_time, "microTime", 1));
+    JS_SetPropertyStr(ctx, global_obj, "apiExecute", JS_NewCFunction(ctx, js_api_execute, "apiExecute", 2));
+    JS_SetPropertyStr(ctx, global_obj, "setGlobalVariable", JS_NewCFunction(ctx, js_global_set, "setGlobalVariable", 2));
+    JS_SetPropertyStr(ctx, global_obj, "getGlobalVariable", JS_NewCFunction(ctx, js_global_get, "getGlobalVariable", 2));
+    JS_SetPropertyStr(ctx, global_obj, "getPath", JS_NewCFunction(ctx, js_get_path, "getPath", 1));
+    JS_SetPropertyStr(ctx, global_obj, "getUUID", JS_NewCFunction(ctx, js_get_uuid, "getUUID", 1));
+    JS_SetPropertyStr(ctx, global_obj, "chatSend", JS_NewCFunction(ctx, js_chat_send, "chatSend", 1));
+
+    evloop_register_globals(ctx, global_obj);
+    logger_register_globals(ctx, global_obj);
+    service_register_globals(ctx, global_obj);
+    js_sharedmem_register_globals(ctx, global_obj);
+
+    JS_FreeValue(ctx, global_obj);
+
+    return ctx;
+}
+
 static void *SWITCH_THREAD_FUNC script_thread(switch_thread_t *thread, void *obj) {
     volatile script_t *_ref = (script_t *) obj;
     script_t *script = (script_t *) _ref;
     switch_memory_pool_t *pool = script->pool;
-    switch_status_t status = SWITCH_STATUS_SUCCESS;
+    js_runtime_t *jsrt = NULL;
     JSContext *ctx = NULL;
     JSRuntime *rt = NULL;
-    JSValue global_obj, session_obj, script_obj, runtime_obj, argc_obj, argv_obj;
-    JSValue result;
+    JSValue global_obj = JS_UNDEFINED, session_obj, script_obj, argc_obj, argv_obj;
+    JSValue func_val, result;
+
+    script->timing.started = switch_micro_time_now();
 
     if(script->fl_destroyed || globals.fl_shutdown) {
         goto out;
     }
 
-    if(!(rt = JS_NewRuntime())) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to create runtime (jsRuntime)\n");
-        goto out;
-    }
-    if(!(ctx = JS_NewContext(rt))) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to create context (jsCtx)\n");
+    if(evloop_create(&script->evloop, pool) != SWITCH_STATUS_SUCCESS) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to create event loop\n");
         goto out;
     }
 
-    if(globals.cfg_rt_mem_limit) {
-        JS_SetMemoryLimit(rt, globals.cfg_rt_mem_limit);
-    }
-    if(globals.cfg_rt_stk_size) {
-        JS_SetMaxStackSize(rt, globals.cfg_rt_stk_size);
+    if(!(jsrt = rtpool_take())) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to get runtime (jsRuntime)\n");
+        goto out;
     }
 
-    JS_SetModuleLoaderFunc(rt, NULL, xxx_module_loader, NULL);
+    rt = jsrt->rt;
+    ctx = jsrt->ctx;
+    script->timing.rt_ready = switch_micro_time_now();
 
+    jsrt->script = script;
+    script->jsrt = jsrt;
     script->rt = rt;
     script->ctx = ctx;
 
-    JS_SetCanBlock(rt, 1);
     JS_SetRuntimeInfo(rt, script->name);
-    JS_SetRuntimeOpaque(rt, script);
     JS_SetContextOpaque(ctx, script);
+    script_gc_setup(script);
 
-    global_obj = JS_GetGlobalObject(ctx);
-
-    /* register classes */
-    script->fl_ready = true; // temporary
-    js_session_class_register(ctx, global_obj, 1000);
-    js_codec_class_register(ctx, global_obj, 1001);
-    js_file_handle_class_register(ctx, global_obj, 1002);
-    js_event_class_register(ctx, global_obj, 1003);
-    js_file_class_register(ctx, global_obj, 1004);
-    js_socket_class_register(ctx, global_obj, 1005);
-    js_coredb_class_register(ctx, global_obj, 1006);
-    js_eventhandler_class_register(ctx, global_obj, 1007);
-    js_xml_class_register(ctx, global_obj, 1008);
-    js_curl_class_register(ctx, global_obj, 1009);
-    js_dbh_class_register(ctx, global_obj, 10010);
-    script->fl_ready = false; // clear
+    script->wall_time_start = switch_micro_time_now();
+    script->cpu_time_start = script_cpu_time_now();
+    stats_update(script, true);
 
-    runtime_obj = JS_NewObject(ctx);
-    JS_SetPropertyStr(ctx, runtime_obj, "type", JS_NewString(ctx, MOD_RT_TYPE));
-    JS_SetPropertyStr(ctx, runtime_obj, "version", JS_NewString(ctx, MOD_VERSION));
-    JS_SetPropertyStr(ctx, runtime_obj, "switchId", JS_NewString(ctx, switch_core_get_uuid()));
-    JS_SetPropertyStr(ctx, runtime_obj, "switchName", JS_NewString(ctx, switch_core_get_switchname()));
-    JS_SetPropertyStr(ctx, runtime_obj, "switchVersion", JS_NewString(ctx, switch_version_full()));
-    JS_SetPropertyStr(ctx, runtime_obj, "hostname", JS_NewString(ctx, switch_core_get_hostname()));
-    JS_SetPropertyStr(ctx, global_obj, "runtime", runtime_obj);
+    global_obj = JS_GetGlobalObject(ctx);
 
     script_obj = JS_NewObject(ctx);
     JS_SetPropertyStr(ctx, script_obj, "id",   JS_NewString(ctx, script->id));
@@ -758,28 +914,6 @@ static void *SWITCH_THREAD_FUNC script_thread(switch_thread_t *thread, void *obj
         JS_SetPropertyStr(ctx, global_obj, "argv", JS_NewArray(ctx));
     }
 
-    /* global fncs */
-    JS_SetPropertyStr(ctx, global_obj, "console_log", JS_NewCFunction(ctx, js_console_log, "console_log", 0));
-    JS_SetPropertyStr(ctx, global_obj, "consoleLog", JS_NewCFunction(ctx, js_console_log, "consoleLog", 0));
-    JS_SetPropertyStr(ctx, global_obj, "msleep", JS_NewCFunction(ctx, js_msleep, "msleep", 1));
-    JS_SetPropertyStr(ctx, global_obj, "bridge", JS_NewCFunction(ctx, js_bridge, "bridge", 2));
-    JS_SetPropertyStr(ctx, global_obj, "system", JS_NewCFunction(ctx, js_system, "system", 1));
-    JS_SetPropertyStr(ctx, global_obj, "exit", JS_NewCFunction(ctx, js_exit, "exit", 1));
-    JS_SetPropertyStr(ctx, global_obj, "md5", JS_NewCFunction(ctx, js_md5, "md5", 1));
-    JS_SetPropertyStr(ctx, global_obj, "crc32", JS_NewCFunction(ctx, js_crc32, "crc32", 1));
-    JS_SetPropertyStr(ctx, global_obj, "unlink", JS_NewCFunction(ctx, js_unlink, "unlink", 1));
-    JS_SetPropertyStr(ctx, global_obj, "mkdir", JS_NewCFunction(ctx, js_mkdir, "mkdir", 1));
-    JS_SetPropertyStr(ctx, global_obj, "dirExists", JS_NewCFunction(ctx, js_dir_exists, "dirExists", 1));
-    JS_SetPropertyStr(ctx, global_obj, "fileExists", JS_NewCFunction(ctx, js_file_exists, "fileExists", 1));
-    JS_SetPropertyStr(ctx, global_obj, "epochTime", JS_NewCFunction(ctx, js_epoch_time, "epochTime", 1));
-    JS_SetPropertyStr(ctx, global_obj, "microTime", JS_NewCFunction(ctx, js_micro_time, "microTime", 1));
-    JS_SetPropertyStr(ctx, global_obj, "apiExecute", JS_NewCFunction(ctx, js_api_execute, "apiExecute", 2));
-    JS_SetPropertyStr(ctx, global_obj, "setGlobalVariable", JS_NewCFunction(ctx, js_global_set, "setGlobalVariable", 2));
-    JS_SetPropertyStr(ctx, global_obj, "getGlobalVariable", JS_NewCFunction(ctx, js_global_get, "getGlobalVariable", 2));
-    JS_SetPropertyStr(ctx, global_obj, "getPath", JS_NewCFunction(ctx, js_get_path, "getPath", 1));
-    JS_SetPropertyStr(ctx, global_obj, "getUUID", JS_NewCFunction(ctx, js_get_uuid, "getUUID", 1));
-    JS_SetPropertyStr(ctx, global_obj, "chatSend", JS_NewCFunction(ctx, js_chat_send, "chatSend", 1));
-
     if(script->session) {
         script->fl_ready = true;
 
@@ -793,35 +927,69 @@ static void *SWITCH_THREAD_FUNC script_thread(switch_thread_t *thread, void *obj
     }
 
     script->fl_ready = true;
-    result = JS_Eval(ctx, script->script_buf, script->script_len, script->name, JS_EVAL_TYPE_GLOBAL | JS_EVAL_TYPE_MODULE);
+    script->timing.setup_done = switch_micro_time_now();
+
+    if(script->fl_bundle) {
+        func_val = bundle_load(ctx, script->path, &script->code);
+        if(JS_IsUndefined(func_val)) {
+            func_val = JS_ThrowReferenceError(ctx, "Script not found in the bundles '%s'", script->path);
+        }
+    } else {
+        func_val = bcache_load(ctx, script->path, script->name, JS_EVAL_TYPE_MODULE, &script->code);
+    }
+    if(!JS_IsException(func_val) && JS_VALUE_GET_TAG(func_val) == JS_TAG_MODULE) {
+        if(JS_ResolveModule(ctx, func_val) < 0) {
+            JS_FreeValue(ctx, func_val);
+            func_val = JS_EXCEPTION;
+        }
+    }
+    result = (JS_IsException(func_val) ? func_val : JS_EvalFunction(ctx, func_val));
 
     if(JS_IsException(result)) {
         js_ctx_dump_error(script, ctx);
         JS_ResetUncatchableError(ctx);
+    } else {
+        evloop_run(script->evloop, ctx);
     }
 
     JS_FreeValue(ctx, result);
+    script->timing.eval_done = switch_micro_time_now();
 
 out:
-    JS_FreeValue(ctx, global_obj);
+    if(ctx) {
+        JS_FreeValue(ctx, global_obj);
+        service_script_done(script);
+    }
 
     script->fl_destroyed = true;
     script_wait_unlock(script);
 
-    if(ctx) { JS_FreeContext(ctx); }
-    if(rt)  { JS_FreeRuntime(rt); }
+    if(jsrt) {
+        evloop_clear(script->evloop, ctx);
+        rtpool_release(jsrt);
+        script->jsrt = NULL;
+        script->ctx = NULL;
+        script->rt = NULL;
+    }
 
     /* ready must be changed only after rt/ctx been destroyed!  */
     /* Otherwise it corrupts js_session                         */
     script->fl_ready = false;
 
-    switch_mutex_lock(globals.mutex_scripts_map);
-    switch_core_hash_delete(globals.scripts_map, script->id);
-    switch_mutex_unlock(globals.mutex_scripts_map);
+    if(script->evloop) {
+        evloop_destroy(&script->evloop);
+    }
+
+    /* nobody can find the script after that, only wait for those who already took it */
+    registry_remove(script);
+    script_wait_unlock(script);
 
     if(script->mod_hlist) {
         js_list_destroy(&script->mod_hlist);
     }
+    if(script->bench) {
+        bench_script_done(script);
+    }
     if(pool) {
         switch_core_destroy_memory_pool(&pool);
     }
@@ -834,10 +1002,50 @@ out:
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------
 #define CMD_SYNTAX "\n" \
-    "list - show running scripts\n" \
-    "run-bg scriptName [args] - launch the script in backgroud\n" \
-    "run    scriptName [args] - launch the script\n" \
-    "int    scriptId - interrupt script\n"
+    "list   [name=scriptName|session=uuid|tag=tag] - show running scripts\n" \
+    "run-bg [{wall-time=sec,cpu-time=sec,gc=default|idle,gc-threshold=kb,tags=tag1;tag2,service=name}]scriptName [args] - launch the script in backgroud\n" \
+    "run    [{wall-time=sec,cpu-time=sec,gc=default|idle,gc-threshold=kb,tags=tag1;tag2,service=name}]scriptName [args] - launch the script\n" \
+    "int    scriptId - interrupt script\n" \
+    "int-session uuid - interrupt all scripts of the session\n" \
+    "cache  stats|flush - bytecode cache\n" \
+    "compile dir out.qjsb [entry.js] - compile the entry (or all scripts in dir) with imports into a bundle\n" \
+    "bundle stats|reload - bytecode bundles\n" \
+    "modules stats - loaded native modules\n" \
+    "pool   stats - runtimes pool\n" \
+    "workers stats - workers and run queues\n" \
+    "stats  [scriptId] [json] - scripts resources usage\n" \
+    "gc     stats - garbage collector pauses\n" \
+    "native-stats [json] - native calls latencies (native-stats)\n" \
+    "log    stats - log object writer\n" \
+    "profile scriptId seconds [hz] - sample the script js stacks, folded output (flamegraph.pl)\n" \
+    "bench  scriptName [runs] [concurrency] [dialstring] - launch the script runs times and report the timings (json)\n" \
+    "services - resident call handlers (qjs_dispatch)\n" \
+    "channels - inter-script channels\n" \
+    "sharedmap stats - shared key-value store\n" \
+    "sharedmem stats - named shared memory regions (SharedMemory)\n"
+
+static void cmd_list_cb(script_t *script, void *udata) {
+    switch_stream_handle_t *stream = (switch_stream_handle_t *)udata;
+    switch_time_exp_t tm = { 0 };
+    switch_size_t retsize = 0;
+    char loaded[64] = { 0 };
+
+    switch_time_exp_lt(&tm, script->code.loaded);
+    switch_strftime_nocheck(loaded, &retsize, sizeof(loaded), "%Y-%m-%d %H:%M:%S", &tm);
+
+    stream->write_function(stream, "%s (%s) [session: %s] [version: %u, loaded: %s]\n",
+                           script->id, script->path, (script->session_id ? script->session_id : "none"), script->code.version, loaded);
+}
+
+static void cmd_interrupt_cb(script_t *script, void *udata) {
+    uint32_t *count = (uint32_t *)udata;
+
+    if(script->fl_ready && !script->fl_destroyed) {
+        script->fl_interrupt = true;
+        evloop_wakeup(script->evloop);
+        if(count) { (*count)++; }
+    }
+}
 
 SWITCH_STANDARD_API(quickjs_cmd) {
     switch_status_t status = SWITCH_STATUS_SUCCESS;
@@ -852,32 +1060,145 @@ SWITCH_STANDARD_API(quickjs_cmd) {
     if(argc == 0) { goto usage; }
     if(globals.fl_shutdown) { goto out; }
 
-    if(argc == 1) {
-        if(strcasecmp(argv[0], "list") == 0) {
-            switch_hash_index_t *hidx = NULL;
-
-            switch_mutex_lock(globals.mutex_scripts_map);
-            for(hidx = switch_core_hash_first_iter(globals.scripts_map, hidx); hidx; hidx = switch_core_hash_next(&hidx)) {
-                script_t *script = NULL;
-                void *hval = NULL;
+    if(strcasecmp(argv[0], "stats") == 0) {
+        uint8_t fl_json = (argc > 1 && !strcasecmp(argv[argc - 1], "json"));
+        char *id = ((argc > 2 || (argc == 2 && !fl_json)) ? argv[1] : NULL);
 
-                switch_core_hash_this(hidx, NULL, NULL, &hval);
-                script = (script_t *)hval;
-
-                if(script_sem_take(script)) {
-                    stream->write_function(stream, "%s (%s) [session: %s]\n", script->id, script->path, (script->session_id ? script->session_id : "none"));
-                    script_sem_release(script);
-                }
-            }
-            switch_mutex_unlock(globals.mutex_scripts_map);
+        stats_write(stream, id, fl_json);
+        goto out;
+    }
+    if(strcasecmp(argv[0], "services") == 0) {
+        service_stats(stream);
+        goto out;
+    }
+    if(strcasecmp(argv[0], "channels") == 0) {
+        js_channel_registry_stats(stream);
+        goto out;
+    }
+    if(strcasecmp(argv[0], "log") == 0) {
+        if(argc > 1 && !strcasecmp(argv[1], "stats")) {
+            logger_stats(stream);
             goto out;
         }
         goto usage;
     }
+    if(strcasecmp(argv[0], "native-stats") == 0) {
+        nstats_write(stream, (argc > 1 && !strcasecmp(argv[1], "json")));
+        goto out;
+    }
+    if(strcasecmp(argv[0], "list") == 0) {
+        if(argc == 1) {
+            registry_foreach(REGISTRY_INDEX_ALL, NULL, cmd_list_cb, stream);
+        } else if(!strncasecmp(argv[1], "name=", 5)) {
+            registry_foreach(REGISTRY_INDEX_NAME, argv[1] + 5, cmd_list_cb, stream);
+        } else if(!strncasecmp(argv[1], "session=", 8)) {
+            registry_foreach(REGISTRY_INDEX_SESSION, argv[1] + 8, cmd_list_cb, stream);
+        } else if(!strncasecmp(argv[1], "tag=", 4)) {
+            registry_foreach(REGISTRY_INDEX_TAG, argv[1] + 4, cmd_list_cb, stream);
+        } else {
+            goto usage;
+        }
+        goto out;
+    }
+    if(argc == 1) {
+        goto usage;
+    }
+    if(strcasecmp(argv[0], "cache") == 0) {
+        if(strcasecmp(argv[1], "stats") == 0) {
+            bcache_stats(stream);
+        } else if(strcasecmp(argv[1], "flush") == 0) {
+            bcache_flush();
+            stream->write_function(stream, "+OK\n");
+        } else {
+            goto usage;
+        }
+        goto out;
+    }
+    if(strcasecmp(argv[0], "compile") == 0) {
+        if(argc > 2) {
+            bundle_compile(argv[1], argv[2], (argc > 3 ? argv[3] : NULL), stream);
+        } else {
+            goto usage;
+        }
+        goto out;
+    }
+    if(strcasecmp(argv[0], "bundle") == 0) {
+        if(argc > 1 && strcasecmp(argv[1], "stats") == 0) {
+            bundle_stats(stream);
+        } else if(argc > 1 && strcasecmp(argv[1], "reload") == 0) {
+            stream->write_function(stream, (bundle_reload() == SWITCH_STATUS_SUCCESS ? "+OK\n" : "-ERR: no bundles loaded (see log)\n"));
+        } else {
+            goto usage;
+        }
+        goto out;
+    }
+    if(strcasecmp(argv[0], "gc") == 0) {
+        if(argc > 1 && strcasecmp(argv[1], "stats") == 0) {
+            stats_gc_write(stream);
+        } else {
+            goto usage;
+        }
+        goto out;
+    }
+    if(strcasecmp(argv[0], "profile") == 0) {
+        if(argc > 2) {
+            profiler_run(argv[1], atoi(argv[2]), (argc > 3 ? atoi(argv[3]) : 0), stream);
+        } else {
+            goto usage;
+        }
+        goto out;
+    }
+    if(strcasecmp(argv[0], "bench") == 0) {
+        uint32_t runs = (argc > 2 ? atoi(argv[2]) : 1);
+        uint32_t concurrency = (argc > 3 ? atoi(argv[3]) : 1);
+
+        bench_run(argv[1], runs, concurrency, (argc > 4 ? argv[4] : NULL), stream);
+        goto out;
+    }
+    if(strcasecmp(argv[0], "modules") == 0) {
+        if(argc > 1 && strcasecmp(argv[1], "stats") == 0) {
+            solib_stats(stream);
+        } else {
+            goto usage;
+        }
+        goto out;
+    }
+    if(strcasecmp(argv[0], "pool") == 0) {
+        if(strcasecmp(argv[1], "stats") == 0) {
+            rtpool_stats(stream);
+        } else {
+            goto usage;
+        }
+        goto out;
+    }
+    if(strcasecmp(argv[0], "sharedmem") == 0) {
+        if(argc > 1 && strcasecmp(argv[1], "stats") == 0) {
+            js_sharedmem_stats(stream);
+        } else {
+            goto usage;
+        }
+        goto out;
+    }
+    if(strcasecmp(argv[0], "sharedmap") == 0) {
+        if(argc > 1 && strcasecmp(argv[1], "stats") == 0) {
+            js_sharedmap_store_stats(stream);
+        } else {
+            goto usage;
+        }
+        goto out;
+    }
+    if(strcasecmp(argv[0], "workers") == 0) {
+        if(strcasecmp(argv[1], "stats") == 0) {
+            wpool_stats(stream);
+        } else {
+            goto usage;
+        }
+        goto out;
+    }
     if(strcasecmp(argv[0], "run") == 0) {
         char *script_args = (argc > 2 ? ((char *)cmd + (strlen(argv[0]) + strlen(argv[1]) + 2)) : NULL);
 
-        if((status = script_launch(session, argv[1], script_args, NULL, false)) != SWITCH_STATUS_SUCCESS) {
+        if((status = script_launch(session, argv[1], script_args, NULL, false, NULL)) != SWITCH_STATUS_SUCCESS) {
             stream->write_function(stream, "-ERR: %i\n", status);
         }
 
@@ -889,8 +1210,10 @@ SWITCH_STANDARD_API(quickjs_cmd) {
 
         new_uuid(&script_id, NULL);
 
-        if((status = script_launch(session, argv[1], script_args, script_id, true)) == SWITCH_STATUS_SUCCESS) {
+        if((status = script_launch(session, argv[1], script_args, script_id, true, NULL)) == SWITCH_STATUS_SUCCESS) {
             stream->write_function(stream, "+OK: %s\n", script_id);
+        } else if(status == SWITCH_STATUS_INUSE) {
+            stream->write_function(stream, "-ERR: busy\n");
         } else {
             stream->write_function(stream, "-ERR: %i\n", status);
         }
@@ -903,10 +1226,10 @@ SWITCH_STANDARD_API(quickjs_cmd) {
         char *id = (argc > 1 ? argv[1] : NULL);
         int success = 0;
 
-        script = script_lookup(id);
-        if(script_sem_take(script)) {
+        if((script = registry_lookup(id))) {
             if(script->fl_ready && !script->fl_destroyed) {
                 script->fl_interrupt = true;
+                evloop_wakeup(script->evloop);
                 success++;
             }
             script_sem_release(script);
@@ -914,6 +1237,17 @@ SWITCH_STANDARD_API(quickjs_cmd) {
         stream->write_function(stream, (success ? "+OK\n" : "-ERR: not found\n") );
         goto out;
     }
+    if(strcasecmp(argv[0], "int-session") == 0) {
+        uint32_t count = 0;
+
+        registry_foreach(REGISTRY_INDEX_SESSION, argv[1], cmd_interrupt_cb, &count);
+        if(count) {
+            stream->write_function(stream, "+OK: %u\n", count);
+        } else {
+            stream->write_function(stream, "-ERR: not found\n");
+        }
+        goto out;
+    }
     goto out;
 usage:
     stream->write_function(stream, "-USAGE: %s\n", CMD_SYNTAX);
@@ -940,7 +1274,7 @@ SWITCH_STANDARD_APP(quickjs_app) {
     script_name = argv[0];
     script_args = (argc > 1 ? ((char *)data + (strlen(argv[0]) + 1)) : NULL);
 
-    if((status = script_launch(session, script_name, script_args, NULL, false)) != SWITCH_STATUS_SUCCESS) {
+    if((status = script_launch(session, script_name, script_args, NULL, false, NULL)) != SWITCH_STATUS_SUCCESS) {
         switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to launch script (%s)\n", script_name);
     }
     goto out;
@@ -950,6 +1284,32 @@ out:
     switch_safe_free(mycmd);
 }
 
+#define DISPATCH_SYNTAX "serviceName [args]"
+SWITCH_STANDARD_APP(quickjs_dispatch_app) {
+    char *mycmd = NULL, *argv[2] = { 0 };
+    char *service_args = NULL;
+    int argc = 0;
+
+    if(!zstr(data)) {
+        mycmd = strdup(data);
+        switch_assert(mycmd);
+        argc = switch_separate_string(mycmd, ' ', argv, (sizeof(argv) / sizeof(argv[0])));
+    }
+    if(globals.fl_shutdown) { goto out; }
+    if(argc < 1) { goto usage; }
+
+    service_args = (argc > 1 ? ((char *)data + (strlen(argv[0]) + 1)) : NULL);
+
+    if(service_dispatch(session, argv[0], service_args) != SWITCH_STATUS_SUCCESS) {
+        switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Call handler failed (%s)\n", argv[0]);
+    }
+    goto out;
+usage:
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "%s\n", DISPATCH_SYNTAX);
+out:
+    switch_safe_free(mycmd);
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------------------
 // main
 // ---------------------------------------------------------------------------------------------------------------------------------------------
@@ -961,12 +1321,32 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_quickjs_load) {
     switch_application_interface_t *app_interface;
 
     memset(&globals, 0, sizeof (globals));
-    switch_core_hash_init(&globals.scripts_map);
     switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, pool);
-    switch_mutex_init(&globals.mutex_scripts_map, SWITCH_MUTEX_NESTED, pool);
+    switch_thread_cond_create(&globals.cond_threads, pool);
+    registry_init(pool);
 
     globals.cfg_rt_mem_limit = 0;
     globals.cfg_rt_mem_limit = 0;
+    globals.cfg_bcache_enabled = true;
+    globals.cfg_bcache_size_max = 0;
+    globals.cfg_rt_arena = true;
+    globals.cfg_rt_arena_retain_max = (16 * 1024 * 1024);
+    globals.cfg_rtpool_min = 0;
+    globals.cfg_rtpool_max = 10;
+    globals.cfg_rtpool_idle_timeout = 60;
+    globals.cfg_script_wall_time_max = 0;
+    globals.cfg_script_cpu_time_max = 0;
+    globals.cfg_stats_event_interval = 0;
+    globals.cfg_workers_min = 0;
+    globals.cfg_workers_max = 256;
+    globals.cfg_workers_reserved = 16;
+    globals.cfg_workers_aux_max = 32;
+    globals.cfg_workers_queue_size = 1024;
+    globals.cfg_workers_idle_timeout = 60;
+    globals.cfg_profiler_rate = 100;
+    globals.cfg_log_level = SWITCH_LOG_INVALID;
+    globals.cfg_log_buffered = true;
+    globals.cfg_shmem_size_max = (64 * 1024 * 1024);
 
     /* xml config */
     if((xml = switch_xml_open_cfg(CONFIG_NAME, &cfg, NULL)) == NULL) {
@@ -984,16 +1364,115 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_quickjs_load) {
             } else if(!strcasecmp(var, "rt-memory-limit")) {
                 size_t x = atoi(val);
                 if(x > 0) globals.cfg_rt_mem_limit = x * 1024 * 1024;
+            } else if(!strcasecmp(var, "rt-allocator")) {
+                globals.cfg_rt_arena = (strcasecmp(val, "system") != 0);
+            } else if(!strcasecmp(var, "rt-arena-retain-max")) {
+                int x = atoi(val);
+                if(x >= 0) globals.cfg_rt_arena_retain_max = (size_t)x * 1024 * 1024;
+            } else if(!strcasecmp(var, "gc-mode")) {
+                globals.cfg_gc_mode = (!strcasecmp(val, "idle") ? SCRIPT_GC_MODE_IDLE : SCRIPT_GC_MODE_DEFAULT);
+            } else if(!strcasecmp(var, "gc-threshold")) {
+                int x = atoi(val);
+                if(x >= 0) globals.cfg_gc_threshold = (size_t)x * 1024;
+            } else if(!strcasecmp(var, "bytecode-cache")) {
+                globals.cfg_bcache_enabled = switch_true(val);
+            } else if(!strcasecmp(var, "bytecode-cache-size-max")) {
+                size_t x = atoi(val);
+                if(x > 0) globals.cfg_bcache_size_max = x * 1024 * 1024;
+            } else if(!strcasecmp(var, "rt-pool-min")) {
+                int x = atoi(val);
+                if(x >= 0) globals.cfg_rtpool_min = x;
+            } else if(!strcasecmp(var, "rt-pool-max")) {
+                int x = atoi(val);
+                if(x >= 0) globals.cfg_rtpool_max = x;
+            } else if(!strcasecmp(var, "rt-pool-idle-timeout")) {
+                int x = atoi(val);
+                if(x >= 0) globals.cfg_rtpool_idle_timeout = x;
+            } else if(!strcasecmp(var, "script-wall-time-max")) {
+                int x = atoi(val);
+                if(x >= 0) globals.cfg_script_wall_time_max = x;
+            } else if(!strcasecmp(var, "script-cpu-time-max")) {
+                int x = atoi(val);
+                if(x >= 0) globals.cfg_script_cpu_time_max = x;
+            } else if(!strcasecmp(var, "stats-event-interval")) {
+                int x = atoi(val);
+                if(x >= 0) globals.cfg_stats_event_interval = x;
+            } else if(!strcasecmp(var, "workers-min")) {
+                int x = atoi(val);
+                if(x >= 0) globals.cfg_workers_min = x;
+            } else if(!strcasecmp(var, "workers-max")) {
+                int x = atoi(val);
+                if(x > 0) globals.cfg_workers_max = x;
+            } else if(!strcasecmp(var, "workers-reserved")) {
+                int x = atoi(val);
+                if(x >= 0) globals.cfg_workers_reserved = x;
+            } else if(!strcasecmp(var, "workers-aux-max")) {
+                int x = atoi(val);
+                if(x > 0) globals.cfg_workers_aux_max = x;
+            } else if(!strcasecmp(var, "workers-queue-size")) {
+                int x = atoi(val);
+                if(x > 0) globals.cfg_workers_queue_size = x;
+            } else if(!strcasecmp(var, "workers-idle-timeout")) {
+                int x = atoi(val);
+                if(x >= 0) globals.cfg_workers_idle_timeout = x;
+            } else if(!strcasecmp(var, "script-watcher")) {
+                globals.cfg_watcher_enabled = switch_true(val);
+            } else if(!strcasecmp(var, "script-watcher-dirs")) {
+                globals.cfg_watcher_dirs = (zstr(val) ? NULL : switch_core_strdup(pool, val));
+            } else if(!strcasecmp(var, "so-modules-unload")) {
+                globals.cfg_solib_unload = switch_true(val);
+            } else if(!strcasecmp(var, "native-stats")) {
+                globals.cfg_native_stats = switch_true(val);
+            } else if(!strcasecmp(var, "native-slow-call")) {
+                int x = atoi(val);
+                if(x >= 0) globals.cfg_native_slow_call = (uint64_t)x * 1000000;
+            } else if(!strcasecmp(var, "profiler-rate")) {
+                int x = atoi(val);
+                if(x > 0) globals.cfg_profiler_rate = x;
+            } else if(!strcasecmp(var, "log-level")) {
+                switch_log_level_t level = switch_log_str2level(val);
+                if(level != SWITCH_LOG_INVALID) globals.cfg_log_level = level;
+            } else if(!strcasecmp(var, "log-buffered")) {
+                globals.cfg_log_buffered = switch_true(val);
+            } else if(!strcasecmp(var, "shared-memory-max")) {
+                int x = atoi(val);
+                if(x >= 0) globals.cfg_shmem_size_max = (size_t)x * 1024 * 1024;
+            } else if(!strcasecmp(var, "bundles")) {
+                globals.cfg_bundles = (zstr(val) ? NULL : switch_core_strdup(pool, val));
             }
         }
     }
+
+    if(globals.cfg_rtpool_min > globals.cfg_rtpool_max) {
+        globals.cfg_rtpool_min = globals.cfg_rtpool_max;
+    }
+    if(globals.cfg_workers_min > globals.cfg_workers_max) {
+        globals.cfg_workers_min = globals.cfg_workers_max;
+    }
+
+    bcache_init(pool);
+    bundle_init(pool);
+    solib_init(pool);
+    nstats_init(pool);
+    logger_init(pool);
+    service_init(pool);
+    js_sharedmem_init(pool);
+    rtpool_init(pool);
+    wpool_init(pool);
+    js_channel_registry_init(pool);
+    js_sharedmap_store_init(pool);
+    stats_init(pool);
+    watcher_init(pool);
+
     if((xml_scripts = switch_xml_child(cfg, "autoload-scripts"))) {
         for(xml_script = switch_xml_child(xml_scripts, "script"); xml_script; xml_script = xml_script->next) {
             char *path = (char *) switch_xml_attr_soft(xml_script, "path");
             char *args = (char *) switch_xml_attr_soft(xml_script, "args");
+            int shards = atoi(switch_xml_attr_soft(xml_script, "shards"));
 
-            if(!zstr(path)) {
-                if(script_launch(NULL, path, args, NULL, true) != SWITCH_STATUS_SUCCESS) {
+            /* services are launched once per shard */
+            for(int i = 0; i < (shards > 0 ? shards : 1) && !zstr(path); i++) {
+                if(script_launch(NULL, path, args, NULL, true, NULL) != SWITCH_STATUS_SUCCESS) {
                     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Unable to launch script (%s)", path);
                 }
             }
@@ -1003,6 +1482,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_quickjs_load) {
     *module_interface = switch_loadable_module_create_module_interface(pool, modname);
     SWITCH_ADD_API(cmd_interface, "qjs", "quickjs", quickjs_cmd, CMD_SYNTAX);
     SWITCH_ADD_APP(app_interface, "qjs", "quickjs", "quickjs", quickjs_app, APP_SYNTAX, SAF_NONE);
+    SWITCH_ADD_APP(app_interface, "qjs_dispatch", "quickjs dispatch", "pass the call to a resident script (service.onCall)", quickjs_dispatch_app, DISPATCH_SYNTAX, SAF_NONE);
 
     globals.fl_shutdown = false;
     switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "mod_quckjs (%s) [%s]\n", MOD_VERSION, MOD_RT_TYPE);
@@ -1015,43 +1495,35 @@ done:
 }
 
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_quickjs_shutdown) {
-    switch_hash_index_t *hi = NULL;
-    script_t *script = NULL;
-    uint8_t fl_wloop = true;
-    void *hval = NULL;
 
     globals.fl_shutdown = true;
 
-    switch_mutex_lock(globals.mutex_scripts_map);
-    for(hi = switch_core_hash_first_iter(globals.scripts_map, hi); hi; hi = switch_core_hash_next(&hi)) {
-        switch_core_hash_this(hi, NULL, NULL, &hval);
-        script = (script_t *) hval;
-
-        if(script_sem_take(script)) {
-            script->fl_interrupt = true;
-            script_sem_release(script);
-        }
-    }
-    switch_safe_free(hi);
-    switch_mutex_unlock(globals.mutex_scripts_map);
+    registry_foreach(REGISTRY_INDEX_ALL, NULL, cmd_interrupt_cb, NULL);
 
     switch_mutex_lock(globals.mutex);
-    fl_wloop = (globals.active_threads > 0);
-    switch_mutex_unlock(globals.mutex);
-
-    if(fl_wloop) {
+    if(globals.active_threads > 0) {
         switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Waiting for termination '%d' threads...\n", globals.active_threads);
-        while(fl_wloop) {
-            switch_mutex_lock(globals.mutex);
-            fl_wloop = (globals.active_threads > 0);
-            switch_mutex_unlock(globals.mutex);
-            switch_yield(100000);
+        while(globals.active_threads > 0) {
+            switch_thread_cond_timedwait(globals.cond_threads, globals.mutex, 1000000);
         }
     }
+    switch_mutex_unlock(globals.mutex);
 
-    switch_mutex_lock(globals.mutex_scripts_map);
-    switch_core_hash_destroy(&globals.scripts_map);
-    switch_mutex_unlock(globals.mutex_scripts_map);
+    registry_shutdown();
+    watcher_shutdown();
+
+    wpool_shutdown();
+    js_channel_registry_shutdown();
+    js_sharedmap_store_shutdown();
+    rtpool_shutdown();
+    js_sharedmem_shutdown();
+    bcache_shutdown();
+    bundle_shutdown();
+    solib_shutdown();
+    nstats_shutdown();
+    logger_shutdown();
+    service_shutdown();
+    stats_shutdown();
 
     return SWITCH_STATUS_SUCCESS;
 }
@@ -23,6 +23,29 @@
 #define QJS_IS_NULL(jsV)    (JS_IsNull(jsV) || JS_IsUndefined(jsV) || JS_IsUninitialized(jsV))
 #define ARRAY_SIZE(a)       (sizeof(a) / sizeof((a)[0]))
 #define JID_NONE            0x0
+#define SCRIPT_TAGS_MAX     16
+
+#define SCRIPT_GC_MODE_DEFAULT      0       // quickjs collects by the threshold
+#define SCRIPT_GC_MODE_IDLE         1       // collection is deferred to the idle points
+#define SCRIPT_GC_HIST_BUCKETS      10
+#define SCRIPT_GC_THRESHOLD_DEFAULT (256 * 1024)    // as quickjs has
+#define SCRIPT_GC_IDLE_HARD_FACTOR  8
+#define SCRIPT_GC_IDLE_INTERVAL_US  1000000
+
+/* preferred ids of the builtin classes */
+#define JS_CLASS_ID_SESSION         1000
+#define JS_CLASS_ID_CODEC           1001
+#define JS_CLASS_ID_FILEHANDLE      1002
+#define JS_CLASS_ID_EVENT           1003
+#define JS_CLASS_ID_FILE            1004
+#define JS_CLASS_ID_SOCKET          1005
+#define JS_CLASS_ID_COREDB          1006
+#define JS_CLASS_ID_EVENTHANDLER    1007
+#define JS_CLASS_ID_XML             1008
+#define JS_CLASS_ID_CURL            1009
+#define JS_CLASS_ID_DBH             10010
+#define JS_CLASS_ID_CHANNEL         1011
+#define JS_CLASS_ID_SHAREDMAP       1012
 
 #define MOD_VERSION         "v1.7.8c"
 #define MOD_RT_TYPE         "opensource"
@@ -31,31 +54,109 @@
 
 typedef JSModuleDef *(JSInitModuleFunc)(JSContext *ctx, const char *module_name);
 typedef struct js_list_s  js_list_t;
+typedef struct js_runtime_s js_runtime_t;
+typedef struct evloop_s evloop_t;
+typedef struct solib_s solib_t;
+typedef struct rtalloc_s rtalloc_t;
+typedef struct bench_s bench_t;
+typedef struct profiler_s profiler_t;
+typedef struct service_shard_s service_shard_t;
+typedef JSValue (evloop_result_func_t)(JSContext *ctx, void *data);
+typedef void (evloop_free_func_t)(void *data);
 
 typedef struct {
     switch_mutex_t          *mutex;
-    switch_mutex_t          *mutex_scripts_map;
-    switch_hash_t           *scripts_map;
+    switch_thread_cond_t    *cond_threads;      // signaled when active_threads drops to 0
     uint32_t                active_threads;
     size_t                  cfg_rt_mem_limit;
     size_t                  cfg_rt_stk_size;
+    size_t                  cfg_bcache_size_max;
+    uint8_t                 cfg_bcache_enabled;
+    uint8_t                 cfg_rt_arena;       // per runtime arena allocator
+    size_t                  cfg_rt_arena_retain_max;
+    uint8_t                 cfg_gc_mode;
+    size_t                  cfg_gc_threshold;   // bytes, 0 - quickjs default
+    uint32_t                cfg_rtpool_min;
+    uint32_t                cfg_rtpool_max;
+    uint32_t                cfg_rtpool_idle_timeout;
+    uint32_t                cfg_script_wall_time_max;
+    uint32_t                cfg_script_cpu_time_max;
+    uint32_t                cfg_stats_event_interval;
+    uint32_t                cfg_workers_min;
+    uint32_t                cfg_workers_max;
+    uint32_t                cfg_workers_reserved;
+    uint32_t                cfg_workers_aux_max;    // CURL / playback jobs, above workers-max
+    uint32_t                cfg_workers_queue_size;
+    uint32_t                cfg_workers_idle_timeout;
+    uint8_t                 cfg_watcher_enabled;
+    char                    *cfg_watcher_dirs;  // extra directories, separated by ';'
+    char                    *cfg_bundles;       // .qjsb files, separated by ';'
+    uint8_t                 cfg_solib_unload;   // dlclose native modules when nobody uses them
+    uint8_t                 cfg_native_stats;   // measure the native calls (see: nstats.c)
+    uint64_t                cfg_native_slow_call; // ns, 0 - don't log slow calls
+    uint32_t                cfg_profiler_rate;  // samples per second
+    uint8_t                 cfg_log_buffered;   // log object writes through the writer thread (see: logger.c)
+    switch_log_level_t      cfg_log_level;      // default level of the log object (SWITCH_LOG_INVALID - follow the core)
+    size_t                  cfg_shmem_size_max; // bytes, named shared memory regions in total, 0 - no limits
     uint8_t                 fl_ready;
     uint8_t                 fl_shutdown;
 } globals_t;
 
+typedef struct {
+    switch_time_t           updated;
+    switch_time_t           cpu_time;           // us
+    switch_time_t           gc_time;            // us
+    switch_time_t           gc_pause_max;       // us
+    uint32_t                gc_count;
+    uint32_t                gc_hist[SCRIPT_GC_HIST_BUCKETS];
+    uint32_t                native_objects;
+    int64_t                 heap_used;
+    int64_t                 heap_limit;
+    int64_t                 obj_count;
+    int64_t                 str_count;
+    int64_t                 atom_count;
+    uint64_t                alloc_count;        // runtime allocator (arena)
+    uint64_t                free_count;
+    size_t                  arena_size;
+} script_stats_t;
+
+typedef struct {
+    uint64_t                allocs;
+    uint64_t                frees;
+    uint64_t                large_allocs;
+    size_t                  large_size;         // currently allocated large blocks
+    size_t                  used_size;          // currently allocated (all blocks)
+    size_t                  arena_size;         // chunks
+} rtalloc_stats_t;
+
+typedef struct {
+    uint32_t                version;            // 0 - not cached
+    switch_time_t           loaded;             // when it was compiled
+} bcache_info_t;
+
+typedef struct {
+    switch_time_t           queued;             // launched
+    switch_time_t           started;            // taken by a worker
+    switch_time_t           rt_ready;           // runtime taken from the pool (or created)
+    switch_time_t           setup_done;         // globals and the session object are set
+    switch_time_t           eval_done;          // the script and its event loop are finished
+} script_timing_t;
+
 typedef struct {
     uint8_t                 fl_ready;
     uint8_t                 fl_destroyed;
     uint8_t                 fl_interrupt;
     uint8_t                 fl_exit;
-    switch_size_t           script_len;
+    uint8_t                 fl_bundle;          // loaded from a bundle (path is the name in the bundle)
     uint32_t                sem;
+    switch_thread_cond_t    *sem_cond;          // signaled when sem drops to 0
     char                    *id;
     char                    *name;
     char                    *path;
-    char                    *script_buf;
     char                    *args;
     const char              *session_id;
+    char                    **tags;
+    uint32_t                tags_count;
     switch_memory_pool_t    *pool;
     switch_mutex_t          *mutex;
     switch_core_session_t   *session;
@@ -63,7 +164,37 @@ typedef struct {
     JSRuntime               *rt;
     void                    *opaque;
     js_list_t               *mod_hlist;
-    // builtin classes
+    js_runtime_t            *jsrt;
+    evloop_t                *evloop;
+    uint32_t                wall_time_max;      // seconds, 0 - no limits
+    uint32_t                cpu_time_max;       // seconds, 0 - no limits
+    uint8_t                 gc_mode;
+    size_t                  gc_threshold;       // bytes, 0 - default
+    size_t                  gc_heap_mark;       // heap after the last collection (idle mode)
+    switch_time_t           gc_last;
+    switch_time_t           wall_time_start;
+    switch_time_t           cpu_time_start;
+    script_stats_t          stats;              // snapshot, updated by the script thread
+    bcache_info_t           code;               // version of the code the script was started with
+    script_timing_t         timing;
+    bench_t                 *bench;             // launched by the benchmark (see: bench.c)
+    profiler_t              *profiler;          // NULL - not profiled (changed under the mutex)
+    switch_log_level_t      log_level;          // log object level (log.level)
+    char                    *service_name;      // launch option, the name the call handler is registered with
+    service_shard_t         *service;           // the script handles calls (see: service.c)
+} script_t;
+
+struct js_runtime_s {
+    JSRuntime               *rt;
+    JSContext               *ctx;           // pre-initialized context, taken by the script
+    script_t                *script;        // current owner
+    switch_time_t           idle_since;
+    uint32_t                uses;
+    uint32_t                native_objects;
+    rtalloc_t               *alloc;         // NULL - system allocator
+    js_runtime_t            *next;
+    // builtin classes (registered in the runtime on first use)
+    JSClassID               class_id_channel;
     JSClassID               class_id_codec;
     JSClassID               class_id_coredb;
     JSClassID               class_id_curl;
@@ -73,28 +204,162 @@ typedef struct {
     JSClassID               class_id_file;
     JSClassID               class_id_filehandle;
     JSClassID               class_id_session;
+    JSClassID               class_id_sharedmap;
     JSClassID               class_id_socket;
     JSClassID               class_id_xml;
-} script_t;
+};
 
 typedef struct {
     JSClassID   id;
 } class_id_t;
 
+/* mod_quickjs.c */
+JSModuleDef *xxx_module_loader(JSContext *ctx, const char *module_name, void *opaque);
+JSContext *js_builtins_ctx_create(JSRuntime *rt);
+switch_status_t script_launch(switch_core_session_t *session, char *script_name, char *script_args, char *script_id, uint8_t inbg, bench_t *bench);
+
 /* utils.c */
 char *safe_pool_strdup(switch_memory_pool_t *pool, const char *str);
 uint8_t *safe_pool_bufdup(switch_memory_pool_t *pool, uint8_t *buffer, switch_size_t len);
+void stream_write_escaped(switch_stream_handle_t *stream, const char *str);
 
 void launch_thread(switch_memory_pool_t *pool, switch_thread_start_t fun, void *data);
 void thread_finished();
 
 void js_ctx_dump_error(script_t *script, JSContext *ctx);
+JSClassID js_class_id_register(JSRuntime *rt, JSClassID class_id, JSClassDef *class_def);
 
 switch_status_t new_uuid(char **uuid, switch_memory_pool_t *pool);
 uint32_t script_sem_take(script_t *script);
 void script_sem_release(script_t *script);
 void script_wait_unlock(script_t *script);
-script_t *script_lookup(char *id);
+switch_time_t script_cpu_time_now();
+uint8_t script_budget_exceeded(script_t *script);
+int script_interrupt_handler(JSRuntime *rt, void *opaque);
+void script_gc_run(script_t *script);
+void script_gc_setup(script_t *script);
+void script_gc_idle(script_t *script);
+void js_native_object_created(JSContext *ctx);
+void js_native_object_finalized(JSRuntime *rt);
+
+/* bcache.c */
+switch_status_t bcache_init(switch_memory_pool_t *pool);
+void bcache_shutdown();
+void bcache_flush();
+void bcache_stats(switch_stream_handle_t *stream);
+JSValue bcache_load(JSContext *ctx, const char *path, const char *name, int eval_flags, bcache_info_t *info);
+switch_status_t bcache_preload(JSContext *ctx, const char *path);
+void bcache_invalidate(const char *path);
+
+/* bundle.c */
+switch_status_t bundle_init(switch_memory_pool_t *pool);
+void bundle_shutdown();
+switch_status_t bundle_reload();
+uint8_t bundle_exists(const char *name);
+JSValue bundle_load(JSContext *ctx, const char *name, bcache_info_t *info);
+switch_status_t bundle_compile(const char *dir, const char *out_path, const char *entry, switch_stream_handle_t *stream);
+void bundle_stats(switch_stream_handle_t *stream);
+
+/* rtalloc.c */
+JSRuntime *rtalloc_runtime_new(rtalloc_t **alloc);
+void rtalloc_destroy(rtalloc_t *alloc);
+void rtalloc_stats_get(rtalloc_t *alloc, rtalloc_stats_t *stats);
+size_t rtalloc_used_size(rtalloc_t *alloc);
+size_t rtalloc_footprint(rtalloc_t *alloc);
+
+/* solib.c */
+switch_status_t solib_init(switch_memory_pool_t *pool);
+void solib_shutdown();
+solib_t *solib_acquire(const char *path, JSInitModuleFunc **init, char *errbuf, switch_size_t errbuf_len);
+void solib_release(solib_t *lib);
+void solib_stats(switch_stream_handle_t *stream);
+
+/* bench.c */
+void bench_run(const char *script_name, uint32_t runs, uint32_t concurrency, const char *dialstring, switch_stream_handle_t *stream);
+void bench_script_done(script_t *script);
+
+/* nstats.c */
+switch_status_t nstats_init(switch_memory_pool_t *pool);
+void nstats_shutdown();
+void nstats_write(switch_stream_handle_t *stream, uint8_t fl_json);
+void js_set_function_list(JSContext *ctx, JSValueConst obj, const char *class_name, const JSCFunctionListEntry *tab, int len);
+
+/* profiler.c */
+void profiler_run(const char *id, uint32_t seconds, uint32_t rate, switch_stream_handle_t *stream);
+void profiler_sample(script_t *script);
+
+/* logger.c */
+switch_status_t logger_init(switch_memory_pool_t *pool);
+void logger_shutdown();
+void logger_register_globals(JSContext *ctx, JSValue global_obj);
+void logger_stats(switch_stream_handle_t *stream);
+
+/* service.c */
+switch_status_t service_init(switch_memory_pool_t *pool);
+void service_shutdown();
+void service_register_globals(JSContext *ctx, JSValue global_obj);
+void service_script_done(script_t *script);
+switch_status_t service_dispatch(switch_core_session_t *session, const char *name, const char *args);
+void service_stats(switch_stream_handle_t *stream);
+
+/* watcher.c */
+switch_status_t watcher_init(switch_memory_pool_t *pool);
+void watcher_shutdown();
+
+/* registry.c */
+#define REGISTRY_INDEX_ID       0
+#define REGISTRY_INDEX_SESSION  1
+#define REGISTRY_INDEX_NAME     2
+#define REGISTRY_INDEX_TAG      3
+#define REGISTRY_INDEX_MAX      4
+#define REGISTRY_INDEX_ALL      0xff
+typedef void (registry_foreach_func_t)(script_t *script, void *udata);
+switch_status_t registry_init(switch_memory_pool_t *pool);
+void registry_shutdown();
+switch_status_t registry_add(script_t *script);
+void registry_remove(script_t *script);
+script_t *registry_lookup(const char *id);
+uint32_t registry_foreach(uint8_t index, const char *key, registry_foreach_func_t *func, void *udata);
+
+/* rtpool.c */
+switch_status_t rtpool_init(switch_memory_pool_t *pool);
+void rtpool_shutdown();
+js_runtime_t *rtpool_take();
+void rtpool_release(js_runtime_t *jsrt);
+void rtpool_stats(switch_stream_handle_t *stream);
+void rtpool_counters(uint64_t *created, uint64_t *reused);
+
+/* stats.c */
+#define STATS_EVENT_SUBCLASS    "qjs::stats"
+switch_status_t stats_init(switch_memory_pool_t *pool);
+void stats_shutdown();
+void stats_update(script_t *script, uint8_t force);
+void stats_write(switch_stream_handle_t *stream, const char *id, uint8_t fl_json);
+void stats_gc_pause(script_t *script, switch_time_t pause);
+void stats_gc_write(switch_stream_handle_t *stream);
+
+/* wpool.c */
+#define WPOOL_PRIO_SESSION      0
+#define WPOOL_PRIO_BACKGROUND   1
+#define WPOOL_PRIO_AUX          2       // short jobs the running scripts depend on (CURL, playback), limited by workers-aux-max
+#define WPOOL_PRIO_MAX          3
+switch_status_t wpool_init(switch_memory_pool_t *pool);
+void wpool_shutdown();
+switch_status_t wpool_submit(uint8_t prio, switch_thread_start_t fun, void *data);
+void wpool_stats(switch_stream_handle_t *stream);
+
+/* evloop.c */
+switch_status_t evloop_create(evloop_t **evloop, switch_memory_pool_t *pool);
+void evloop_destroy(evloop_t **evloop);
+void evloop_clear(evloop_t *evloop, JSContext *ctx);
+void evloop_register_globals(JSContext *ctx, JSValue global_obj);
+void evloop_run(evloop_t *evloop, JSContext *ctx);
+void evloop_wakeup(evloop_t *evloop);
+void evloop_ref(evloop_t *evloop);
+void evloop_unref(evloop_t *evloop);
+switch_status_t evloop_post(evloop_t *evloop, evloop_result_func_t *func, void *data, evloop_free_func_t *free_func);
+JSValue evloop_promise_new(JSContext *ctx, evloop_t **evloop, uint32_t *id);
+switch_status_t evloop_complete(evloop_t *evloop, uint32_t id, void *data, evloop_result_func_t *result_func, evloop_free_func_t *free_func);
 
 /* quickjs */
 int has_suffix(const char *str, const char *suffix);
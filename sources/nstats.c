@@ -0,0 +1,392 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+#include <pthread.h>
+
+extern globals_t globals;
+
+/**
+ ** native calls instrumentation (native-stats)
+ ** the class methods are registered through a trampoline which measures each call,
+ ** the counters are per thread (no locks, no shared cache lines) and merged only by 'qjs native-stats',
+ ** latencies go to log-linear histograms: 4 sub-buckets per power of two (ns), ~25% precision
+ **/
+#define NSTATS_FUNCS_MAX        1024
+#define NSTATS_NAME_MAX         64
+#define NSTATS_HIST_SUB_BITS    2
+#define NSTATS_HIST_SUB         (1 << NSTATS_HIST_SUB_BITS)
+#define NSTATS_HIST_MAG_MAX     40                  // 2^40 ns (~18 min), longer calls go to the last bucket
+#define NSTATS_HIST_BUCKETS     (NSTATS_HIST_SUB + (NSTATS_HIST_MAG_MAX - NSTATS_HIST_SUB_BITS + 1) * NSTATS_HIST_SUB)
+
+typedef struct {
+    char                    name[NSTATS_NAME_MAX];  // Class.method
+    uint8_t                 cproto;
+    int16_t                 magic;
+    JSCFunctionType         cfunc;
+} nstats_func_t;
+
+typedef struct {
+    uint64_t                calls;
+    uint64_t                errors;                 // returned an exception
+    uint64_t                time_total;             // ns
+    uint64_t                time_max;
+    uint32_t                hist[NSTATS_HIST_BUCKETS];
+} nstats_counter_t;
+
+typedef struct nstats_thread_s {
+    struct nstats_thread_s  *next;
+    uint8_t                 fl_free;                // the owner has gone, can be taken by a new thread
+    nstats_counter_t        *counters[NSTATS_FUNCS_MAX];
+} nstats_thread_t;
+
+static struct {
+    switch_mutex_t          *mutex;
+    switch_hash_t           *names;                 // name => index + 1
+    nstats_func_t           funcs[NSTATS_FUNCS_MAX];
+    uint32_t                funcs_count;
+    nstats_thread_t         *threads;
+    pthread_key_t           tls_key;
+    uint8_t                 fl_ready;
+} nstats;
+
+static __thread nstats_thread_t *nstats_tls = NULL;
+
+static inline uint64_t nstats_time_now() {
+    struct timespec ts = { 0 };
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint32_t nstats_bucket(uint64_t v) {
+    uint32_t mag = 0;
+
+    if(v < NSTATS_HIST_SUB) {
+        return (uint32_t)v;
+    }
+
+    mag = (63 - __builtin_clzll(v));
+    if(mag > NSTATS_HIST_MAG_MAX) {
+        return (NSTATS_HIST_BUCKETS - 1);
+    }
+
+    return NSTATS_HIST_SUB + (mag - NSTATS_HIST_SUB_BITS) * NSTATS_HIST_SUB + ((v >> (mag - NSTATS_HIST_SUB_BITS)) & (NSTATS_HIST_SUB - 1));
+}
+
+/* the highest value of the bucket */
+static uint64_t nstats_bucket_value(uint32_t bucket) {
+    uint32_t mag = 0, sub = 0;
+
+    if(bucket < NSTATS_HIST_SUB) {
+        return bucket;
+    }
+
+    mag = ((bucket - NSTATS_HIST_SUB) / NSTATS_HIST_SUB) + NSTATS_HIST_SUB_BITS;
+    sub = ((bucket - NSTATS_HIST_SUB) % NSTATS_HIST_SUB);
+
+    return (((uint64_t)(NSTATS_HIST_SUB + sub + 1) << (mag - NSTATS_HIST_SUB_BITS)) - 1);
+}
+
+static void nstats_thread_release(void *data) {
+    nstats_thread_t *nt = (nstats_thread_t *)data;
+
+    if(nt) {
+        __atomic_store_n(&nt->fl_free, true, __ATOMIC_RELEASE);
+    }
+}
+
+static nstats_thread_t *nstats_thread_get() {
+    nstats_thread_t *nt = NULL;
+
+    if(nstats_tls) {
+        return nstats_tls;
+    }
+
+    switch_mutex_lock(nstats.mutex);
+    for(nt = nstats.threads; nt; nt = nt->next) {
+        if(nt->fl_free) {
+            nt->fl_free = false;
+            break;
+        }
+    }
+    if(!nt) {
+        switch_zmalloc(nt, sizeof(nstats_thread_t));
+        nt->next = nstats.threads;
+        nstats.threads = nt;
+    }
+    switch_mutex_unlock(nstats.mutex);
+
+    pthread_setspecific(nstats.tls_key, nt);
+    nstats_tls = nt;
+
+    return nt;
+}
+
+static void nstats_slow_call_log(JSContext *ctx, nstats_func_t *fn, uint64_t duration, uint8_t fl_exception) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    const char *stack = NULL;
+    JSValue exc = JS_UNDEFINED, stack_val = JS_UNDEFINED;
+
+    /* the backtrace is taken from a dummy error (only if there is no pending exception) */
+    if(!fl_exception) {
+        JS_ThrowInternalError(ctx, "slow call");
+        exc = JS_GetException(ctx);
+        stack_val = JS_GetPropertyStr(ctx, exc, "stack");
+        stack = (JS_IsString(stack_val) ? JS_ToCString(ctx, stack_val) : NULL);
+    }
+
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Slow native call: %s took %.3f ms (script: %s)\n%s",
+        fn->name, (double)duration / 1000000.0, (script ? script->name : "?"), (stack ? stack : "")
+    );
+
+    JS_FreeCString(ctx, stack);
+    JS_FreeValue(ctx, stack_val);
+    JS_FreeValue(ctx, exc);
+}
+
+static JSValue nstats_trampoline(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic, JSValue *func_data) {
+    nstats_func_t *fn = &nstats.funcs[magic];
+    nstats_thread_t *nt = nstats_thread_get();
+    nstats_counter_t *cnt = NULL;
+    uint64_t start = 0, duration = 0;
+    uint32_t bucket = 0;
+    JSValue ret_val;
+
+    start = nstats_time_now();
+    if(fn->cproto == JS_CFUNC_generic_magic) {
+        ret_val = fn->cfunc.generic_magic(ctx, this_val, argc, argv, fn->magic);
+    } else {
+        ret_val = fn->cfunc.generic(ctx, this_val, argc, argv);
+    }
+    duration = nstats_time_now() - start;
+    bucket = nstats_bucket(duration);
+
+    if(!(cnt = nt->counters[magic])) {
+        switch_zmalloc(cnt, sizeof(nstats_counter_t));
+        __atomic_store_n(&nt->counters[magic], cnt, __ATOMIC_RELEASE);
+    }
+
+    /* the only writer is this thread, relaxed stores are enough for the readers */
+    __atomic_store_n(&cnt->calls, cnt->calls + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&cnt->time_total, cnt->time_total + duration, __ATOMIC_RELAXED);
+    __atomic_store_n(&cnt->hist[bucket], cnt->hist[bucket] + 1, __ATOMIC_RELAXED);
+    if(duration > cnt->time_max) {
+        __atomic_store_n(&cnt->time_max, duration, __ATOMIC_RELAXED);
+    }
+    if(JS_IsException(ret_val)) {
+        __atomic_store_n(&cnt->errors, cnt->errors + 1, __ATOMIC_RELAXED);
+    }
+
+    if(globals.cfg_native_slow_call && duration >= globals.cfg_native_slow_call) {
+        nstats_slow_call_log(ctx, fn, duration, JS_IsException(ret_val));
+    }
+
+    return ret_val;
+}
+
+/* returns the function index or -1 */
+static int nstats_func_lookup(const char *class_name, const JSCFunctionListEntry *fe) {
+    char name[NSTATS_NAME_MAX] = { 0 };
+    nstats_func_t *fn = NULL;
+    intptr_t idx = 0;
+
+    switch_snprintf(name, sizeof(name), "%s.%s", class_name, fe->name);
+
+    switch_mutex_lock(nstats.mutex);
+    if((idx = (intptr_t)switch_core_hash_find(nstats.names, name))) {
+        idx--;
+        goto out;
+    }
+    if(nstats.funcs_count >= NSTATS_FUNCS_MAX) {
+        idx = -1;
+        goto out;
+    }
+
+    idx = nstats.funcs_count;
+    fn = &nstats.funcs[idx];
+    switch_copy_string(fn->name, name, sizeof(fn->name));
+    fn->cproto = fe->u.func.cproto;
+    fn->magic = fe->magic;
+    fn->cfunc = fe->u.func.cfunc;
+
+    switch_core_hash_insert(nstats.names, fn->name, (void *)(idx + 1));
+    __atomic_store_n(&nstats.funcs_count, nstats.funcs_count + 1, __ATOMIC_RELEASE);
+out:
+    switch_mutex_unlock(nstats.mutex);
+    return (int)idx;
+}
+
+typedef struct {
+    uint32_t                idx;
+    uint64_t                calls;
+    uint64_t                errors;
+    uint64_t                time_total;
+    uint64_t                time_max;
+    uint32_t                hist[NSTATS_HIST_BUCKETS];
+} nstats_summary_t;
+
+static int nstats_summary_cmp(const void *a, const void *b) {
+    const nstats_summary_t *x = (const nstats_summary_t *)a, *y = (const nstats_summary_t *)b;
+    return (x->time_total < y->time_total ? 1 : (x->time_total > y->time_total ? -1 : 0));
+}
+
+/* value (us) of the percentile */
+static double nstats_percentile(nstats_summary_t *sm, uint32_t pct) {
+    uint64_t rank = ((sm->calls * pct) + 99) / 100, seen = 0;
+
+    for(uint32_t i = 0; i < NSTATS_HIST_BUCKETS; i++) {
+        seen += sm->hist[i];
+        if(seen >= rank && seen) {
+            return ((double)nstats_bucket_value(i) / 1000.0);
+        }
+    }
+
+    return ((double)sm->time_max / 1000.0);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+switch_status_t nstats_init(switch_memory_pool_t *pool) {
+    memset(&nstats, 0, sizeof(nstats));
+
+    switch_mutex_init(&nstats.mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_core_hash_init(&nstats.names);
+
+    if(pthread_key_create(&nstats.tls_key, nstats_thread_release) != 0) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "pthread_key_create() failed\n");
+        return SWITCH_STATUS_FALSE;
+    }
+
+    nstats.fl_ready = true;
+    return SWITCH_STATUS_SUCCESS;
+}
+
+/**
+ ** should be called after all threads were finished
+ **/
+void nstats_shutdown() {
+    nstats_thread_t *nt = NULL;
+
+    if(!nstats.fl_ready) {
+        return;
+    }
+
+    switch_mutex_lock(nstats.mutex);
+    while((nt = nstats.threads)) {
+        nstats.threads = nt->next;
+        for(uint32_t i = 0; i < NSTATS_FUNCS_MAX; i++) {
+            switch_safe_free(nt->counters[i]);
+        }
+        switch_safe_free(nt);
+    }
+    switch_core_hash_destroy(&nstats.names);
+    nstats.fl_ready = false;
+    switch_mutex_unlock(nstats.mutex);
+
+    pthread_key_delete(nstats.tls_key);
+}
+
+/**
+ ** JS_SetPropertyFunctionList() replacement for the classes,
+ ** with native-stats enabled the methods are defined through the trampoline
+ **/
+void js_set_function_list(JSContext *ctx, JSValueConst obj, const char *class_name, const JSCFunctionListEntry *tab, int len) {
+    if(!globals.cfg_native_stats || !nstats.fl_ready) {
+        JS_SetPropertyFunctionList(ctx, obj, tab, len);
+        return;
+    }
+
+    for(int i = 0; i < len; i++) {
+        const JSCFunctionListEntry *fe = &tab[i];
+        int idx = -1;
+
+        if(fe->def_type == JS_DEF_CFUNC && (fe->u.func.cproto == JS_CFUNC_generic || fe->u.func.cproto == JS_CFUNC_generic_magic)) {
+            idx = nstats_func_lookup(class_name, fe);
+        }
+        if(idx < 0) {
+            JS_SetPropertyFunctionList(ctx, obj, fe, 1);
+            continue;
+        }
+
+        JS_DefinePropertyValueStr(ctx, obj, fe->name, JS_NewCFunctionData(ctx, nstats_trampoline, fe->u.func.length, idx, 0, NULL), fe->prop_flags);
+    }
+}
+
+void nstats_write(switch_stream_handle_t *stream, uint8_t fl_json) {
+    nstats_summary_t *sums = NULL;
+    uint32_t funcs_count = 0, count = 0;
+
+    if(!globals.cfg_native_stats) {
+        stream->write_function(stream, (fl_json ? "[]\n" : "native-stats is disabled\n"));
+        return;
+    }
+
+    funcs_count = __atomic_load_n(&nstats.funcs_count, __ATOMIC_ACQUIRE);
+    if(funcs_count) {
+        switch_zmalloc(sums, sizeof(nstats_summary_t) * funcs_count);
+    }
+
+    switch_mutex_lock(nstats.mutex);
+    for(nstats_thread_t *nt = nstats.threads; nt; nt = nt->next) {
+        for(uint32_t i = 0; i < funcs_count; i++) {
+            nstats_counter_t *cnt = __atomic_load_n(&nt->counters[i], __ATOMIC_ACQUIRE);
+            nstats_summary_t *sm = &sums[i];
+            uint64_t tmax = 0;
+
+            if(!cnt) {
+                continue;
+            }
+            sm->calls += __atomic_load_n(&cnt->calls, __ATOMIC_RELAXED);
+            sm->errors += __atomic_load_n(&cnt->errors, __ATOMIC_RELAXED);
+            sm->time_total += __atomic_load_n(&cnt->time_total, __ATOMIC_RELAXED);
+            tmax = __atomic_load_n(&cnt->time_max, __ATOMIC_RELAXED);
+            if(tmax > sm->time_max) sm->time_max = tmax;
+            for(uint32_t b = 0; b < NSTATS_HIST_BUCKETS; b++) {
+                sm->hist[b] += __atomic_load_n(&cnt->hist[b], __ATOMIC_RELAXED);
+            }
+        }
+    }
+    switch_mutex_unlock(nstats.mutex);
+
+    /* skip the functions which were never called */
+    for(uint32_t i = 0; i < funcs_count; i++) {
+        if(sums[i].calls) {
+            if(count != i) memcpy(&sums[count], &sums[i], sizeof(nstats_summary_t));
+            sums[count++].idx = i;
+        }
+    }
+    if(count) {
+        qsort(sums, count, sizeof(nstats_summary_t), nstats_summary_cmp);
+    }
+
+    if(fl_json) {
+        stream->write_function(stream, "[");
+    } else {
+        stream->write_function(stream, "%-40s %10s %8s %12s %10s %10s %10s %10s %10s\n", "function", "calls", "errors", "total(ms)", "avg(us)", "p50(us)", "p90(us)", "p99(us)", "max(us)");
+    }
+
+    for(uint32_t i = 0; i < count; i++) {
+        nstats_summary_t *sm = &sums[i];
+        double avg = ((double)sm->time_total / (double)sm->calls / 1000.0);
+
+        if(fl_json) {
+            stream->write_function(stream, "%s{\"name\":\"%s\",\"calls\":%"SWITCH_UINT64_T_FMT",\"errors\":%"SWITCH_UINT64_T_FMT",\"total\":%.3f,\"avg\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}",
+                (i ? "," : ""), nstats.funcs[sm->idx].name, sm->calls, sm->errors, (double)sm->time_total / 1000000.0, avg,
+                nstats_percentile(sm, 50), nstats_percentile(sm, 90), nstats_percentile(sm, 99), (double)sm->time_max / 1000.0
+            );
+        } else {
+            stream->write_function(stream, "%-40s %10"SWITCH_UINT64_T_FMT" %8"SWITCH_UINT64_T_FMT" %12.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+                nstats.funcs[sm->idx].name, sm->calls, sm->errors, (double)sm->time_total / 1000000.0, avg,
+                nstats_percentile(sm, 50), nstats_percentile(sm, 90), nstats_percentile(sm, 99), (double)sm->time_max / 1000.0
+            );
+        }
+    }
+
+    if(fl_json) {
+        stream->write_function(stream, "]\n");
+    }
+
+    switch_safe_free(sums);
+}
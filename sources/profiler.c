@@ -0,0 +1,212 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+
+extern globals_t globals;
+
+/**
+ ** sampling profiler (qjs profile id seconds [hz])
+ ** quickjs calls the interrupt handler while it executes js code, the handler takes a sample
+ ** not often than the profiler interval: the stack is taken from the backtrace of a throwaway error
+ ** and is accounted as a folded line (root;caller;callee count) which flamegraph.pl consumes as is
+ ** a script without the profiler pays only for a pointer check in the handler
+ **/
+#define PROFILER_SECONDS_MAX    300
+#define PROFILER_RATE_MAX       10000
+#define PROFILER_DEPTH_MAX      64
+#define PROFILER_STACK_MAX      4096
+
+struct profiler_s {
+    switch_memory_pool_t    *pool;
+    switch_hash_t           *stacks;        // folded stack => uint32_t *count
+    switch_time_t           interval;       // us
+    switch_time_t           next;
+    uint32_t                samples;
+    uint32_t                stacks_count;
+};
+
+/* '    at func (file:line)' => 'func (file)' */
+static uint32_t profiler_frame_fold(char *dst, uint32_t dst_len, const char *line, uint32_t line_len) {
+    const char *name = line, *loc = NULL, *loc_end = NULL, *end = line + line_len;
+    uint32_t len = 0;
+
+    while(name < end && *name == ' ') name++;
+    if(end - name > 3 && !strncmp(name, "at ", 3)) name += 3;
+
+    for(const char *p = name; p < end; p++) {
+        if(*p == '(') { loc = p + 1; break; }
+    }
+    if(loc) {
+        for(loc_end = loc; loc_end < end && *loc_end != ')' && *loc_end != ':'; loc_end++);
+    }
+
+    len = snprintf(dst, dst_len, "%.*s", (int)((loc ? loc - 1 : end) - name), name);
+    while(len && dst[len - 1] == ' ') len--;
+    if(loc && loc_end > loc && len < dst_len) {
+        const char *base = loc;
+        for(const char *p = loc; p < loc_end; p++) {
+            if(*p == '/') base = p + 1;
+        }
+        len += snprintf(dst + len, dst_len - len, " (%.*s)", (int)(loc_end - base), base);
+    }
+    if(len >= dst_len) {
+        len = dst_len - 1;
+    }
+
+    /* ';' separates the frames */
+    for(uint32_t i = 0; i < len; i++) {
+        if(dst[i] == ';') dst[i] = ',';
+    }
+
+    return len;
+}
+
+/* must be called under script->mutex */
+static void profiler_sample_take(script_t *script, profiler_t *prof) {
+    JSContext *ctx = script->ctx;
+    JSValue exc, stack_val;
+    const char *stack = NULL, *lines[PROFILER_DEPTH_MAX] = { 0 };
+    uint32_t line_lens[PROFILER_DEPTH_MAX] = { 0 };
+    char folded[PROFILER_STACK_MAX] = { 0 };
+    uint32_t depth = 0, len = 0;
+    uint32_t *count = NULL;
+
+    JS_ThrowInternalError(ctx, "profiler");
+    exc = JS_GetException(ctx);
+    stack_val = JS_GetPropertyStr(ctx, exc, "stack");
+    stack = (JS_IsString(stack_val) ? JS_ToCString(ctx, stack_val) : NULL);
+
+    if(!zstr(stack)) {
+        for(const char *p = stack; *p && depth < PROFILER_DEPTH_MAX; ) {
+            const char *nl = strchr(p, '\n');
+            uint32_t l = (uint32_t)(nl ? (size_t)(nl - p) : strlen(p));
+
+            if(l) {
+                lines[depth] = p;
+                line_lens[depth] = l;
+                depth++;
+            }
+            if(!nl) break;
+            p = nl + 1;
+        }
+    }
+
+    /* the backtrace starts from the innermost frame */
+    len = snprintf(folded, sizeof(folded), "%s", script->name);
+    for(int i = (int)depth - 1; i >= 0 && len < sizeof(folded) - 2; i--) {
+        folded[len++] = ';';
+        len += profiler_frame_fold(folded + len, sizeof(folded) - len, lines[i], line_lens[i]);
+    }
+    if(!depth && len < sizeof(folded) - 8) {
+        len += snprintf(folded + len, sizeof(folded) - len, ";[native]");
+    }
+
+    if(!(count = switch_core_hash_find(prof->stacks, folded))) {
+        count = switch_core_alloc(prof->pool, sizeof(uint32_t));
+        switch_core_hash_insert(prof->stacks, switch_core_strdup(prof->pool, folded), count);
+        prof->stacks_count++;
+    }
+    (*count)++;
+    prof->samples++;
+
+    JS_FreeCString(ctx, stack);
+    JS_FreeValue(ctx, stack_val);
+    JS_FreeValue(ctx, exc);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+/**
+ ** called from the interrupt handler (script thread)
+ **/
+void profiler_sample(script_t *script) {
+    switch_time_t now = switch_micro_time_now();
+    profiler_t *prof = NULL;
+
+    switch_mutex_lock(script->mutex);
+    if((prof = script->profiler) && script->ctx && now >= prof->next) {
+        prof->next = now + prof->interval;
+        profiler_sample_take(script, prof);
+    }
+    switch_mutex_unlock(script->mutex);
+}
+
+/**
+ ** profiles the script for the specified time (blocks) and writes the folded stacks
+ **/
+void profiler_run(const char *id, uint32_t seconds, uint32_t rate, switch_stream_handle_t *stream) {
+    switch_memory_pool_t *pool = NULL;
+    switch_hash_index_t *hidx = NULL;
+    profiler_t *prof = NULL;
+    script_t *script = NULL;
+    switch_time_t deadline = 0;
+
+    if(!seconds || seconds > PROFILER_SECONDS_MAX) {
+        stream->write_function(stream, "-ERR: invalid duration (1..%u sec)\n", PROFILER_SECONDS_MAX);
+        return;
+    }
+    if(!rate) {
+        rate = globals.cfg_profiler_rate;
+    }
+    if(!rate || rate > PROFILER_RATE_MAX) {
+        stream->write_function(stream, "-ERR: invalid rate (1..%u hz)\n", PROFILER_RATE_MAX);
+        return;
+    }
+
+    if(!(script = registry_lookup(id))) {
+        stream->write_function(stream, "-ERR: not found\n");
+        return;
+    }
+
+    if(switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "switch_core_new_memory_pool()\n");
+        stream->write_function(stream, "-ERR: memory\n");
+        goto out;
+    }
+
+    prof = switch_core_alloc(pool, sizeof(profiler_t));
+    prof->pool = pool;
+    prof->interval = (1000000 / rate);
+    switch_core_hash_init(&prof->stacks);
+
+    switch_mutex_lock(script->mutex);
+    if(script->profiler) {
+        switch_mutex_unlock(script->mutex);
+        stream->write_function(stream, "-ERR: already profiled\n");
+        goto out;
+    }
+    script->profiler = prof;
+    switch_mutex_unlock(script->mutex);
+
+    /* the script can't be destroyed while it's pinned, so check it often to not hold it */
+    deadline = switch_micro_time_now() + ((switch_time_t)seconds * 1000000);
+    while(switch_micro_time_now() < deadline && !script->fl_destroyed && !globals.fl_shutdown) {
+        switch_yield(100000);
+    }
+
+    switch_mutex_lock(script->mutex);
+    script->profiler = NULL;
+    switch_mutex_unlock(script->mutex);
+
+    for(hidx = switch_core_hash_first_iter(prof->stacks, hidx); hidx; hidx = switch_core_hash_next(&hidx)) {
+        const void *hkey = NULL;
+        void *hval = NULL;
+
+        switch_core_hash_this(hidx, &hkey, NULL, &hval);
+        stream->write_function(stream, "%s %u\n", (const char *)hkey, *(uint32_t *)hval);
+    }
+    switch_safe_free(hidx);
+
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Profiler finished (%s): samples: %u, stacks: %u\n", script->name, prof->samples, prof->stacks_count);
+out:
+    script_sem_release(script);
+    if(prof) {
+        switch_core_hash_destroy(&prof->stacks);
+    }
+    if(pool) {
+        switch_core_destroy_memory_pool(&pool);
+    }
+}
@@ -0,0 +1,526 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+
+extern globals_t globals;
+
+/**
+ ** the registry is an immutable snapshot (entries + hash indexes) plus a short chain of the entries added after it,
+ ** add/remove only touch a single entry (O(1)) and never wait for the readers,
+ ** the background thread folds the chain and the removed entries into a new snapshot and frees the retired memory
+ ** once the readers of both epochs are gone.
+ ** readers don't take any locks: they only mark themselves in the current epoch counter,
+ ** an entry is pinned (pins) while its script sem is being taken, so remove only waits for those few instructions
+ **/
+#define REGISTRY_REBUILD_INTERVAL_US    50000
+
+typedef struct registry_entry_s {
+    script_t                *script;
+    char                    *id;
+    char                    *name;
+    char                    *session_id;
+    char                    **tags;
+    uint32_t                tags_count;
+    uint32_t                pins;
+    uint8_t                 fl_removed;
+    uint64_t                seq;
+    struct registry_entry_s *next;          // chain of the entries which aren't in the snapshot yet (newest first)
+    struct registry_entry_s *next_retired;
+} registry_entry_t;
+
+typedef struct {
+    const char              *key;
+    registry_entry_t        *entry;
+} registry_slot_t;
+
+typedef struct {
+    uint32_t                mask;
+    registry_slot_t         *slots;
+} registry_index_t;
+
+typedef struct {
+    uint32_t                count;
+    uint64_t                folded_seq;     // the chain entries with seq <= folded_seq are in the snapshot
+    registry_entry_t        **entries;
+    registry_index_t        index[REGISTRY_INDEX_MAX];
+} registry_snapshot_t;
+
+static struct {
+    switch_mutex_t          *mutex;         // writers only
+    registry_snapshot_t     *current;
+    registry_entry_t        *chain;
+    registry_entry_t        *retired;
+    uint64_t                seq;
+    uint32_t                dirty;
+    uint32_t                epoch;
+    uint32_t                readers[2];
+    uint8_t                 fl_thread;
+} registry;
+
+static uint32_t registry_hash(const char *key) {
+    uint32_t h = 2166136261U;
+
+    for(const char *p = key; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619U;
+    }
+
+    return h;
+}
+
+static registry_entry_t *registry_entry_create(script_t *script) {
+    registry_entry_t *entry = NULL;
+
+    switch_zmalloc(entry, sizeof(registry_entry_t));
+
+    entry->script = script;
+    entry->id = strdup(script->id);
+    entry->name = (script->name ? strdup(script->name) : NULL);
+    entry->session_id = (script->session_id ? strdup(script->session_id) : NULL);
+
+    if(script->tags_count) {
+        switch_malloc(entry->tags, sizeof(char *) * script->tags_count);
+        for(uint32_t i = 0; i < script->tags_count; i++) {
+            entry->tags[entry->tags_count++] = strdup(script->tags[i]);
+        }
+    }
+
+    return entry;
+}
+
+static void registry_entry_free(registry_entry_t *entry) {
+    if(!entry) {
+        return;
+    }
+    for(uint32_t i = 0; i < entry->tags_count; i++) {
+        switch_safe_free(entry->tags[i]);
+    }
+    switch_safe_free(entry->tags);
+    switch_safe_free(entry->session_id);
+    switch_safe_free(entry->name);
+    switch_safe_free(entry->id);
+    switch_safe_free(entry);
+}
+
+static uint8_t registry_entry_match(registry_entry_t *entry, uint8_t index, const char *key) {
+    switch(index) {
+        case REGISTRY_INDEX_ID:
+            return !strcmp(entry->id, key);
+        case REGISTRY_INDEX_NAME:
+            return (entry->name && !strcmp(entry->name, key));
+        case REGISTRY_INDEX_SESSION:
+            return (entry->session_id && !strcmp(entry->session_id, key));
+        case REGISTRY_INDEX_TAG:
+            for(uint32_t i = 0; i < entry->tags_count; i++) {
+                if(!strcmp(entry->tags[i], key)) {
+                    return true;
+                }
+            }
+            return false;
+    }
+    return (index == REGISTRY_INDEX_ALL);
+}
+
+/* takes the script sem unless the entry was removed, registry_remove() waits for the pins */
+static uint8_t registry_entry_pin(registry_entry_t *entry) {
+    uint8_t ok = false;
+
+    __atomic_add_fetch(&entry->pins, 1, __ATOMIC_SEQ_CST);
+    if(!__atomic_load_n(&entry->fl_removed, __ATOMIC_SEQ_CST)) {
+        ok = script_sem_take(entry->script);
+    }
+    __atomic_sub_fetch(&entry->pins, 1, __ATOMIC_SEQ_CST);
+
+    return ok;
+}
+
+static void registry_index_add(registry_index_t *idx, const char *key, registry_entry_t *entry) {
+    uint32_t i = 0;
+
+    if(zstr(key)) {
+        return;
+    }
+    for(i = registry_hash(key) & idx->mask; idx->slots[i].key; i = (i + 1) & idx->mask);
+
+    idx->slots[i].key = key;
+    idx->slots[i].entry = entry;
+}
+
+static uint32_t registry_index_size(uint32_t entries) {
+    uint32_t size = 8;
+
+    while(size < entries * 2) {
+        size <<= 1;
+    }
+
+    return size;
+}
+
+static void registry_snapshot_free(registry_snapshot_t *snap) {
+    if(!snap) {
+        return;
+    }
+    for(int i = 0; i < REGISTRY_INDEX_MAX; i++) {
+        switch_safe_free(snap->index[i].slots);
+    }
+    switch_safe_free(snap->entries);
+    switch_safe_free(snap);
+}
+
+/* old snapshot + the chain entries (up to head) - the removed ones */
+static registry_snapshot_t *registry_snapshot_create(registry_snapshot_t *old, registry_entry_t *head) {
+    registry_snapshot_t *snap = NULL;
+    uint32_t entries[REGISTRY_INDEX_MAX] = { 0 };
+    uint32_t size = 0;
+
+    switch_zmalloc(snap, sizeof(registry_snapshot_t));
+
+    snap->folded_seq = (head ? head->seq : (old ? old->folded_seq : 0));
+
+    size = (old ? old->count : 0);
+    for(registry_entry_t *e = head; e && (!old || e->seq > old->folded_seq); e = e->next) {
+        size++;
+    }
+    if(size) {
+        switch_malloc(snap->entries, sizeof(registry_entry_t *) * size);
+    }
+
+    for(uint32_t i = 0; old && i < old->count; i++) {
+        if(!__atomic_load_n(&old->entries[i]->fl_removed, __ATOMIC_SEQ_CST)) {
+            snap->entries[snap->count++] = old->entries[i];
+        }
+    }
+    for(registry_entry_t *e = head; e && (!old || e->seq > old->folded_seq); e = e->next) {
+        if(!__atomic_load_n(&e->fl_removed, __ATOMIC_SEQ_CST)) {
+            snap->entries[snap->count++] = e;
+        }
+    }
+
+    for(uint32_t i = 0; i < snap->count; i++) {
+        entries[REGISTRY_INDEX_ID]++;
+        entries[REGISTRY_INDEX_NAME]++;
+        entries[REGISTRY_INDEX_SESSION] += (snap->entries[i]->session_id ? 1 : 0);
+        entries[REGISTRY_INDEX_TAG] += snap->entries[i]->tags_count;
+    }
+
+    for(int i = 0; i < REGISTRY_INDEX_MAX; i++) {
+        uint32_t isize = registry_index_size(entries[i]);
+
+        snap->index[i].mask = (isize - 1);
+        switch_zmalloc(snap->index[i].slots, sizeof(registry_slot_t) * isize);
+    }
+
+    for(uint32_t i = 0; i < snap->count; i++) {
+        registry_entry_t *entry = snap->entries[i];
+
+        registry_index_add(&snap->index[REGISTRY_INDEX_ID], entry->id, entry);
+        registry_index_add(&snap->index[REGISTRY_INDEX_NAME], entry->name, entry);
+        registry_index_add(&snap->index[REGISTRY_INDEX_SESSION], entry->session_id, entry);
+        for(uint32_t t = 0; t < entry->tags_count; t++) {
+            registry_index_add(&snap->index[REGISTRY_INDEX_TAG], entry->tags[t], entry);
+        }
+    }
+
+    return snap;
+}
+
+static uint32_t registry_read_lock() {
+    uint32_t epoch = __atomic_load_n(&registry.epoch, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&registry.readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+    return epoch;
+}
+
+static void registry_read_unlock(uint32_t epoch) {
+    __atomic_sub_fetch(&registry.readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+}
+
+/* waits until the readers which could see the previous state are gone, called only by the rebuilder (or at shutdown) */
+static void registry_synchronize() {
+    for(int phase = 0; phase < 2; phase++) {
+        uint32_t epoch = __atomic_fetch_add(&registry.epoch, 1, __ATOMIC_SEQ_CST);
+
+        while(__atomic_load_n(&registry.readers[epoch & 1], __ATOMIC_SEQ_CST)) {
+            switch_os_yield();
+        }
+    }
+}
+
+/**
+ ** the snapshot is built without the writer mutex, so launches and exits go on meanwhile,
+ ** the entries removed during the build are still flagged and will be dropped by the next rebuild
+ **/
+static void registry_rebuild() {
+    registry_snapshot_t *old = NULL, *snap = NULL;
+    registry_entry_t *head = NULL, *retired = NULL, *e = NULL;
+
+    switch_mutex_lock(registry.mutex);
+    if(!registry.dirty || !registry.current) {
+        switch_mutex_unlock(registry.mutex);
+        return;
+    }
+    old = registry.current;
+    head = registry.chain;
+    retired = registry.retired;
+    registry.retired = NULL;
+    registry.dirty = 0;
+    switch_mutex_unlock(registry.mutex);
+
+    snap = registry_snapshot_create(old, head);
+    __atomic_store_n(&registry.current, snap, __ATOMIC_SEQ_CST);
+
+    /* nobody reads the old snapshot after that, the new readers stop at folded_seq */
+    registry_synchronize();
+
+    switch_mutex_lock(registry.mutex);
+    if(registry.chain && registry.chain->seq <= snap->folded_seq) {
+        __atomic_store_n(&registry.chain, NULL, __ATOMIC_SEQ_CST);
+    } else {
+        for(e = registry.chain; e && e->next; e = e->next) {
+            if(e->next->seq <= snap->folded_seq) {
+                __atomic_store_n(&e->next, NULL, __ATOMIC_SEQ_CST);
+                break;
+            }
+        }
+    }
+    switch_mutex_unlock(registry.mutex);
+
+    /* and the retired entries are unreachable from the chain */
+    registry_synchronize();
+
+    registry_snapshot_free(old);
+    while(retired) {
+        e = retired; retired = retired->next_retired;
+        registry_entry_free(e);
+    }
+}
+
+static void *SWITCH_THREAD_FUNC registry_thread(switch_thread_t *thread, void *obj) {
+
+    while(!globals.fl_shutdown) {
+        registry_rebuild();
+        switch_yield(REGISTRY_REBUILD_INTERVAL_US);
+    }
+
+    __atomic_store_n(&registry.fl_thread, false, __ATOMIC_SEQ_CST);
+    thread_finished();
+    return NULL;
+}
+
+/* must be called under registry.mutex */
+static registry_entry_t *registry_entry_find(script_t *script) {
+    registry_snapshot_t *snap = NULL;
+    registry_entry_t *entry = NULL;
+    registry_index_t *idx = NULL;
+    uint32_t epoch = 0;
+
+    epoch = registry_read_lock();
+    snap = __atomic_load_n(&registry.current, __ATOMIC_SEQ_CST);
+
+    for(registry_entry_t *e = registry.chain; e && e->seq > snap->folded_seq; e = e->next) {
+        if(e->script == script && !e->fl_removed) {
+            entry = e;
+            goto out;
+        }
+    }
+
+    idx = &snap->index[REGISTRY_INDEX_ID];
+    for(uint32_t i = registry_hash(script->id) & idx->mask; idx->slots[i].key; i = (i + 1) & idx->mask) {
+        if(idx->slots[i].entry->script == script && !idx->slots[i].entry->fl_removed) {
+            entry = idx->slots[i].entry;
+            goto out;
+        }
+    }
+
+out:
+    registry_read_unlock(epoch);
+    return entry;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+switch_status_t registry_init(switch_memory_pool_t *pool) {
+    memset(&registry, 0, sizeof(registry));
+
+    switch_mutex_init(&registry.mutex, SWITCH_MUTEX_NESTED, pool);
+    registry.current = registry_snapshot_create(NULL, NULL);
+
+    registry.fl_thread = true;
+    launch_thread(pool, registry_thread, NULL);
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+/**
+ ** should be called after all scripts were finished
+ **/
+void registry_shutdown() {
+    registry_snapshot_t *snap = NULL;
+    registry_entry_t *chain = NULL, *retired = NULL, *e = NULL;
+
+    while(__atomic_load_n(&registry.fl_thread, __ATOMIC_SEQ_CST)) {
+        switch_yield(10000);
+    }
+
+    switch_mutex_lock(registry.mutex);
+    snap = registry.current;
+    chain = registry.chain;
+    retired = registry.retired;
+    __atomic_store_n(&registry.current, NULL, __ATOMIC_SEQ_CST);
+    registry.chain = NULL;
+    registry.retired = NULL;
+    switch_mutex_unlock(registry.mutex);
+
+    registry_synchronize();
+
+    /* each entry is either in the snapshot, or in the chain (above folded_seq), or retired */
+    for(e = chain; e && (!snap || e->seq > snap->folded_seq); e = chain) {
+        chain = e->next;
+        if(!e->fl_removed) registry_entry_free(e);
+    }
+    for(uint32_t i = 0; snap && i < snap->count; i++) {
+        if(!snap->entries[i]->fl_removed) registry_entry_free(snap->entries[i]);
+    }
+    while(retired) {
+        e = retired; retired = retired->next_retired;
+        registry_entry_free(e);
+    }
+    registry_snapshot_free(snap);
+}
+
+switch_status_t registry_add(script_t *script) {
+    registry_entry_t *entry = NULL;
+
+    entry = registry_entry_create(script);
+
+    switch_mutex_lock(registry.mutex);
+    if(!registry.current) {
+        switch_mutex_unlock(registry.mutex);
+        registry_entry_free(entry);
+        return SWITCH_STATUS_FALSE;
+    }
+    entry->seq = ++registry.seq;
+    entry->next = registry.chain;
+    __atomic_store_n(&registry.chain, entry, __ATOMIC_SEQ_CST);
+    registry.dirty++;
+    switch_mutex_unlock(registry.mutex);
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+/**
+ ** when it returns no reader holds the script anymore (except the ones which took the sem)
+ ** the entry itself is freed later by the rebuilder
+ **/
+void registry_remove(script_t *script) {
+    registry_entry_t *entry = NULL;
+
+    switch_mutex_lock(registry.mutex);
+    if(registry.current && (entry = registry_entry_find(script))) {
+        __atomic_store_n(&entry->fl_removed, true, __ATOMIC_SEQ_CST);
+        while(__atomic_load_n(&entry->pins, __ATOMIC_SEQ_CST)) {
+            switch_os_yield();
+        }
+        entry->next_retired = registry.retired;
+        registry.retired = entry;
+        registry.dirty++;
+    }
+    switch_mutex_unlock(registry.mutex);
+}
+
+/**
+ ** returns the script with the taken sem (script_sem_release() is required) or NULL
+ **/
+script_t *registry_lookup(const char *id) {
+    registry_snapshot_t *snap = NULL;
+    script_t *script = NULL;
+    uint32_t epoch = 0;
+
+    if(zstr(id)) {
+        return NULL;
+    }
+
+    epoch = registry_read_lock();
+    if((snap = __atomic_load_n(&registry.current, __ATOMIC_SEQ_CST))) {
+        registry_index_t *idx = &snap->index[REGISTRY_INDEX_ID];
+
+        for(uint32_t i = registry_hash(id) & idx->mask; idx->slots[i].key; i = (i + 1) & idx->mask) {
+            if(!strcmp(idx->slots[i].key, id) && registry_entry_pin(idx->slots[i].entry)) {
+                script = idx->slots[i].entry->script;
+                goto out;
+            }
+        }
+
+        for(registry_entry_t *e = __atomic_load_n(&registry.chain, __ATOMIC_SEQ_CST); e && e->seq > snap->folded_seq; e = __atomic_load_n(&e->next, __ATOMIC_SEQ_CST)) {
+            if(!strcmp(e->id, id) && registry_entry_pin(e)) {
+                script = e->script;
+                goto out;
+            }
+        }
+    }
+out:
+    registry_read_unlock(epoch);
+
+    return script;
+}
+
+/**
+ ** calls func for each script matched by the index key (REGISTRY_INDEX_ALL - all scripts)
+ ** the scripts are pinned (sem) while func is called, no registry locks are held at that moment
+ **/
+uint32_t registry_foreach(uint8_t index, const char *key, registry_foreach_func_t *func, void *udata) {
+    registry_snapshot_t *snap = NULL;
+    registry_entry_t *chain = NULL;
+    script_t **pinned = NULL;
+    uint32_t count = 0, size = 0, epoch = 0;
+
+    if(index != REGISTRY_INDEX_ALL && (index >= REGISTRY_INDEX_MAX || zstr(key))) {
+        return 0;
+    }
+
+    epoch = registry_read_lock();
+    if((snap = __atomic_load_n(&registry.current, __ATOMIC_SEQ_CST))) {
+        chain = __atomic_load_n(&registry.chain, __ATOMIC_SEQ_CST);
+
+        size = snap->count;
+        for(registry_entry_t *e = chain; e && e->seq > snap->folded_seq; e = __atomic_load_n(&e->next, __ATOMIC_SEQ_CST)) {
+            size++;
+        }
+        if(size) {
+            switch_malloc(pinned, sizeof(script_t *) * size);
+        }
+
+        if(index == REGISTRY_INDEX_ALL) {
+            for(uint32_t i = 0; i < snap->count; i++) {
+                if(registry_entry_pin(snap->entries[i])) {
+                    pinned[count++] = snap->entries[i]->script;
+                }
+            }
+        } else if(snap->count) {
+            registry_index_t *idx = &snap->index[index];
+
+            for(uint32_t i = registry_hash(key) & idx->mask; idx->slots[i].key; i = (i + 1) & idx->mask) {
+                if(count < size && !strcmp(idx->slots[i].key, key) && registry_entry_pin(idx->slots[i].entry)) {
+                    pinned[count++] = idx->slots[i].entry->script;
+                }
+            }
+        }
+
+        /* the chain walk stops at the same entry as the size count above (the cut is published after a grace period) */
+        for(registry_entry_t *e = chain; e && e->seq > snap->folded_seq && count < size; e = __atomic_load_n(&e->next, __ATOMIC_SEQ_CST)) {
+            if(registry_entry_match(e, index, key) && registry_entry_pin(e)) {
+                pinned[count++] = e->script;
+            }
+        }
+    }
+    registry_read_unlock(epoch);
+
+    for(uint32_t i = 0; i < count; i++) {
+        func(pinned[i], udata);
+        script_sem_release(pinned[i]);
+    }
+
+    switch_safe_free(pinned);
+    return count;
+}
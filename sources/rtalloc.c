@@ -0,0 +1,239 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+
+extern globals_t globals;
+
+/**
+ ** per runtime arena allocator (JS_NewRuntime2)
+ ** a runtime is used by one thread at the time, so there are no locks at all:
+ ** small blocks are cut from the arena chunks and go to the per size class free lists on free,
+ ** large ones are taken from the system; chunks are released in bulk when the runtime is destroyed
+ **/
+#define RTALLOC_CHUNK_SIZE      (64 * 1024)
+#define RTALLOC_CLASS_STEP      16
+#define RTALLOC_CLASSES         64
+#define RTALLOC_SMALL_MAX       (RTALLOC_CLASS_STEP * RTALLOC_CLASSES)
+#define RTALLOC_OVERHEAD        8       // accounted per block (as the default allocator does)
+
+typedef struct {
+    size_t                  size;       // usable size
+} rtalloc_hdr_t;
+
+typedef struct rtalloc_chunk_s {
+    struct rtalloc_chunk_s  *next;
+    size_t                  reserved;
+} rtalloc_chunk_t;
+
+struct rtalloc_s {
+    rtalloc_chunk_t         *chunks;
+    uint8_t                 *pos;
+    uint8_t                 *end;
+    rtalloc_hdr_t           *free_list[RTALLOC_CLASSES];
+    rtalloc_stats_t         stats;
+};
+
+#define RTALLOC_HDR(ptr)        (((rtalloc_hdr_t *)(ptr)) - 1)
+#define RTALLOC_IS_SMALL(hdr)   ((hdr)->size <= (RTALLOC_SMALL_MAX - sizeof(rtalloc_hdr_t)))
+#define RTALLOC_CLASS(bsize)    (((bsize) / RTALLOC_CLASS_STEP) - 1)
+
+static uint8_t rtalloc_chunk_new(rtalloc_t *a) {
+    rtalloc_chunk_t *chunk = malloc(RTALLOC_CHUNK_SIZE);
+
+    if(!chunk) {
+        return false;
+    }
+
+    chunk->next = a->chunks;
+    a->chunks = chunk;
+    a->pos = (uint8_t *)(chunk + 1);
+    a->end = (uint8_t *)chunk + RTALLOC_CHUNK_SIZE;
+    a->stats.arena_size += RTALLOC_CHUNK_SIZE;
+
+    return true;
+}
+
+static void *rtalloc_malloc(JSMallocState *s, size_t size) {
+    rtalloc_t *a = (rtalloc_t *)s->opaque;
+    rtalloc_hdr_t *hdr = NULL;
+    size_t bsize = 0;
+
+    if(s->malloc_size + size > s->malloc_limit) {
+        return NULL;
+    }
+
+    bsize = (size + sizeof(rtalloc_hdr_t) + (RTALLOC_CLASS_STEP - 1)) & ~(RTALLOC_CLASS_STEP - 1);
+    if(bsize <= RTALLOC_SMALL_MAX) {
+        uint32_t cls = RTALLOC_CLASS(bsize);
+
+        if((hdr = a->free_list[cls])) {
+            a->free_list[cls] = *(rtalloc_hdr_t **)(hdr + 1);
+        } else {
+            if((a->pos + bsize) > a->end && !rtalloc_chunk_new(a)) {
+                return NULL;
+            }
+            hdr = (rtalloc_hdr_t *)a->pos;
+            a->pos += bsize;
+        }
+        hdr->size = bsize - sizeof(rtalloc_hdr_t);
+    } else {
+        if(!(hdr = malloc(size + sizeof(rtalloc_hdr_t)))) {
+            return NULL;
+        }
+        hdr->size = size;
+        a->stats.large_allocs++;
+        a->stats.large_size += size;
+    }
+
+    a->stats.allocs++;
+    a->stats.used_size += hdr->size;
+    s->malloc_count++;
+    s->malloc_size += hdr->size + RTALLOC_OVERHEAD;
+
+    return (hdr + 1);
+}
+
+static void rtalloc_free(JSMallocState *s, void *ptr) {
+    rtalloc_t *a = (rtalloc_t *)s->opaque;
+    rtalloc_hdr_t *hdr = NULL;
+
+    if(!ptr) {
+        return;
+    }
+
+    hdr = RTALLOC_HDR(ptr);
+    a->stats.frees++;
+    a->stats.used_size -= hdr->size;
+    s->malloc_count--;
+    s->malloc_size -= hdr->size + RTALLOC_OVERHEAD;
+
+    if(RTALLOC_IS_SMALL(hdr)) {
+        uint32_t cls = RTALLOC_CLASS(hdr->size + sizeof(rtalloc_hdr_t));
+
+        *(rtalloc_hdr_t **)ptr = a->free_list[cls];
+        a->free_list[cls] = hdr;
+    } else {
+        a->stats.large_size -= hdr->size;
+        free(hdr);
+    }
+}
+
+static void *rtalloc_realloc(JSMallocState *s, void *ptr, size_t size) {
+    rtalloc_t *a = (rtalloc_t *)s->opaque;
+    rtalloc_hdr_t *hdr = NULL;
+    void *nptr = NULL;
+    size_t old_size = 0;
+
+    if(!ptr) {
+        return (size ? rtalloc_malloc(s, size) : NULL);
+    }
+    if(!size) {
+        rtalloc_free(s, ptr);
+        return NULL;
+    }
+
+    hdr = RTALLOC_HDR(ptr);
+    old_size = hdr->size;
+
+    if(RTALLOC_IS_SMALL(hdr)) {
+        if(size <= old_size) {
+            return ptr;
+        }
+    } else if((size + sizeof(rtalloc_hdr_t)) > RTALLOC_SMALL_MAX) {
+        /* large to large */
+        if(s->malloc_size + size - old_size > s->malloc_limit) {
+            return NULL;
+        }
+        if(!(hdr = realloc(hdr, size + sizeof(rtalloc_hdr_t)))) {
+            return NULL;
+        }
+        hdr->size = size;
+        a->stats.large_size += size - old_size;
+        a->stats.used_size += size - old_size;
+        s->malloc_size += size - old_size;
+        return (hdr + 1);
+    }
+
+    if(!(nptr = rtalloc_malloc(s, size))) {
+        return NULL;
+    }
+    memcpy(nptr, ptr, (old_size < size ? old_size : size));
+    rtalloc_free(s, ptr);
+
+    return nptr;
+}
+
+static size_t rtalloc_usable_size(const void *ptr) {
+    return (ptr ? RTALLOC_HDR(ptr)->size : 0);
+}
+
+static const JSMallocFunctions rtalloc_mf = {
+    rtalloc_malloc,
+    rtalloc_free,
+    rtalloc_realloc,
+    rtalloc_usable_size
+};
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+/**
+ ** creates a runtime with its own arena (alloc gets the arena)
+ **/
+JSRuntime *rtalloc_runtime_new(rtalloc_t **alloc) {
+    JSRuntime *rt = NULL;
+    rtalloc_t *a = NULL;
+
+    switch_zmalloc(a, sizeof(rtalloc_t));
+
+    if(!(rt = JS_NewRuntime2(&rtalloc_mf, a))) {
+        rtalloc_destroy(a);
+        return NULL;
+    }
+
+    *alloc = a;
+    return rt;
+}
+
+/**
+ ** releases all chunks at once, must be called after JS_FreeRuntime()
+ **/
+void rtalloc_destroy(rtalloc_t *alloc) {
+    rtalloc_chunk_t *chunk = NULL;
+
+    if(!alloc) {
+        return;
+    }
+
+    while(alloc->chunks) {
+        chunk = alloc->chunks;
+        alloc->chunks = chunk->next;
+        free(chunk);
+    }
+
+    switch_safe_free(alloc);
+}
+
+void rtalloc_stats_get(rtalloc_t *alloc, rtalloc_stats_t *stats) {
+    if(alloc) {
+        memcpy(stats, &alloc->stats, sizeof(rtalloc_stats_t));
+    } else {
+        memset(stats, 0, sizeof(rtalloc_stats_t));
+    }
+}
+
+/**
+ ** memory in use by the runtime objects
+ **/
+size_t rtalloc_used_size(rtalloc_t *alloc) {
+    return (alloc ? alloc->stats.used_size : 0);
+}
+
+/**
+ ** memory held by the runtime (arena chunks and large blocks)
+ **/
+size_t rtalloc_footprint(rtalloc_t *alloc) {
+    return (alloc ? (alloc->stats.arena_size + alloc->stats.large_size) : 0);
+}
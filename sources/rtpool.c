@@ -0,0 +1,287 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+#include "js_sharedmem.h"
+
+extern globals_t globals;
+
+static struct {
+    switch_mutex_t          *mutex;
+    js_runtime_t            *idle;
+    uint32_t                idle_count;
+    uint32_t                active_count;
+    uint64_t                created;
+    uint64_t                reused;
+    uint64_t                discarded;
+} rtpool;
+
+static js_runtime_t *rtpool_runtime_create() {
+    js_runtime_t *jsrt = NULL;
+
+    switch_zmalloc(jsrt, sizeof(js_runtime_t));
+
+    if(globals.cfg_rt_arena) {
+        jsrt->rt = rtalloc_runtime_new(&jsrt->alloc);
+    } else {
+        jsrt->rt = JS_NewRuntime();
+    }
+    if(!jsrt->rt) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to create runtime (jsRuntime)\n");
+        goto fail;
+    }
+
+    if(globals.cfg_rt_mem_limit) {
+        JS_SetMemoryLimit(jsrt->rt, globals.cfg_rt_mem_limit);
+    }
+    if(globals.cfg_rt_stk_size) {
+        JS_SetMaxStackSize(jsrt->rt, globals.cfg_rt_stk_size);
+    }
+
+    JS_SetModuleLoaderFunc(jsrt->rt, NULL, xxx_module_loader, NULL);
+    JS_SetCanBlock(jsrt->rt, 1);
+    js_sharedmem_runtime_setup(jsrt->rt);
+    JS_SetRuntimeOpaque(jsrt->rt, jsrt);
+    JS_SetInterruptHandler(jsrt->rt, script_interrupt_handler, jsrt);
+
+    if(!(jsrt->ctx = js_builtins_ctx_create(jsrt->rt))) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to create context (jsCtx)\n");
+        goto fail;
+    }
+
+    switch_mutex_lock(rtpool.mutex);
+    rtpool.created++;
+    switch_mutex_unlock(rtpool.mutex);
+
+    return jsrt;
+fail:
+    if(jsrt->rt) {
+        JS_FreeRuntime(jsrt->rt);
+    }
+    rtalloc_destroy(jsrt->alloc);
+    switch_safe_free(jsrt);
+    return NULL;
+}
+
+static void rtpool_runtime_destroy(js_runtime_t *jsrt) {
+    if(!jsrt) {
+        return;
+    }
+    if(jsrt->ctx) {
+        JS_FreeContext(jsrt->ctx);
+    }
+    if(jsrt->rt) {
+        JS_FreeRuntime(jsrt->rt);
+    }
+    rtalloc_destroy(jsrt->alloc);
+    switch_safe_free(jsrt);
+}
+
+/* must be called under rtpool.mutex */
+static void rtpool_reap(js_runtime_t **reaped) {
+    js_runtime_t *t = NULL, *prev = NULL, *next = NULL;
+    switch_time_t now = switch_micro_time_now();
+    switch_time_t timeout = ((switch_time_t)globals.cfg_rtpool_idle_timeout * 1000000);
+
+    if(!globals.cfg_rtpool_idle_timeout || rtpool.idle_count <= globals.cfg_rtpool_min) {
+        return;
+    }
+
+    for(t = rtpool.idle; t; t = next) {
+        next = t->next;
+        if(rtpool.idle_count > globals.cfg_rtpool_min && (now - t->idle_since) > timeout) {
+            if(prev) { prev->next = next; } else { rtpool.idle = next; }
+            rtpool.idle_count--;
+            t->next = *reaped;
+            *reaped = t;
+            continue;
+        }
+        prev = t;
+    }
+}
+
+static void rtpool_destroy_list(js_runtime_t *list) {
+    js_runtime_t *t = NULL;
+
+    while(list) {
+        t = list; list = list->next;
+        rtpool_runtime_destroy(t);
+    }
+}
+
+/* frees the idle runtimes (above rt-pool-min) when there is no traffic to do it in take/release */
+static void *SWITCH_THREAD_FUNC rtpool_reaper_thread(switch_thread_t *thread, void *obj) {
+    js_runtime_t *reaped = NULL;
+    switch_time_t next_time = 0;
+
+    next_time = switch_micro_time_now() + 1000000;
+    while(!globals.fl_shutdown) {
+        if(switch_micro_time_now() < next_time) {
+            switch_yield(250000);
+            continue;
+        }
+
+        switch_mutex_lock(rtpool.mutex);
+        rtpool_reap(&reaped);
+        switch_mutex_unlock(rtpool.mutex);
+
+        rtpool_destroy_list(reaped);
+        reaped = NULL;
+
+        next_time = switch_micro_time_now() + 1000000;
+    }
+
+    thread_finished();
+    return NULL;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+switch_status_t rtpool_init(switch_memory_pool_t *pool) {
+    js_runtime_t *jsrt = NULL;
+
+    memset(&rtpool, 0, sizeof(rtpool));
+    switch_mutex_init(&rtpool.mutex, SWITCH_MUTEX_NESTED, pool);
+
+    for(uint32_t i = 0; i < globals.cfg_rtpool_min; i++) {
+        if(!(jsrt = rtpool_runtime_create())) {
+            break;
+        }
+        jsrt->idle_since = switch_micro_time_now();
+        jsrt->next = rtpool.idle;
+        rtpool.idle = jsrt;
+        rtpool.idle_count++;
+    }
+
+    if(globals.cfg_rtpool_idle_timeout && globals.cfg_rtpool_max > globals.cfg_rtpool_min) {
+        launch_thread(pool, rtpool_reaper_thread, NULL);
+    }
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+void rtpool_shutdown() {
+    js_runtime_t *list = NULL;
+
+    switch_mutex_lock(rtpool.mutex);
+    list = rtpool.idle;
+    rtpool.idle = NULL;
+    rtpool.idle_count = 0;
+    switch_mutex_unlock(rtpool.mutex);
+
+    rtpool_destroy_list(list);
+}
+
+/**
+ ** returns a runtime with a fresh context
+ ** the caller has to bind it to the script and update the stack top
+ **/
+js_runtime_t *rtpool_take() {
+    js_runtime_t *jsrt = NULL, *reaped = NULL;
+
+    switch_mutex_lock(rtpool.mutex);
+    if(rtpool.idle) {
+        jsrt = rtpool.idle;
+        rtpool.idle = jsrt->next;
+        rtpool.idle_count--;
+        rtpool.reused++;
+    }
+    rtpool_reap(&reaped);
+    rtpool.active_count++;
+    switch_mutex_unlock(rtpool.mutex);
+
+    rtpool_destroy_list(reaped);
+
+    if(!jsrt) {
+        if(!(jsrt = rtpool_runtime_create())) {
+            switch_mutex_lock(rtpool.mutex);
+            if(rtpool.active_count) rtpool.active_count--;
+            switch_mutex_unlock(rtpool.mutex);
+            return NULL;
+        }
+    }
+
+    jsrt->next = NULL;
+    jsrt->uses++;
+    JS_UpdateStackTop(jsrt->rt);
+
+    return jsrt;
+}
+
+/**
+ ** drops the script context and keeps the runtime for the next script
+ ** runtimes which still have objects or pending jobs after GC aren't reused
+ **/
+void rtpool_release(js_runtime_t *jsrt) {
+    js_runtime_t *reaped = NULL;
+    JSMemoryUsage mu = { 0 };
+    uint8_t fl_reuse = false;
+
+    if(!jsrt) {
+        return;
+    }
+
+    if(jsrt->ctx) {
+        JS_FreeContext(jsrt->ctx);
+        jsrt->ctx = NULL;
+    }
+
+    JS_RunGC(jsrt->rt);
+    JS_SetRuntimeInfo(jsrt->rt, NULL);
+    jsrt->script = NULL;
+
+    if(!globals.fl_shutdown && globals.cfg_rtpool_max > 0) {
+        JS_ComputeMemoryUsage(jsrt->rt, &mu);
+        fl_reuse = (mu.obj_count == 0 && !JS_IsJobPending(jsrt->rt));
+
+        /* don't keep the runtimes which have grown too much */
+        if(fl_reuse && globals.cfg_rt_arena_retain_max && rtalloc_footprint(jsrt->alloc) > globals.cfg_rt_arena_retain_max) {
+            fl_reuse = false;
+        }
+    }
+
+    if(fl_reuse) {
+        if(!(jsrt->ctx = js_builtins_ctx_create(jsrt->rt))) {
+            fl_reuse = false;
+        }
+    }
+
+    switch_mutex_lock(rtpool.mutex);
+    if(rtpool.active_count) rtpool.active_count--;
+    if(fl_reuse && rtpool.idle_count < globals.cfg_rtpool_max) {
+        jsrt->idle_since = switch_micro_time_now();
+        jsrt->next = rtpool.idle;
+        rtpool.idle = jsrt;
+        rtpool.idle_count++;
+        jsrt = NULL;
+    } else if(globals.cfg_rtpool_max > 0) {
+        rtpool.discarded++;
+    }
+    rtpool_reap(&reaped);
+    switch_mutex_unlock(rtpool.mutex);
+
+    rtpool_destroy_list(reaped);
+
+    if(jsrt) {
+        rtpool_runtime_destroy(jsrt);
+    }
+}
+
+void rtpool_stats(switch_stream_handle_t *stream) {
+    switch_mutex_lock(rtpool.mutex);
+    stream->write_function(stream, "idle: %u (min: %u, max: %u, idle-timeout: %us)\n", rtpool.idle_count, globals.cfg_rtpool_min, globals.cfg_rtpool_max, globals.cfg_rtpool_idle_timeout);
+    stream->write_function(stream, "active: %u\n", rtpool.active_count);
+    stream->write_function(stream, "created: %"SWITCH_UINT64_T_FMT"\n", rtpool.created);
+    stream->write_function(stream, "reused: %"SWITCH_UINT64_T_FMT"\n", rtpool.reused);
+    stream->write_function(stream, "discarded: %"SWITCH_UINT64_T_FMT"\n", rtpool.discarded);
+    switch_mutex_unlock(rtpool.mutex);
+}
+
+void rtpool_counters(uint64_t *created, uint64_t *reused) {
+    switch_mutex_lock(rtpool.mutex);
+    *created = rtpool.created;
+    *reused = rtpool.reused;
+    switch_mutex_unlock(rtpool.mutex);
+}
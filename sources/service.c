@@ -0,0 +1,516 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+#include "js_session.h"
+
+extern globals_t globals;
+
+/**
+ ** resident call handlers: a long-lived (autoload) script registers a handler by service.onCall(fn)
+ ** and qjs_dispatch hands the session to it, so a call costs a function call in a warm runtime
+ ** instead of a new script. the same script launched several times gives the shards of the service,
+ ** a call goes to the shard with less calls in progress.
+ ** the session thread waits until the handler (or the promise it returned) is finished or the call is hung up,
+ ** the handlers of a shard are executed one by one, so the blocking session methods hold the whole shard.
+ **/
+typedef struct service_s {
+    char                    *name;
+    service_shard_t         *shards;
+    uint32_t                shards_count;
+    uint32_t                rr;
+    uint64_t                calls;
+    uint64_t                failed;
+    uint64_t                dropped;            // the shard has gone before the call was taken
+} service_t;
+
+typedef struct service_call_s {
+    uint32_t                id;
+    uint32_t                refs;               // the session thread and the shard (atomic)
+    uint8_t                 fl_started;
+    uint8_t                 fl_async;           // waiting for the promise
+    uint8_t                 fl_failed;
+    uint8_t                 fl_done;
+    uint8_t                 fl_abandoned;       // the session thread has gone (atomic)
+    switch_mutex_t          *mutex;
+    switch_thread_cond_t    *cond;
+    switch_memory_pool_t    *pool;              // the call is allocated from it
+    switch_core_session_t   *session;           // read locked until the shard is done with the call
+    const char              *args;
+    service_shard_t         *shard;
+    JSValue                 session_obj;
+    struct service_call_s   *next;
+} service_call_t;
+
+struct service_shard_s {
+    script_t                *script;
+    service_t               *service;
+    JSValue                 handler;
+    uint8_t                 fl_registered;
+    uint32_t                inflight;
+    uint32_t                calls_seq;
+    service_call_t          *calls;             // async calls (script thread only)
+    service_shard_t         *next;
+};
+
+static struct {
+    switch_mutex_t          *mutex;
+    switch_memory_pool_t    *pool;
+    switch_hash_t           *services;          // name => service_t
+} service;
+
+/* under service.mutex */
+static void service_shard_unlink(service_shard_t *shard) {
+    service_t *svc = shard->service;
+
+    for(service_shard_t **pp = &svc->shards; *pp; pp = &(*pp)->next) {
+        if(*pp == shard) {
+            *pp = shard->next;
+            svc->shards_count--;
+            break;
+        }
+    }
+    shard->next = NULL;
+    shard->fl_registered = false;
+}
+
+static void service_call_unref(service_call_t *call) {
+    switch_memory_pool_t *pool = call->pool;
+
+    if(__atomic_sub_fetch(&call->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        switch_core_destroy_memory_pool(&pool);
+    }
+}
+
+/* the last access to the call from the shard side */
+static void service_call_finish(service_call_t *call, uint8_t fl_failed) {
+    service_shard_t *shard = call->shard;
+
+    switch_mutex_lock(service.mutex);
+    if(shard->inflight) shard->inflight--;
+    shard->service->calls++;
+    if(fl_failed) {
+        if(call->fl_started) { shard->service->failed++; } else { shard->service->dropped++; }
+    }
+    switch_mutex_unlock(service.mutex);
+
+    switch_mutex_lock(call->mutex);
+    call->fl_failed = fl_failed;
+    call->fl_done = true;
+    switch_thread_cond_signal(call->cond);
+    switch_mutex_unlock(call->mutex);
+
+    switch_core_session_rwunlock(call->session);
+    service_call_unref(call);
+}
+
+static void service_call_release(JSContext *ctx, service_call_t *call) {
+    if(!JS_IsUndefined(call->session_obj)) {
+        js_session_object_detach(ctx, call->session_obj);
+        JS_FreeValue(ctx, call->session_obj);
+        call->session_obj = JS_UNDEFINED;
+    }
+}
+
+// promise.then(settled, settled)
+static JSValue service_call_settled(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic, JSValue *func_data) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    service_shard_t *shard = (script ? script->service : NULL);
+    service_call_t *call = NULL;
+    uint32_t id = 0;
+
+    if(!shard || JS_ToUint32(ctx, &id, func_data[0])) {
+        return JS_UNDEFINED;
+    }
+
+    for(service_call_t **pp = &shard->calls; *pp; pp = &(*pp)->next) {
+        if((*pp)->id == id) {
+            call = *pp;
+            *pp = call->next;
+            break;
+        }
+    }
+    if(!call) {
+        return JS_UNDEFINED;
+    }
+
+    if(magic) {
+        const char *str = (argc > 0 ? JS_ToCString(ctx, argv[0]) : NULL);
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "QJS [%s]: Call handler rejected: %s\n", script->name, (str ? str : "[no error message]"));
+        JS_FreeCString(ctx, str);
+    }
+
+    service_call_release(ctx, call);
+    service_call_finish(call, magic);
+
+    return JS_UNDEFINED;
+}
+
+/* the task, executed by the shard event loop */
+static JSValue service_call_run(JSContext *ctx, void *data) {
+    service_call_t *call = (service_call_t *)data;
+    service_shard_t *shard = call->shard;
+    script_t *script = shard->script;
+    JSValue args[2], ret_val, then_val;
+
+    call->fl_started = true;
+    call->fl_failed = true;
+
+    if(__atomic_load_n(&call->fl_abandoned, __ATOMIC_ACQUIRE) || !shard->fl_registered || !JS_IsFunction(ctx, shard->handler) || script->fl_exit || script->fl_interrupt) {
+        return JS_UNDEFINED;
+    }
+
+    call->session_obj = js_session_object_create(ctx, call->session);
+    if(JS_IsException(call->session_obj)) {
+        call->session_obj = JS_UNDEFINED;
+        return JS_EXCEPTION;
+    }
+
+    args[0] = call->session_obj;
+    args[1] = (call->args ? JS_NewString(ctx, call->args) : JS_UNDEFINED);
+    ret_val = JS_Call(ctx, shard->handler, JS_UNDEFINED, 2, (JSValueConst *)args);
+    JS_FreeValue(ctx, args[1]);
+
+    if(JS_IsException(ret_val)) {
+        service_call_release(ctx, call);
+        return ret_val;
+    }
+
+    then_val = (JS_IsObject(ret_val) ? JS_GetPropertyStr(ctx, ret_val, "then") : JS_UNDEFINED);
+    if(JS_IsFunction(ctx, then_val)) {
+        JSValue id_val = JS_NewUint32(ctx, (call->id = ++shard->calls_seq));
+        JSValue funcs[2], tmp;
+
+        funcs[0] = JS_NewCFunctionData(ctx, service_call_settled, 1, 0, 1, &id_val);
+        funcs[1] = JS_NewCFunctionData(ctx, service_call_settled, 1, 1, 1, &id_val);
+        tmp = JS_Call(ctx, then_val, ret_val, 2, (JSValueConst *)funcs);
+
+        if(!JS_IsException(tmp)) {
+            call->fl_async = true;
+            call->next = shard->calls;
+            shard->calls = call;
+        }
+
+        JS_FreeValue(ctx, funcs[0]);
+        JS_FreeValue(ctx, funcs[1]);
+        JS_FreeValue(ctx, then_val);
+        JS_FreeValue(ctx, ret_val);
+
+        if(JS_IsException(tmp)) {
+            service_call_release(ctx, call);
+            return tmp;
+        }
+        JS_FreeValue(ctx, tmp);
+        return JS_UNDEFINED;
+    }
+
+    JS_FreeValue(ctx, then_val);
+    JS_FreeValue(ctx, ret_val);
+    service_call_release(ctx, call);
+
+    call->fl_failed = false;
+    return JS_UNDEFINED;
+}
+
+/* the task is done or has been dropped with the loop */
+static void service_call_free(void *data) {
+    service_call_t *call = (service_call_t *)data;
+
+    if(!call->fl_async) {
+        service_call_finish(call, (!call->fl_started || call->fl_failed));
+    }
+}
+
+/**
+ ** the session thread has given up on the call (hangup or shutdown), the task goes after service_call_run,
+ ** so the call is either finished already or waits for its promise: that one is failed right away,
+ ** the session object is detached and the session lock is dropped without waiting for the promise
+ **/
+static JSValue service_call_abort(JSContext *ctx, void *data) {
+    service_call_t *call = (service_call_t *)data;
+    service_shard_t *shard = call->shard;
+
+    for(service_call_t **pp = &shard->calls; *pp; pp = &(*pp)->next) {
+        if(*pp == call) {
+            *pp = call->next;
+            service_call_release(ctx, call);
+            service_call_finish(call, true);
+            break;
+        }
+    }
+
+    return JS_UNDEFINED;
+}
+
+/* the reference of the session thread was passed to the task */
+static void service_call_abort_free(void *data) {
+    service_call_unref((service_call_t *)data);
+}
+
+static const char *service_name_default(script_t *script) {
+    char *p = NULL;
+
+    /* the launch option or the script name without the extension */
+    if(!script->service_name) {
+        script->service_name = switch_core_strdup(script->pool, script->name);
+        if((p = strrchr(script->service_name, '.'))) {
+            *p = '\0';
+        }
+    }
+
+    return script->service_name;
+}
+
+// service.onCall(func)
+static JSValue js_service_on_call(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    service_shard_t *shard = NULL;
+    service_t *svc = NULL;
+    const char *name = NULL;
+
+    if(!script || !script->evloop) {
+        return JS_ThrowTypeError(ctx, "Script is not available");
+    }
+    if(script->session) {
+        return JS_ThrowTypeError(ctx, "Not allowed for a session script");
+    }
+    if(argc < 1 || !JS_IsFunction(ctx, argv[0])) {
+        return JS_ThrowTypeError(ctx, "service.onCall(func)");
+    }
+
+    if(!(shard = script->service)) {
+        shard = switch_core_alloc(script->pool, sizeof(service_shard_t));
+        shard->script = script;
+        shard->handler = JS_UNDEFINED;
+        script->service = shard;
+    }
+
+    JS_FreeValue(ctx, shard->handler);
+    shard->handler = JS_DupValue(ctx, argv[0]);
+
+    if(shard->fl_registered) {
+        return JS_TRUE;
+    }
+
+    name = service_name_default(script);
+
+    switch_mutex_lock(service.mutex);
+    if(!(svc = switch_core_hash_find(service.services, name))) {
+        svc = switch_core_alloc(service.pool, sizeof(service_t));
+        svc->name = switch_core_strdup(service.pool, name);
+        switch_core_hash_insert(service.services, svc->name, svc);
+    }
+    shard->service = svc;
+    shard->next = svc->shards;
+    shard->fl_registered = true;
+    svc->shards = shard;
+    svc->shards_count++;
+    switch_mutex_unlock(service.mutex);
+
+    evloop_ref(script->evloop);
+
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Service '%s' shard registered (script-id=%s)\n", name, script->id);
+    return JS_TRUE;
+}
+
+// service.stop() - no more calls, the script finishes when the event loop is empty
+static JSValue js_service_stop(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    service_shard_t *shard = (script ? script->service : NULL);
+
+    if(!shard || !shard->fl_registered) {
+        return JS_FALSE;
+    }
+
+    switch_mutex_lock(service.mutex);
+    service_shard_unlink(shard);
+    switch_mutex_unlock(service.mutex);
+
+    evloop_unref(script->evloop);
+
+    return JS_TRUE;
+}
+
+static JSValue js_service_name_get(JSContext *ctx, JSValueConst this_val) {
+    script_t *script = JS_GetContextOpaque(ctx);
+    return (script ? JS_NewString(ctx, service_name_default(script)) : JS_UNDEFINED);
+}
+
+static const JSCFunctionListEntry js_service_funcs[] = {
+    JS_CFUNC_DEF("onCall", 1, js_service_on_call),
+    JS_CFUNC_DEF("stop", 0, js_service_stop),
+    JS_CGETSET_DEF("name", js_service_name_get, NULL),
+};
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+switch_status_t service_init(switch_memory_pool_t *pool) {
+    memset(&service, 0, sizeof(service));
+
+    service.pool = pool;
+    switch_mutex_init(&service.mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_core_hash_init(&service.services);
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+void service_shutdown() {
+    if(service.services) {
+        switch_core_hash_destroy(&service.services);
+    }
+}
+
+void service_register_globals(JSContext *ctx, JSValue global_obj) {
+    JSValue service_obj = JS_NewObject(ctx);
+
+    JS_SetPropertyFunctionList(ctx, service_obj, js_service_funcs, ARRAY_SIZE(js_service_funcs));
+    JS_SetPropertyStr(ctx, global_obj, "service", service_obj);
+}
+
+/**
+ ** called by the script thread when the event loop is finished (the context is still alive)
+ ** the calls which are still in the queue are dropped by the loop destruction
+ **/
+void service_script_done(script_t *script) {
+    service_shard_t *shard = script->service;
+    service_call_t *call = NULL;
+
+    if(!shard) {
+        return;
+    }
+
+    if(shard->fl_registered) {
+        switch_mutex_lock(service.mutex);
+        service_shard_unlink(shard);
+        switch_mutex_unlock(service.mutex);
+    }
+
+    while((call = shard->calls)) {
+        shard->calls = call->next;
+        service_call_release(script->ctx, call);
+        service_call_finish(call, true);
+    }
+
+    JS_FreeValue(script->ctx, shard->handler);
+    shard->handler = JS_UNDEFINED;
+}
+
+/**
+ ** qjs_dispatch, blocks the session thread until the handler is done with the session or the call is hung up
+ ** (a promise which is never settled doesn't hold the thread beyond the call),
+ ** the call is shared with the shard, the session stays read locked until the shard releases it,
+ ** the script is pinned while the thread waits, so the loop is there to take the abort
+ **/
+switch_status_t service_dispatch(switch_core_session_t *session, const char *name, const char *args) {
+    switch_channel_t *channel = switch_core_session_get_channel(session);
+    switch_memory_pool_t *pool = NULL;
+    switch_status_t status = SWITCH_STATUS_FALSE;
+    service_shard_t *shard = NULL, *best = NULL;
+    service_call_t *call = NULL;
+    service_t *svc = NULL;
+    uint32_t start = 0, idx = 0, dist = 0, best_dist = 0;
+    uint8_t fl_gone = false;
+
+    if(switch_core_session_read_lock(session) != SWITCH_STATUS_SUCCESS) {
+        return SWITCH_STATUS_FALSE;
+    }
+    if(switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "switch_core_new_memory_pool()\n");
+        switch_core_session_rwunlock(session);
+        return SWITCH_STATUS_MEMERR;
+    }
+
+    switch_mutex_lock(service.mutex);
+    if((svc = switch_core_hash_find(service.services, name)) && svc->shards_count) {
+        /* the less loaded one, the equally loaded are taken in turn */
+        start = (svc->rr++ % svc->shards_count);
+        for(shard = svc->shards; shard; shard = shard->next, idx++) {
+            dist = ((idx + svc->shards_count - start) % svc->shards_count);
+            if(!best || shard->inflight < best->inflight || (shard->inflight == best->inflight && dist < best_dist)) {
+                best = shard;
+                best_dist = dist;
+            }
+        }
+
+        if(script_sem_take(best->script)) {
+            best->inflight++;
+        } else {
+            best = NULL;
+        }
+    }
+    switch_mutex_unlock(service.mutex);
+
+    if(!best) {
+        switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Service not available (%s)\n", name);
+        switch_core_destroy_memory_pool(&pool);
+        switch_core_session_rwunlock(session);
+        return SWITCH_STATUS_NOTFOUND;
+    }
+
+    call = switch_core_alloc(pool, sizeof(service_call_t));
+    call->refs = 2;
+    call->pool = pool;
+    switch_mutex_init(&call->mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_thread_cond_create(&call->cond, pool);
+    call->session = session;
+    call->args = (zstr(args) ? NULL : switch_core_strdup(pool, args));
+    call->shard = best;
+    call->session_obj = JS_UNDEFINED;
+
+    /* the loop is alive while the script is pinned, the call is released through service_call_free in any case */
+    evloop_post(best->script->evloop, service_call_run, call, service_call_free);
+
+    switch_mutex_lock(call->mutex);
+    while(!call->fl_done) {
+        if(globals.fl_shutdown || !switch_channel_ready(channel)) {
+            fl_gone = true;
+            break;
+        }
+        /* the script is being destroyed: the queued task is going to be freed with the loop */
+        if(best->script->fl_destroyed) {
+            break;
+        }
+        switch_thread_cond_timedwait(call->cond, call->mutex, 1000000);
+    }
+    status = ((!call->fl_done || call->fl_failed) ? SWITCH_STATUS_FALSE : SWITCH_STATUS_SUCCESS);
+    if(fl_gone && !call->fl_done) {
+        __atomic_store_n(&call->fl_abandoned, true, __ATOMIC_RELEASE);
+    } else {
+        fl_gone = false;
+    }
+    switch_mutex_unlock(call->mutex);
+
+    if(fl_gone) {
+        switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Call has gone before the handler finished (%s)\n", name);
+        evloop_post(best->script->evloop, service_call_abort, call, service_call_abort_free);
+    } else {
+        service_call_unref(call);
+    }
+    script_sem_release(best->script);
+
+    return status;
+}
+
+void service_stats(switch_stream_handle_t *stream) {
+    switch_hash_index_t *hidx = NULL;
+
+    switch_mutex_lock(service.mutex);
+    for(hidx = switch_core_hash_first_iter(service.services, hidx); hidx; hidx = switch_core_hash_next(&hidx)) {
+        service_t *svc = NULL;
+        void *hval = NULL;
+
+        switch_core_hash_this(hidx, NULL, NULL, &hval);
+        svc = (service_t *)hval;
+
+        stream->write_function(stream, "%s: shards: %u, calls: %"SWITCH_UINT64_T_FMT", failed: %"SWITCH_UINT64_T_FMT", dropped: %"SWITCH_UINT64_T_FMT"\n",
+            svc->name, svc->shards_count, svc->calls, svc->failed, svc->dropped);
+
+        for(service_shard_t *shard = svc->shards; shard; shard = shard->next) {
+            stream->write_function(stream, "  %s [inflight: %u]\n", shard->script->id, shard->inflight);
+        }
+    }
+    switch_safe_free(hidx);
+    switch_mutex_unlock(service.mutex);
+}
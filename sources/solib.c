@@ -0,0 +1,139 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+
+extern globals_t globals;
+
+/**
+ ** native modules (.so) are loaded once per process and shared by all scripts,
+ ** each script holds a reference until it finishes (see: script->mod_hlist)
+ ** unused libraries are unloaded only when so-modules-unload is enabled
+ **/
+struct solib_s {
+    char                    *path;
+    void                    *handle;
+    JSInitModuleFunc        *init;
+    uint32_t                refs;
+    uint64_t                uses;
+};
+
+static struct {
+    switch_mutex_t          *mutex;
+    switch_hash_t           *entries;
+    uint64_t                loads;
+    uint64_t                unloads;
+} solibs;
+
+static void solib_free(solib_t *lib) {
+    if(lib) {
+        if(lib->handle) {
+            dlclose(lib->handle);
+        }
+        switch_safe_free(lib->path);
+        switch_safe_free(lib);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+switch_status_t solib_init(switch_memory_pool_t *pool) {
+    memset(&solibs, 0, sizeof(solibs));
+
+    switch_mutex_init(&solibs.mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_core_hash_init(&solibs.entries);
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+/**
+ ** should be called after all scripts were finished
+ **/
+void solib_shutdown() {
+    switch_hash_index_t *hidx = NULL;
+
+    switch_mutex_lock(solibs.mutex);
+    for(hidx = switch_core_hash_first_iter(solibs.entries, hidx); hidx; hidx = switch_core_hash_next(&hidx)) {
+        void *hval = NULL;
+        switch_core_hash_this(hidx, NULL, NULL, &hval);
+        solib_free((solib_t *)hval);
+    }
+    switch_safe_free(hidx);
+    switch_core_hash_destroy(&solibs.entries);
+    switch_mutex_unlock(solibs.mutex);
+}
+
+/**
+ ** returns the library with a taken reference (solib_release() is required) or NULL
+ ** in this case the error message is written to errbuf
+ **/
+solib_t *solib_acquire(const char *path, JSInitModuleFunc **init, char *errbuf, switch_size_t errbuf_len) {
+    solib_t *lib = NULL;
+    void *hd = NULL;
+
+    switch_mutex_lock(solibs.mutex);
+    if((lib = switch_core_hash_find(solibs.entries, path))) {
+        lib->refs++;
+        lib->uses++;
+        *init = lib->init;
+        goto out;
+    }
+
+    if(!(hd = dlopen(path, RTLD_NOW | RTLD_LOCAL))) {
+        switch_snprintf(errbuf, errbuf_len, "%s", dlerror());
+        goto out;
+    }
+    if(!(*init = dlsym(hd, "js_init_module"))) {
+        switch_snprintf(errbuf, errbuf_len, "missing symbol: js_init_module");
+        dlclose(hd);
+        goto out;
+    }
+
+    switch_zmalloc(lib, sizeof(solib_t));
+    lib->path = strdup(path);
+    lib->handle = hd;
+    lib->init = *init;
+    lib->refs = 1;
+    lib->uses = 1;
+
+    switch_core_hash_insert(solibs.entries, lib->path, lib);
+    solibs.loads++;
+out:
+    switch_mutex_unlock(solibs.mutex);
+    return lib;
+}
+
+void solib_release(solib_t *lib) {
+    if(!lib) {
+        return;
+    }
+
+    switch_mutex_lock(solibs.mutex);
+    if(lib->refs) lib->refs--;
+    if(!lib->refs && globals.cfg_solib_unload) {
+        switch_core_hash_delete(solibs.entries, lib->path);
+        solib_free(lib);
+        solibs.unloads++;
+    }
+    switch_mutex_unlock(solibs.mutex);
+}
+
+void solib_stats(switch_stream_handle_t *stream) {
+    switch_hash_index_t *hidx = NULL;
+
+    switch_mutex_lock(solibs.mutex);
+    for(hidx = switch_core_hash_first_iter(solibs.entries, hidx); hidx; hidx = switch_core_hash_next(&hidx)) {
+        solib_t *lib = NULL;
+        void *hval = NULL;
+
+        switch_core_hash_this(hidx, NULL, NULL, &hval);
+        lib = (solib_t *)hval;
+
+        stream->write_function(stream, "%s [refs: %u, uses: %"SWITCH_UINT64_T_FMT"]\n", lib->path, lib->refs, lib->uses);
+    }
+    switch_safe_free(hidx);
+    stream->write_function(stream, "loads: %"SWITCH_UINT64_T_FMT", unloads: %"SWITCH_UINT64_T_FMT" (unload: %s)\n", solibs.loads, solibs.unloads, (globals.cfg_solib_unload ? "on" : "off"));
+    switch_mutex_unlock(solibs.mutex);
+}
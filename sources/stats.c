@@ -0,0 +1,278 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+
+extern globals_t globals;
+
+#define STATS_UPDATE_INTERVAL_US    1000000
+
+/* upper bounds of the gc pause buckets (us), the last one is unbounded */
+static const switch_time_t gc_hist_bounds[SCRIPT_GC_HIST_BUCKETS - 1] = { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000 };
+static const char *gc_hist_names[SCRIPT_GC_HIST_BUCKETS] = { "0.1ms", "0.25ms", "0.5ms", "1ms", "2.5ms", "5ms", "10ms", "25ms", "50ms", "inf" };
+
+static struct {
+    uint8_t                 fl_subclass_reserved;
+    uint64_t                gc_count;               // atomic
+    uint64_t                gc_time;                // atomic
+    uint64_t                gc_hist[SCRIPT_GC_HIST_BUCKETS];
+} stats;
+
+static uint32_t stats_gc_bucket(switch_time_t pause) {
+    uint32_t i = 0;
+
+    for(i = 0; i < ARRAY_SIZE(gc_hist_bounds); i++) {
+        if(pause <= gc_hist_bounds[i]) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/* 0 while the script is queued (not taken by a worker yet) */
+static switch_time_t stats_wall_time(script_t *script) {
+    return (script->wall_time_start ? (switch_micro_time_now() - script->wall_time_start) : 0);
+}
+
+static void stats_script_event_fire(script_t *script, script_stats_t *st) {
+    switch_event_t *event = NULL;
+
+    if(switch_event_create_subclass(&event, SWITCH_EVENT_CUSTOM, STATS_EVENT_SUBCLASS) != SWITCH_STATUS_SUCCESS) {
+        return;
+    }
+
+    switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Script-ID", script->id);
+    switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Script-Name", script->name);
+    if(script->session_id) {
+        switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Unique-ID", script->session_id);
+    }
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Wall-Time", "%"SWITCH_TIME_T_FMT, stats_wall_time(script) / 1000);
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, "CPU-Time", "%"SWITCH_TIME_T_FMT, st->cpu_time / 1000);
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Heap-Used", "%"SWITCH_INT64_T_FMT, st->heap_used);
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Heap-Limit", "%"SWITCH_INT64_T_FMT, st->heap_limit);
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Objects", "%"SWITCH_INT64_T_FMT, st->obj_count);
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Native-Objects", "%u", st->native_objects);
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, "GC-Count", "%u", st->gc_count);
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, "GC-Time", "%"SWITCH_TIME_T_FMT, st->gc_time / 1000);
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, "GC-Pause-Max", "%"SWITCH_TIME_T_FMT, st->gc_pause_max);
+    for(int i = 0; i < SCRIPT_GC_HIST_BUCKETS; i++) {
+        switch_event_add_header(event, SWITCH_STACK_BOTTOM, "GC-Pauses", "%s:%u", gc_hist_names[i], st->gc_hist[i]);
+    }
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Allocs", "%"SWITCH_UINT64_T_FMT, st->alloc_count);
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Frees", "%"SWITCH_UINT64_T_FMT, st->free_count);
+    switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Arena-Size", "%"SWITCH_SIZE_T_FMT, st->arena_size);
+
+    switch_event_fire(&event);
+}
+
+static void stats_event_cb(script_t *script, void *udata) {
+    script_stats_t st = { 0 };
+
+    switch_mutex_lock(script->mutex);
+    memcpy(&st, &script->stats, sizeof(script_stats_t));
+    switch_mutex_unlock(script->mutex);
+
+    stats_script_event_fire(script, &st);
+}
+
+static void *SWITCH_THREAD_FUNC stats_event_thread(switch_thread_t *thread, void *obj) {
+    switch_time_t next_time = 0;
+
+    next_time = switch_micro_time_now() + ((switch_time_t)globals.cfg_stats_event_interval * 1000000);
+    while(!globals.fl_shutdown) {
+        if(switch_micro_time_now() < next_time) {
+            switch_yield(250000);
+            continue;
+        }
+
+        registry_foreach(REGISTRY_INDEX_ALL, NULL, stats_event_cb, NULL);
+
+        next_time = switch_micro_time_now() + ((switch_time_t)globals.cfg_stats_event_interval * 1000000);
+    }
+
+    thread_finished();
+    return NULL;
+}
+
+static void stats_script_write(switch_stream_handle_t *stream, script_t *script, uint8_t fl_json, uint32_t idx) {
+    switch_time_t wall_time = stats_wall_time(script);
+    script_stats_t st = { 0 };
+
+    switch_mutex_lock(script->mutex);
+    memcpy(&st, &script->stats, sizeof(script_stats_t));
+    switch_mutex_unlock(script->mutex);
+
+    if(fl_json) {
+        stream->write_function(stream, "%s{\"id\":\"", (idx ? "," : ""));
+        stream_write_escaped(stream, script->id);
+        stream->write_function(stream, "\",\"name\":\"");
+        stream_write_escaped(stream, script->name);
+        stream->write_function(stream, "\",\"session\":\"");
+        stream_write_escaped(stream, script->session_id);
+        stream->write_function(stream, "\",\"wallTime\":%"SWITCH_TIME_T_FMT",\"cpuTime\":%"SWITCH_TIME_T_FMT","
+            "\"heapUsed\":%"SWITCH_INT64_T_FMT",\"heapLimit\":%"SWITCH_INT64_T_FMT",\"objects\":%"SWITCH_INT64_T_FMT",\"strings\":%"SWITCH_INT64_T_FMT",\"atoms\":%"SWITCH_INT64_T_FMT","
+            "\"nativeObjects\":%u,\"gcCount\":%u,\"gcTime\":%"SWITCH_TIME_T_FMT",\"allocs\":%"SWITCH_UINT64_T_FMT",\"frees\":%"SWITCH_UINT64_T_FMT",\"arenaSize\":%"SWITCH_SIZE_T_FMT","
+            "\"gcPauseMax\":%"SWITCH_TIME_T_FMT",\"gcPauses\":[%u,%u,%u,%u,%u,%u,%u,%u,%u,%u],\"updated\":%"SWITCH_TIME_T_FMT"}",
+            wall_time / 1000, st.cpu_time / 1000,
+            st.heap_used, st.heap_limit, st.obj_count, st.str_count, st.atom_count,
+            st.native_objects, st.gc_count, st.gc_time / 1000, st.alloc_count, st.free_count, st.arena_size,
+            st.gc_pause_max, st.gc_hist[0], st.gc_hist[1], st.gc_hist[2], st.gc_hist[3], st.gc_hist[4], st.gc_hist[5], st.gc_hist[6], st.gc_hist[7], st.gc_hist[8], st.gc_hist[9],
+            (st.updated ? (switch_micro_time_now() - st.updated) / 1000 : -1)
+        );
+        return;
+    }
+
+    stream->write_function(stream, "%s (%s) [session: %s]\n", script->id, script->name, (script->session_id ? script->session_id : "none"));
+    stream->write_function(stream, "  wall-time: %"SWITCH_TIME_T_FMT" ms, cpu-time: %"SWITCH_TIME_T_FMT" ms\n", wall_time / 1000, st.cpu_time / 1000);
+    stream->write_function(stream, "  heap: %"SWITCH_INT64_T_FMT" bytes (limit: %"SWITCH_INT64_T_FMT"), objects: %"SWITCH_INT64_T_FMT", strings: %"SWITCH_INT64_T_FMT", atoms: %"SWITCH_INT64_T_FMT"\n",
+        st.heap_used, st.heap_limit, st.obj_count, st.str_count, st.atom_count);
+    stream->write_function(stream, "  native-objects: %u, gc-count: %u, gc-time: %"SWITCH_TIME_T_FMT" ms\n", st.native_objects, st.gc_count, st.gc_time / 1000);
+    stream->write_function(stream, "  allocs: %"SWITCH_UINT64_T_FMT", frees: %"SWITCH_UINT64_T_FMT", arena: %"SWITCH_SIZE_T_FMT" bytes\n", st.alloc_count, st.free_count, st.arena_size);
+    stream->write_function(stream, "  gc-pauses (max: %"SWITCH_TIME_T_FMT" us):", st.gc_pause_max);
+    for(int i = 0; i < SCRIPT_GC_HIST_BUCKETS; i++) {
+        stream->write_function(stream, " <=%s:%u", gc_hist_names[i], st.gc_hist[i]);
+    }
+    stream->write_function(stream, "\n");
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+switch_status_t stats_init(switch_memory_pool_t *pool) {
+    memset(&stats, 0, sizeof(stats));
+
+    if(switch_event_reserve_subclass(STATS_EVENT_SUBCLASS) != SWITCH_STATUS_SUCCESS) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to reserve subclass (%s)\n", STATS_EVENT_SUBCLASS);
+    } else {
+        stats.fl_subclass_reserved = true;
+    }
+
+    if(globals.cfg_stats_event_interval > 0 && stats.fl_subclass_reserved) {
+        launch_thread(pool, stats_event_thread, NULL);
+    }
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+/**
+ ** should be called after all threads were finished
+ **/
+void stats_shutdown() {
+    if(stats.fl_subclass_reserved) {
+        switch_event_free_subclass(STATS_EVENT_SUBCLASS);
+        stats.fl_subclass_reserved = false;
+    }
+}
+
+/**
+ ** takes a snapshot of the script resources, must be called from the script thread
+ ** without 'force' the snapshot is taken not often than once per STATS_UPDATE_INTERVAL_US
+ **/
+void stats_update(script_t *script, uint8_t force) {
+    switch_time_t now = switch_micro_time_now();
+    JSMemoryUsage mu = { 0 };
+    rtalloc_stats_t as = { 0 };
+
+    if(!script || !script->rt) {
+        return;
+    }
+    if(!force && (now - script->stats.updated) < STATS_UPDATE_INTERVAL_US) {
+        return;
+    }
+
+    JS_ComputeMemoryUsage(script->rt, &mu);
+    rtalloc_stats_get((script->jsrt ? script->jsrt->alloc : NULL), &as);
+
+    switch_mutex_lock(script->mutex);
+    script->stats.updated = now;
+    script->stats.cpu_time = (script_cpu_time_now() - script->cpu_time_start);
+    script->stats.heap_used = mu.malloc_size;
+    script->stats.heap_limit = mu.malloc_limit;
+    script->stats.obj_count = mu.obj_count;
+    script->stats.str_count = mu.str_count;
+    script->stats.atom_count = mu.atom_count;
+    script->stats.native_objects = (script->jsrt ? script->jsrt->native_objects : 0);
+    script->stats.alloc_count = as.allocs;
+    script->stats.free_count = as.frees;
+    script->stats.arena_size = as.arena_size;
+    switch_mutex_unlock(script->mutex);
+}
+
+typedef struct {
+    switch_stream_handle_t  *stream;
+    uint32_t                count;
+    uint8_t                 fl_json;
+} stats_write_ctx_t;
+
+static void stats_write_cb(script_t *script, void *udata) {
+    stats_write_ctx_t *wctx = (stats_write_ctx_t *)udata;
+
+    stats_script_write(wctx->stream, script, wctx->fl_json, wctx->count);
+    wctx->count++;
+}
+
+/**
+ ** writes stats of the specified script (or all if id is empty)
+ **/
+void stats_write(switch_stream_handle_t *stream, const char *id, uint8_t fl_json) {
+    stats_write_ctx_t wctx = { .stream = stream, .count = 0, .fl_json = fl_json };
+    uint32_t count = 0;
+
+    if(fl_json) {
+        stream->write_function(stream, "[");
+    }
+
+    if(!zstr(id)) {
+        script_t *script = registry_lookup(id);
+        if(script) {
+            stats_write_cb(script, &wctx);
+            script_sem_release(script);
+        }
+    } else {
+        registry_foreach(REGISTRY_INDEX_ALL, NULL, stats_write_cb, &wctx);
+    }
+    count = wctx.count;
+
+    if(fl_json) {
+        stream->write_function(stream, "]\n");
+    } else if(!count && !zstr(id)) {
+        stream->write_function(stream, "-ERR: not found\n");
+    }
+}
+
+/**
+ ** accounts a gc pause of the script (called from the script thread)
+ **/
+void stats_gc_pause(script_t *script, switch_time_t pause) {
+    uint32_t bucket = stats_gc_bucket(pause);
+
+    switch_mutex_lock(script->mutex);
+    script->stats.gc_count++;
+    script->stats.gc_time += pause;
+    script->stats.gc_hist[bucket]++;
+    if(pause > script->stats.gc_pause_max) {
+        script->stats.gc_pause_max = pause;
+    }
+    switch_mutex_unlock(script->mutex);
+
+    __atomic_add_fetch(&stats.gc_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats.gc_time, pause, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats.gc_hist[bucket], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ ** gc pauses of all scripts (since the module was loaded)
+ **/
+void stats_gc_write(switch_stream_handle_t *stream) {
+    uint64_t count = __atomic_load_n(&stats.gc_count, __ATOMIC_RELAXED);
+    uint64_t time = __atomic_load_n(&stats.gc_time, __ATOMIC_RELAXED);
+
+    stream->write_function(stream, "mode: %s (threshold: %"SWITCH_SIZE_T_FMT" bytes)\n", (globals.cfg_gc_mode == SCRIPT_GC_MODE_IDLE ? "idle" : "default"),
+                           (globals.cfg_gc_threshold ? globals.cfg_gc_threshold : SCRIPT_GC_THRESHOLD_DEFAULT));
+    stream->write_function(stream, "collections: %"SWITCH_UINT64_T_FMT", time: %"SWITCH_UINT64_T_FMT" ms, avg: %"SWITCH_UINT64_T_FMT" us\n", count, time / 1000, (count ? time / count : 0));
+    for(int i = 0; i < SCRIPT_GC_HIST_BUCKETS; i++) {
+        stream->write_function(stream, "<=%-7s %"SWITCH_UINT64_T_FMT"\n", gc_hist_names[i], __atomic_load_n(&stats.gc_hist[i], __ATOMIC_RELAXED));
+    }
+}
@@ -25,6 +25,9 @@ void launch_thread(switch_memory_pool_t *pool, switch_thread_start_t fun, void *
 void thread_finished() {
     switch_mutex_lock(globals.mutex);
     if(globals.active_threads) globals.active_threads--;
+    if(!globals.active_threads && globals.cond_threads) {
+        switch_thread_cond_broadcast(globals.cond_threads);
+    }
     switch_mutex_unlock(globals.mutex);
 }
 
@@ -43,20 +46,6 @@ switch_status_t new_uuid(char **uuid, switch_memory_pool_t *pool) {
     return SWITCH_STATUS_SUCCESS;
 }
 
-script_t *script_lookup(char *id) {
-    script_t *script = NULL;
-
-    if(zstr(id)) {
-        return NULL;
-    }
-
-    switch_mutex_lock(globals.mutex_scripts_map);
-    script = switch_core_hash_find(globals.scripts_map, id);
-    switch_mutex_unlock(globals.mutex_scripts_map);
-
-    return script;
-}
-
 uint32_t script_sem_take(script_t *script) {
     uint32_t status = false;
 
@@ -78,24 +67,169 @@ void script_sem_release(script_t *script) {
     if(script->sem) {
         script->sem--;
     }
+    if(!script->sem && script->sem_cond) {
+        switch_thread_cond_broadcast(script->sem_cond);
+    }
     switch_mutex_unlock(script->mutex);
 }
 
+/**
+ ** blocks until the last script_sem_release()
+ ** the wait is limited by 1s per round only to keep the debug message going when something got stuck
+ **/
 void script_wait_unlock(script_t *script) {
-    uint8_t fl_wloop = true;
-
     switch_mutex_lock(script->mutex);
-    fl_wloop = (script->sem != 0);
+    while(script->sem != 0) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Waiting for unlock (scipt-id=%s, sem=%i)\n", script->id, script->sem);
+        switch_thread_cond_timedwait(script->sem_cond, script->mutex, 1000000);
+    }
     switch_mutex_unlock(script->mutex);
+}
 
-    if(fl_wloop) {
-        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Waiting for unlock (scipt-id=%s, sem=%i)\n", script->id, script->sem);
-        while(fl_wloop) {
-            switch_mutex_lock(script->mutex);
-            fl_wloop = (script->sem != 0);
-            switch_mutex_unlock(script->mutex);
-            switch_yield(100000);
+/**
+ ** cpu time consumed by the calling thread (us)
+ **/
+switch_time_t script_cpu_time_now() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts = { 0 };
+
+    if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return ((switch_time_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+    }
+#endif
+    return 0;
+}
+
+/**
+ ** checks the wall-clock and cpu budgets, marks the script as interrupted when one of them is over
+ ** has to be called from the script thread (cpu time is per thread)
+ **/
+uint8_t script_budget_exceeded(script_t *script) {
+    const char *budget = NULL;
+    uint32_t limit = 0;
+
+    if(!script || script->fl_interrupt) {
+        return (script ? true : false);
+    }
+
+    if(script->wall_time_max && (switch_micro_time_now() - script->wall_time_start) > ((switch_time_t)script->wall_time_max * 1000000)) {
+        budget = "wall-time"; limit = script->wall_time_max;
+    } else if(script->cpu_time_max && (script_cpu_time_now() - script->cpu_time_start) > ((switch_time_t)script->cpu_time_max * 1000000)) {
+        budget = "cpu-time"; limit = script->cpu_time_max;
+    }
+
+    if(budget) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Script exceeded %s budget (%us), interrupting (script-id=%s, name=%s)\n", budget, limit, script->id, script->name);
+        script->fl_interrupt = true;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ ** called by quickjs periodically while the bytecode is running
+ ** returns non zero to abort the script with an uncatchable error
+ **/
+int script_interrupt_handler(JSRuntime *rt, void *opaque) {
+    js_runtime_t *jsrt = (js_runtime_t *)opaque;
+    script_t *script = (jsrt ? jsrt->script : NULL);
+
+    if(!script) {
+        return 0;
+    }
+    if(globals.fl_shutdown || script->fl_interrupt) {
+        return 1;
+    }
+    stats_update(script, false);
+
+    if(script->profiler) {
+        profiler_sample(script);
+    }
+
+    if(!script->wall_time_max && !script->cpu_time_max) {
+        return 0;
+    }
+
+    return script_budget_exceeded(script);
+}
+
+static size_t script_heap_size(script_t *script) {
+    return (script->jsrt ? rtalloc_used_size(script->jsrt->alloc) : 0);
+}
+
+/* in the idle mode quickjs collects only when the heap went far beyond the threshold (no idle points for too long) */
+static void script_gc_rearm(script_t *script) {
+    size_t threshold = (script->gc_threshold ? script->gc_threshold : SCRIPT_GC_THRESHOLD_DEFAULT);
+
+    if(script->gc_mode == SCRIPT_GC_MODE_IDLE) {
+        script->gc_heap_mark = script_heap_size(script);
+        JS_SetGCThreshold(script->rt, script->gc_heap_mark + (threshold * SCRIPT_GC_IDLE_HARD_FACTOR));
+    }
+}
+
+void script_gc_run(script_t *script) {
+    switch_time_t start = switch_micro_time_now();
+
+    JS_RunGC(script->rt);
+
+    script->gc_last = switch_micro_time_now();
+    stats_gc_pause(script, (script->gc_last - start));
+    script_gc_rearm(script);
+}
+
+/**
+ ** applies the script gc settings to the runtime (it might be used by another script before)
+ **/
+void script_gc_setup(script_t *script) {
+    if(script->gc_mode == SCRIPT_GC_MODE_IDLE) {
+        script_gc_rearm(script);
+    } else {
+        JS_SetGCThreshold(script->rt, (script->gc_threshold ? script->gc_threshold : SCRIPT_GC_THRESHOLD_DEFAULT));
+    }
+}
+
+/**
+ ** idle point: a frame was written, waiting for events, going to sleep or play
+ ** in the idle mode collects when the heap has grown by the threshold since the last collection
+ ** (or once per SCRIPT_GC_IDLE_INTERVAL_US with the system allocator, the heap size is unknown then)
+ ** the heap below the mark means quickjs has collected by itself and reset the threshold, so both are armed again
+ **/
+void script_gc_idle(script_t *script) {
+    size_t threshold = 0, heap_size = 0;
+
+    if(!script || !script->rt || script->gc_mode != SCRIPT_GC_MODE_IDLE) {
+        return;
+    }
+
+    if(script->jsrt && script->jsrt->alloc) {
+        threshold = (script->gc_threshold ? script->gc_threshold : SCRIPT_GC_THRESHOLD_DEFAULT);
+        heap_size = script_heap_size(script);
+        if(heap_size < script->gc_heap_mark) {
+            script_gc_rearm(script);
+            return;
+        }
+        if(heap_size < (script->gc_heap_mark + threshold)) {
+            return;
         }
+    } else if((switch_micro_time_now() - script->gc_last) < SCRIPT_GC_IDLE_INTERVAL_US) {
+        return;
+    }
+
+    script_gc_run(script);
+}
+
+void js_native_object_created(JSContext *ctx) {
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
+    if(jsrt) {
+        jsrt->native_objects++;
+    }
+}
+
+void js_native_object_finalized(JSRuntime *rt) {
+    js_runtime_t *jsrt = JS_GetRuntimeOpaque(rt);
+    if(jsrt && jsrt->native_objects) {
+        jsrt->native_objects--;
     }
 }
 
@@ -121,6 +255,14 @@ void js_ctx_dump_error(script_t *script, JSContext *ctx) {
     }
 }
 
+JSClassID js_class_id_register(JSRuntime *rt, JSClassID class_id, JSClassDef *class_def) {
+    if(!JS_IsRegisteredClass(rt, class_id)) {
+        JS_NewClassID(&class_id);
+        JS_NewClass(rt, class_id, class_def);
+    }
+    return class_id;
+}
+
 char *safe_pool_strdup(switch_memory_pool_t *pool, const char *str) {
     switch_assert(pool);
     if(zstr(str)) { return NULL; }
@@ -141,3 +283,37 @@ uint8_t *safe_pool_bufdup(switch_memory_pool_t *pool, uint8_t *buffer, switch_si
     }
     return buffer_local;
 }
+
+/**
+ ** writes the string as the body of a json (or quoted) string: '"', '\' and the control characters are escaped
+ **/
+void stream_write_escaped(switch_stream_handle_t *stream, const char *str) {
+    const char *p = str, *s = str;
+
+    if(!str) {
+        return;
+    }
+
+    for(; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+
+        if(c != '"' && c != '\\' && c >= 0x20) {
+            continue;
+        }
+        if(p > s) {
+            stream->write_function(stream, "%.*s", (int)(p - s), s);
+        }
+        switch(c) {
+            case '"':  stream->write_function(stream, "\\\""); break;
+            case '\\': stream->write_function(stream, "\\\\"); break;
+            case '\n': stream->write_function(stream, "\\n"); break;
+            case '\r': stream->write_function(stream, "\\r"); break;
+            case '\t': stream->write_function(stream, "\\t"); break;
+            default:   stream->write_function(stream, "\\u%04x", c);
+        }
+        s = p + 1;
+    }
+    if(p > s) {
+        stream->write_function(stream, "%s", s);
+    }
+}
@@ -0,0 +1,258 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+#ifdef __linux__
+ #include <sys/inotify.h>
+ #include <poll.h>
+#endif
+
+extern globals_t globals;
+
+/**
+ ** watches the scripts directories and compiles changed files in the background,
+ ** a new version is published in the bytecode cache, so the new calls get it without parsing
+ ** and the running ones keep the old one
+ **/
+#define WATCHER_DIRS_MAX            16
+#define WATCHER_POLL_TIMEOUT_MS     250
+
+typedef struct {
+    int                     wd;
+    char                    *path;
+} watcher_dir_t;
+
+static struct {
+    int                     fd;
+    uint32_t                dirs_count;
+    watcher_dir_t           dirs[WATCHER_DIRS_MAX];
+} watcher;
+
+#ifdef __linux__
+static uint8_t watcher_is_script(const char *name) {
+    size_t len = (name ? strlen(name) : 0);
+    return (len > 3 && !strcasecmp(name + len - 3, ".js"));
+}
+
+static watcher_dir_t *watcher_dir_lookup(int wd) {
+    for(uint32_t i = 0; i < watcher.dirs_count; i++) {
+        if(watcher.dirs[i].wd == wd) {
+            return &watcher.dirs[i];
+        }
+    }
+    return NULL;
+}
+
+static void watcher_dir_add(switch_memory_pool_t *pool, const char *path) {
+    int wd = 0;
+
+    if(zstr(path)) {
+        return;
+    }
+    if(watcher.dirs_count >= WATCHER_DIRS_MAX) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Too many directories to watch, ignored (%s)\n", path);
+        return;
+    }
+    if((wd = inotify_add_watch(watcher.fd, path, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)) < 0) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Unable to watch directory (%s): %s\n", path, strerror(errno));
+        return;
+    }
+
+    watcher.dirs[watcher.dirs_count].wd = wd;
+    watcher.dirs[watcher.dirs_count].path = switch_core_strdup(pool, path);
+    watcher.dirs_count++;
+}
+
+/**
+ ** every compile gets a fresh context: a compiled module stays in loaded_modules of its context
+ ** until the context is freed, so a long-lived one would grow with every file change
+ **/
+static switch_status_t watcher_preload(JSRuntime *rt, const char *path) {
+    switch_status_t status = SWITCH_STATUS_FALSE;
+    JSContext *ctx = NULL;
+
+    if(!(ctx = JS_NewContext(rt))) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "JS_NewContext()\n");
+        return SWITCH_STATUS_FALSE;
+    }
+
+    status = bcache_preload(ctx, path);
+
+    JS_FreeContext(ctx);
+    JS_RunGC(rt);
+
+    return status;
+}
+
+static void watcher_dir_preload(JSRuntime *rt, watcher_dir_t *dir) {
+    switch_dir_t *dh = NULL;
+    switch_memory_pool_t *pool = NULL;
+    char buf[1024] = { 0 };
+    const char *fname = NULL;
+    uint32_t count = 0;
+
+    if(switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+        return;
+    }
+    if(switch_dir_open(&dh, dir->path, pool) != SWITCH_STATUS_SUCCESS) {
+        goto out;
+    }
+
+    while((fname = switch_dir_next_file(dh, buf, sizeof(buf))) && !globals.fl_shutdown) {
+        if(watcher_is_script(fname)) {
+            char *path = switch_mprintf("%s%s%s", dir->path, SWITCH_PATH_SEPARATOR, fname);
+            if(watcher_preload(rt, path) == SWITCH_STATUS_SUCCESS) {
+                count++;
+            }
+            switch_safe_free(path);
+        }
+    }
+
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Preloaded %u scripts (%s)\n", count, dir->path);
+out:
+    if(dh) {
+        switch_dir_close(dh);
+    }
+    switch_core_destroy_memory_pool(&pool);
+}
+
+static void watcher_event_handle(JSRuntime *rt, struct inotify_event *ev) {
+    watcher_dir_t *dir = NULL;
+    char *path = NULL;
+
+    if(!ev->len) {
+        return;
+    }
+    if(has_suffix(ev->name, ".qjsb")) {
+        /* a new bundle was deployed */
+        if((ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) && !zstr(globals.cfg_bundles)) {
+            bundle_reload();
+        }
+        return;
+    }
+    if(!watcher_is_script(ev->name)) {
+        return;
+    }
+    if(!(dir = watcher_dir_lookup(ev->wd))) {
+        return;
+    }
+
+    path = switch_mprintf("%s%s%s", dir->path, SWITCH_PATH_SEPARATOR, ev->name);
+
+    if(ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        bcache_invalidate(path);
+    } else if(ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+        if(watcher_preload(rt, path) == SWITCH_STATUS_SUCCESS) {
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Script reloaded (%s)\n", path);
+        } else {
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Unable to compile script, the previous version is kept (%s)\n", path);
+        }
+    }
+
+    switch_safe_free(path);
+}
+
+static void *SWITCH_THREAD_FUNC watcher_thread(switch_thread_t *thread, void *obj) {
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    JSRuntime *rt = NULL;
+
+    /* private runtime, used for compilation only */
+    if(!(rt = JS_NewRuntime())) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "JS_NewRuntime()\n");
+        goto out;
+    }
+    if(globals.cfg_rt_mem_limit > 0) {
+        JS_SetMemoryLimit(rt, globals.cfg_rt_mem_limit);
+    }
+
+    for(uint32_t i = 0; i < watcher.dirs_count && !globals.fl_shutdown; i++) {
+        watcher_dir_preload(rt, &watcher.dirs[i]);
+    }
+
+    while(!globals.fl_shutdown) {
+        struct pollfd pfd = { .fd = watcher.fd, .events = POLLIN };
+        ssize_t len = 0;
+
+        if(poll(&pfd, 1, WATCHER_POLL_TIMEOUT_MS) <= 0) {
+            continue;
+        }
+        if((len = read(watcher.fd, buf, sizeof(buf))) <= 0) {
+            continue;
+        }
+
+        for(char *p = buf; p < buf + len; ) {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            watcher_event_handle(rt, ev);
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+
+out:
+    if(rt) {
+        JS_FreeRuntime(rt);
+    }
+
+    thread_finished();
+    return NULL;
+}
+#endif
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+switch_status_t watcher_init(switch_memory_pool_t *pool) {
+    memset(&watcher, 0, sizeof(watcher));
+    watcher.fd = -1;
+
+    if(!globals.cfg_watcher_enabled) {
+        return SWITCH_STATUS_SUCCESS;
+    }
+    if(!globals.cfg_bcache_enabled) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Scripts watcher requires bytecode-cache, disabled\n");
+        return SWITCH_STATUS_FALSE;
+    }
+
+#ifdef __linux__
+    if((watcher.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "inotify_init1() failed: %s\n", strerror(errno));
+        return SWITCH_STATUS_FALSE;
+    }
+
+    watcher_dir_add(pool, SWITCH_GLOBAL_dirs.script_dir);
+
+    if(!zstr(globals.cfg_watcher_dirs)) {
+        char *dirs_local = strdup(globals.cfg_watcher_dirs);
+        char *argv[WATCHER_DIRS_MAX] = { 0 };
+        int argc = switch_separate_string(dirs_local, ';', argv, ARRAY_SIZE(argv));
+
+        for(int i = 0; i < argc; i++) {
+            watcher_dir_add(pool, argv[i]);
+        }
+        switch_safe_free(dirs_local);
+    }
+
+    if(!watcher.dirs_count) {
+        close(watcher.fd);
+        watcher.fd = -1;
+        return SWITCH_STATUS_FALSE;
+    }
+
+    launch_thread(pool, watcher_thread, NULL);
+    return SWITCH_STATUS_SUCCESS;
+#else
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Scripts watcher isn't supported on this platform\n");
+    return SWITCH_STATUS_NOTIMPL;
+#endif
+}
+
+/**
+ ** should be called after all threads were finished
+ **/
+void watcher_shutdown() {
+    if(watcher.fd >= 0) {
+        close(watcher.fd);
+        watcher.fd = -1;
+    }
+    watcher.dirs_count = 0;
+}
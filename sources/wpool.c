@@ -0,0 +1,265 @@
+/**
+ * (C)2025 aks
+ * https://github.com/akscf/
+ **/
+#include "mod_quickjs.h"
+
+extern globals_t globals;
+
+typedef struct {
+    switch_thread_start_t   fun;
+    void                    *data;
+    switch_time_t           queued;
+} wpool_job_t;
+
+typedef struct {
+    wpool_job_t             *jobs;
+    uint32_t                size;
+    uint32_t                head;
+    uint32_t                count;
+    uint32_t                count_max;
+    uint64_t                submitted;
+    uint64_t                rejected;
+    uint64_t                completed;
+    switch_time_t           wait_time;
+    switch_time_t           wait_time_max;
+} wpool_queue_t;
+
+static struct {
+    switch_mutex_t          *mutex;
+    switch_thread_cond_t    *cond;
+    wpool_queue_t           queue[WPOOL_PRIO_MAX];
+    uint32_t                workers;
+    uint32_t                workers_max;
+    uint32_t                idle;
+    uint32_t                running[WPOOL_PRIO_MAX];
+    uint64_t                spawned;
+    uint8_t                 fl_stop;
+    uint8_t                 fl_ready;
+} wpool;
+
+static const char *wpool_prio_names[WPOOL_PRIO_MAX] = { "session", "background", "aux" };
+
+/* background jobs never take the workers which are reserved for the session-bound ones */
+static uint32_t wpool_bg_limit() {
+    if(globals.cfg_workers_max > globals.cfg_workers_reserved) {
+        return (globals.cfg_workers_max - globals.cfg_workers_reserved);
+    }
+    return 1;
+}
+
+/* the scripts are limited by workers-max, the aux jobs don't count (the scripts can wait for them) */
+static uint32_t wpool_scripts_running() {
+    return (wpool.running[WPOOL_PRIO_SESSION] + wpool.running[WPOOL_PRIO_BACKGROUND]);
+}
+
+/* must be called under wpool.mutex */
+static uint8_t wpool_job_next(wpool_job_t *job, uint8_t *prio) {
+    wpool_queue_t *q = NULL;
+    uint8_t fl_can_run = (wpool_scripts_running() < globals.cfg_workers_max);
+
+    if(wpool.queue[WPOOL_PRIO_AUX].count && wpool.running[WPOOL_PRIO_AUX] < globals.cfg_workers_aux_max) {
+        *prio = WPOOL_PRIO_AUX;
+    } else if(wpool.queue[WPOOL_PRIO_SESSION].count && fl_can_run) {
+        *prio = WPOOL_PRIO_SESSION;
+    } else if(wpool.queue[WPOOL_PRIO_BACKGROUND].count && fl_can_run && wpool.running[WPOOL_PRIO_BACKGROUND] < wpool_bg_limit()) {
+        *prio = WPOOL_PRIO_BACKGROUND;
+    } else {
+        return false;
+    }
+
+    q = &wpool.queue[*prio];
+    *job = q->jobs[q->head];
+    q->head = (q->head + 1) % q->size;
+    q->count--;
+
+    return true;
+}
+
+static void *SWITCH_THREAD_FUNC wpool_worker_thread(switch_thread_t *thread, void *obj) {
+    switch_memory_pool_t *pool = (switch_memory_pool_t *)obj;
+    switch_interval_time_t idle_timeout = ((switch_interval_time_t)globals.cfg_workers_idle_timeout * 1000000);
+    wpool_job_t job = { 0 };
+    uint8_t prio = 0;
+
+    switch_mutex_lock(wpool.mutex);
+    while(true) {
+        if(wpool_job_next(&job, &prio)) {
+            switch_time_t wait_time = (switch_micro_time_now() - job.queued);
+            wpool_queue_t *q = &wpool.queue[prio];
+
+            q->wait_time += wait_time;
+            if(wait_time > q->wait_time_max) q->wait_time_max = wait_time;
+            wpool.running[prio]++;
+            switch_mutex_unlock(wpool.mutex);
+
+            job.fun(thread, job.data);
+
+            switch_mutex_lock(wpool.mutex);
+            if(wpool.running[prio]) wpool.running[prio]--;
+            q->completed++;
+            continue;
+        }
+
+        if(wpool.fl_stop) {
+            break;
+        }
+
+        wpool.idle++;
+        if(idle_timeout > 0 && wpool.workers > globals.cfg_workers_min) {
+            switch_status_t st = switch_thread_cond_timedwait(wpool.cond, wpool.mutex, idle_timeout);
+            wpool.idle--;
+            if(st == SWITCH_STATUS_TIMEOUT && wpool.workers > globals.cfg_workers_min && !wpool.queue[WPOOL_PRIO_SESSION].count) {
+                break;
+            }
+        } else {
+            switch_thread_cond_wait(wpool.cond, wpool.mutex);
+            wpool.idle--;
+        }
+    }
+    wpool.workers--;
+    if(wpool.fl_stop) {
+        switch_thread_cond_broadcast(wpool.cond);
+    }
+    switch_mutex_unlock(wpool.mutex);
+
+    switch_core_destroy_memory_pool(&pool);
+    return NULL;
+}
+
+/* must be called under wpool.mutex */
+static switch_status_t wpool_worker_spawn() {
+    switch_memory_pool_t *pool = NULL;
+    switch_threadattr_t *attr = NULL;
+    switch_thread_t *thread = NULL;
+
+    if(switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "switch_core_new_memory_pool()\n");
+        return SWITCH_STATUS_MEMERR;
+    }
+
+    switch_threadattr_create(&attr, pool);
+    switch_threadattr_detach_set(attr, 1);
+    switch_threadattr_stacksize_set(attr, SWITCH_THREAD_STACKSIZE);
+
+    if(switch_thread_create(&thread, attr, wpool_worker_thread, pool, pool) != SWITCH_STATUS_SUCCESS) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to create worker thread\n");
+        switch_core_destroy_memory_pool(&pool);
+        return SWITCH_STATUS_FALSE;
+    }
+
+    wpool.workers++;
+    wpool.spawned++;
+    if(wpool.workers > wpool.workers_max) wpool.workers_max = wpool.workers;
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// public
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+switch_status_t wpool_init(switch_memory_pool_t *pool) {
+    memset(&wpool, 0, sizeof(wpool));
+
+    switch_mutex_init(&wpool.mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_thread_cond_create(&wpool.cond, pool);
+
+    for(int i = 0; i < WPOOL_PRIO_MAX; i++) {
+        wpool.queue[i].size = globals.cfg_workers_queue_size;
+        wpool.queue[i].jobs = switch_core_alloc(pool, sizeof(wpool_job_t) * wpool.queue[i].size);
+    }
+
+    switch_mutex_lock(wpool.mutex);
+    for(uint32_t i = 0; i < globals.cfg_workers_min; i++) {
+        if(wpool_worker_spawn() != SWITCH_STATUS_SUCCESS) {
+            break;
+        }
+    }
+    wpool.fl_ready = true;
+    switch_mutex_unlock(wpool.mutex);
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+/**
+ ** should be called after all jobs were finished (active_threads == 0)
+ **/
+void wpool_shutdown() {
+    switch_mutex_lock(wpool.mutex);
+    wpool.fl_ready = false;
+    wpool.fl_stop = true;
+    switch_thread_cond_broadcast(wpool.cond);
+
+    while(wpool.workers > 0) {
+        switch_thread_cond_timedwait(wpool.cond, wpool.mutex, 1000000);
+    }
+    switch_mutex_unlock(wpool.mutex);
+}
+
+/**
+ ** queues the job, returns SWITCH_STATUS_INUSE when the queue of the class is full (the job was not accepted)
+ ** fun is called as a thread function and has to call thread_finished() in the end (as with launch_thread)
+ ** an aux job gets a worker even when workers-max of them are busy with scripts (which may be waiting for it),
+ ** up to workers-aux-max aux jobs run at once, the rest stay queued
+ **/
+switch_status_t wpool_submit(uint8_t prio, switch_thread_start_t fun, void *data) {
+    switch_status_t status = SWITCH_STATUS_SUCCESS;
+    wpool_queue_t *q = NULL;
+
+    if(prio >= WPOOL_PRIO_MAX) {
+        prio = WPOOL_PRIO_BACKGROUND;
+    }
+
+    switch_mutex_lock(wpool.mutex);
+    q = &wpool.queue[prio];
+
+    if(!wpool.fl_ready || globals.fl_shutdown) {
+        switch_goto_status(SWITCH_STATUS_FALSE, out);
+    }
+    if(q->count >= q->size) {
+        q->rejected++;
+        switch_goto_status(SWITCH_STATUS_INUSE, out);
+    }
+
+    q->jobs[(q->head + q->count) % q->size] = (wpool_job_t) { .fun = fun, .data = data, .queued = switch_micro_time_now() };
+    q->count++;
+    q->submitted++;
+    if(q->count > q->count_max) q->count_max = q->count;
+
+    switch_mutex_lock(globals.mutex);
+    globals.active_threads++;
+    switch_mutex_unlock(globals.mutex);
+
+    if(prio == WPOOL_PRIO_AUX ? (wpool.idle < q->count && wpool.running[WPOOL_PRIO_AUX] < globals.cfg_workers_aux_max && wpool.workers < (globals.cfg_workers_max + globals.cfg_workers_aux_max)) :
+        (wpool.idle < (wpool.queue[WPOOL_PRIO_SESSION].count + wpool.queue[WPOOL_PRIO_BACKGROUND].count) && (wpool.workers - wpool.running[WPOOL_PRIO_AUX]) < globals.cfg_workers_max)) {
+        if(wpool_worker_spawn() != SWITCH_STATUS_SUCCESS && !wpool.workers) {
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "No workers to run the job, it stays queued\n");
+        }
+    }
+    switch_thread_cond_signal(wpool.cond);
+
+out:
+    switch_mutex_unlock(wpool.mutex);
+    return status;
+}
+
+void wpool_stats(switch_stream_handle_t *stream) {
+    switch_mutex_lock(wpool.mutex);
+    stream->write_function(stream, "workers: %u (idle: %u, busy: %u, min: %u, max: %u, reserved: %u, peak: %u), spawned: %"SWITCH_UINT64_T_FMT"\n",
+        wpool.workers, wpool.idle, (wpool.workers - wpool.idle), globals.cfg_workers_min, globals.cfg_workers_max, globals.cfg_workers_reserved,
+        wpool.workers_max, wpool.spawned
+    );
+    for(int i = 0; i < WPOOL_PRIO_MAX; i++) {
+        wpool_queue_t *q = &wpool.queue[i];
+        uint64_t started = (q->submitted - q->count);
+
+        stream->write_function(stream, "queue (%s): depth: %u/%u, peak: %u, submitted: %"SWITCH_UINT64_T_FMT", rejected: %"SWITCH_UINT64_T_FMT", completed: %"SWITCH_UINT64_T_FMT", wait-avg: %"SWITCH_TIME_T_FMT" ms, wait-max: %"SWITCH_TIME_T_FMT" ms\n",
+            wpool_prio_names[i], q->count, q->size, q->count_max, q->submitted, q->rejected, q->completed,
+            (started ? (q->wait_time / started) / 1000 : 0), q->wait_time_max / 1000
+        );
+    }
+    stream->write_function(stream, "running: session: %u, background: %u (limit: %u), aux: %u (limit: %u)\n",
+        wpool.running[WPOOL_PRIO_SESSION], wpool.running[WPOOL_PRIO_BACKGROUND], wpool_bg_limit(), wpool.running[WPOOL_PRIO_AUX], globals.cfg_workers_aux_max
+    );
+    switch_mutex_unlock(wpool.mutex);
+}